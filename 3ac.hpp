@@ -3,9 +3,12 @@
 
 #include <assert.h>
 #include <list>
+#include <ostream>
 #include <map>
 #include <set>
+#include <vector>
 #include <string.h>
+#include "arena.hpp"
 #include "symbol_table.hpp"
 #include "types.hpp"
 
@@ -14,22 +17,60 @@ namespace cminusminus{
 class TypeAnalysis;
 class Procedure;
 class IRProgram;
-
-class Label{
+class IRWriter;
+class IRReader;
+class Workers;
+
+//A jump target. Labels are numbered across the whole
+// program, and their names are only spelled out when the
+// program is printed. Each label also has a slot, dense
+// within the procedure that made it, so that passes can
+// keep what they know about labels in a vector.
+class Label : public ArenaObject{
 public:
-	Label(std::string nameIn){
-		this->name = nameIn;
-	}
-	std::string getName(){
-		return name;
+	//A numbered label, printed as lbl_<id>
+	Label(uint32_t idIn, uint32_t slotIn)
+	: id(idIn), slot(slotIn), fn(NONE){ }
+	//The label on the enter quad of function fnIn, printed
+	// as fun_<name> (or just main)
+	explicit Label(NameID fnIn) : id(NONE), slot(NONE), fn(fnIn){ }
+	std::string getName() const {
+		if (fn == NONE){ return "lbl_" + std::to_string(id); }
+		const std::string& name = Interner::spelling(fn);
+		return name == "main" ? name : "fun_" + name;
 	}
+	uint32_t getID() const { return id; }
+	uint32_t getSlot() const { return slot; }
+
+	static const uint32_t NONE = UINT32_MAX;
 private:
-	std::string name;
+	uint32_t id;
+	uint32_t slot;
+	NameID fn;
+	//Procedure::number() gives held labels their ids
+	friend class Procedure;
 };
 
-class Opd{
+//Which class an Opd is, so passes can tell without a
+// dynamic_cast (see irCast below)
+enum OpdKind : uint8_t {
+	SYM_OPD, LIT_OPD, AUX_OPD, ADDR_OPD, STRING_OPD
+};
+
+//An operand's index in its procedure's operand table (see
+// Procedure::opd). Quads refer to operands only by these.
+typedef uint32_t OpdID;
+static const OpdID NO_OPD = UINT32_MAX;
+
+//The entries of the operand tables. They are built in the
+// compilation's arena (see arena.hpp); a global or string
+// is one Opd, with an entry in the table of each procedure
+// that uses it.
+class Opd : public ArenaObject{
 public:
-	Opd(size_t widthIn) : myWidth(widthIn){}
+	Opd(OpdKind kindIn, size_t widthIn)
+	: myKind(kindIn), myWidth(static_cast<uint32_t>(widthIn)){}
+	OpdKind kind() const { return myKind; }
 	virtual std::string valString() = 0;
 	virtual std::string locString() = 0;
 	virtual size_t getWidth(){ return myWidth; }
@@ -43,11 +84,13 @@ public:
 		assert(false);
 	}
 private:
-	size_t myWidth;
+	OpdKind myKind;
+	uint32_t myWidth;
 };
 
 class SymOpd : public Opd{
 public:
+	static const OpdKind KIND = SYM_OPD;
 	virtual std::string valString() override{
 		return "[" + mySym->getName() + "]";
 	}
@@ -57,11 +100,12 @@ public:
 	virtual std::string getName(){
 		return mySym->getName();
 	}
+	NameID getNameID() const { return mySym->getNameID(); }
 	const SemSymbol * getSym(){ return mySym; }
 private:
 	//Private Constructor
 	SymOpd(SemSymbol * sym, size_t width)
-	: Opd(width), mySym(sym) {} 
+	: Opd(KIND, width), mySym(sym) {} 
 	SemSymbol * mySym;
 	friend class Procedure;
 	friend class IRProgram;
@@ -69,21 +113,23 @@ private:
 
 class LitOpd : public Opd{
 public:
-	LitOpd(std::string valIn, size_t width)
-	: Opd(width), val(valIn){ }
-	virtual std::string valString() override { return val; }
+	static const OpdKind KIND = LIT_OPD;
+	LitOpd(int64_t valIn, size_t width)
+	: Opd(KIND, width), val(valIn){ }
+	virtual std::string valString() override { return std::to_string(val); }
 	virtual std::string locString() override { 
 		throw InternalError("Tried to get location of a constant");
 	}
+	int64_t intVal(){ return val; }
 private:
-	std::string val;
-	std::string name;
+	int64_t val;
 };
 
 class AuxOpd : public Opd{
 public:
+	static const OpdKind KIND = AUX_OPD;
 	AuxOpd(std::string nameIn, size_t width) 
-	: Opd(width), name(nameIn) { }
+	: Opd(KIND, width), name(nameIn) { }
 	virtual std::string valString() override{
 		return "[" + getName() + "]";
 	}
@@ -99,8 +145,9 @@ private:
 
 class AddrOpd : public Opd{
 public:
+	static const OpdKind KIND = ADDR_OPD;
 	AddrOpd(std::string nameIn, size_t width)
-	: Opd(width), name(nameIn) { }
+	: Opd(KIND, width), name(nameIn) { }
 	virtual std::string valString() override{
 		return "[[" + getName() + "]]";
 	}
@@ -111,14 +158,15 @@ public:
 		return name;
 	}
 private:
-	std::string val;
 	std::string name;
 };
 
 class StringOpd : public Opd{
 public:
+	static const OpdKind KIND = STRING_OPD;
 	StringOpd(std::string nameIn, size_t width)
-	: Opd(width), name(nameIn) { }
+	: Opd(KIND, width), name(nameIn) { }
+	void setName(std::string nameIn){ name = nameIn; }
 	virtual std::string valString() override{
 		return "[" + getName() + "]";
 	}
@@ -129,226 +177,363 @@ public:
 		return name;
 	}
 private:
-	std::string val;
 	std::string name;
 };
 
-enum BinOp {
+//A cheap dynamic_cast to one of the (final) operand
+// classes, by the kind each one is tagged with
+template <typename T>
+T * irCast(Opd * opd){
+	if (opd == nullptr || opd->kind() != T::KIND){ return nullptr; }
+	return static_cast<T *>(opd);
+}
+
+enum BinOp : uint8_t {
 	ADD64, SUB64, DIV64, MULT64, EQ64, NEQ64, LT64, GT64, LTE64, GTE64, AND64, OR64
 };
-enum UnaryOp{
+enum UnaryOp : uint8_t {
 	NEG64, NOT8
 };
 
-class Quad{
-public:
-	Quad();
-	void addLabel(Label * label);
-	Label * getLabel(){ return labels.front(); }
-	virtual std::string repr() = 0;
-	std::string commentStr();
-	virtual std::string toString(bool verbose=false);
-	void setComment(std::string commentIn);
-private:
-	std::string myComment;
-	std::list<Label *> labels;
-};
-
-class BinOpQuad : public Quad{
-public:
-	BinOpQuad(Opd * dstIn, BinOp oprIn, Opd * src1In, Opd * src2In);
-	std::string repr() override;
-	static std::string oprString(BinOp opr);
-private:
-	Opd * dst;
-	BinOp opr;
-	Opd * src1;
-	Opd * src2;
-};
-
-class UnaryOpQuad : public Quad {
-public:
-	UnaryOpQuad(Opd * dstIn, UnaryOp opIn, Opd * srcIn);
-	std::string repr() override ;
-	Opd * getDst(){ return dst; }
-	Opd * getSrc(){ return src; }
-	UnaryOp getOp(){ return op; }
-private:
-	Opd * dst;
-	UnaryOp op;
-	Opd * src;
-};
-
-class AssignQuad : public Quad{
-	
-public:
-	AssignQuad(Opd * dstIn, Opd * srcIn);
-	std::string repr() override;
-	Opd * getDst(){ return dst; }
-	Opd * getSrc(){ return src; }
-private:
-	Opd * dst;
-	Opd * src;
-};
-
-class LocQuad : public Quad {
-public:
-	LocQuad(Opd * srcIn, Opd * tgtIn, bool srcLocIn, bool tgtLocIn)
-	: src(srcIn), tgt(tgtIn), srcIsLoc(srcLocIn), tgtIsLoc(tgtLocIn){ }
-	std::string repr() override;
-private:
-	Opd * src;
-	Opd * tgt;
-	bool srcIsLoc;
-	bool tgtIsLoc;
-};
-
-
-class GotoQuad : public Quad {
-public:
-	GotoQuad(Label * tgtIn);
-	std::string repr() override;
-	Label * getTarget(){ return tgt; }
-private:
-	Label * tgt;
-};
-
-class IfzQuad : public Quad {
-public:
-	IfzQuad(Opd * cndIn, Label * tgtIn);
-	std::string repr() override;
-	Label * getTarget(){ return tgt; }
-	Opd * getCnd(){ return cnd; }
-private:
-	Opd * cnd;
-	Label * tgt;
-};
-
-class NopQuad : public Quad {
-public:
-	NopQuad();
-	std::string repr() override;
-};
-
-class ReportQuad : public Quad {
-public:
-	ReportQuad(Opd * arg, const DataType * type);
-	std::string repr() override;
-	Opd * getSrc(){ return myArg; }
-	const DataType * getType(){ return myType; }
-private:
-	Opd * myArg;
-	const DataType * myType;
-};
-
-class ReceiveQuad : public Quad {
-public:
-	ReceiveQuad(Opd * arg, const DataType * type);
-	std::string repr() override;
-	Opd * getDst(){ return myArg; }
-private:
-	Opd * myArg;
-	const DataType * myType;
-};
-
-class CallQuad : public Quad{
-public:
-	CallQuad(SemSymbol * calleeIn);
-	std::string repr() override;
-private:
-	SemSymbol * callee;
-};
-
-class EnterQuad : public Quad{
-public:
-	EnterQuad(Procedure * proc);
-	virtual std::string repr() override;
-private:
-	Procedure * myProc;
-};
-
-class LeaveQuad : public Quad{
-public:
-	LeaveQuad(Procedure * proc);
-	virtual std::string repr() override;
-private:
-	Procedure * myProc;
+enum QuadKind : uint8_t {
+	ASSIGN_QUAD, BINOP_QUAD, UNARYOP_QUAD, LOC_QUAD, GOTO_QUAD,
+	IFZ_QUAD, NOP_QUAD, REPORT_QUAD, RECEIVE_QUAD, PHI_QUAD,
+	CALL_QUAD, SETARG_QUAD, GETARG_QUAD, SETRET_QUAD, GETRET_QUAD
 };
 
-class SetArgQuad : public Quad{
+//The operand slots a quad reads: up to two of its own
+// fields, or a run of them (a phi's sources). It is
+// passed around by value and never allocates, since it is
+// asked for once per quad in every pass.
+class UseSlots{
 public:
-	SetArgQuad(size_t indexIn, Opd * opdIn);
-	std::string repr() override;
+	UseSlots(){ }
+	UseSlots(OpdID * a) : count(1){ fixed[0] = a; }
+	UseSlots(OpdID * a, OpdID * b) : count(2){ fixed[0] = a; fixed[1] = b; }
+	UseSlots(OpdID * runIn, size_t size) : run(runIn), count(size){ }
+
+	class iterator{
+	public:
+		iterator(const UseSlots * ofIn, size_t idxIn)
+		: of(ofIn), idx(idxIn){ }
+		OpdID * operator*() const {
+			return of->run != nullptr ? of->run + idx : of->fixed[idx];
+		}
+		iterator& operator++(){ idx++; return *this; }
+		bool operator!=(const iterator& other) const {
+			return idx != other.idx;
+		}
+	private:
+		const UseSlots * of;
+		size_t idx;
+	};
+	iterator begin() const { return iterator(this, 0); }
+	iterator end() const { return iterator(this, count); }
+	size_t size() const { return count; }
 private:
-	size_t index;
-	Opd * opd;
+	OpdID * fixed[2];
+	OpdID * run = nullptr;
+	size_t count = 0;
 };
 
-class GetArgQuad : public Quad{
+//One quad, as a plain fixed-size record: a procedure keeps
+// its body as a vector of these, by value. The operands
+// are OpdIDs, and whatever else a quad needs is a number
+// in aux, so which fields are used depends on the kind:
+//  ASSIGN   dst := src1
+//  BINOP    dst := src1 op src2
+//  UNARYOP  dst := op src1
+//  LOC      dst := src1, where op says which of them is
+//           meant as a location (LOC_SRC, LOC_TGT)
+//  GOTO     jump to the label whose slot is aux
+//  IFZ      if src1 is 0, jump to the label in aux
+//  REPORT   write src1, whose type is number aux in the
+//           procedure's type table
+//  RECEIVE  read dst, of type number aux
+//  PHI      dst := the src1 sources from aux on in the
+//           procedure's phi source table
+//  CALL     call callee number aux
+//  SETARG   set argument aux (from 1) to src1
+//  GETARG   dst := argument aux
+//  SETRET   set the return value to src1
+//  GETRET   dst := the return value
+//Hardly any quad has a label or a comment, so those are
+// kept in side tables of the procedure, and a quad only
+// holds where its entry is (0 for none). See Procedure
+// for all of the tables.
+class Quad{
 public:
-	GetArgQuad(size_t indexIn, Opd * opdIn);
-	std::string repr() override;
-	Opd * getDst(){ return opd; }
-private:
-	size_t index;
-	Opd * opd;
-};
+	QuadKind kind;
+	uint8_t op;
+	OpdID dst;
+	OpdID src1;
+	OpdID src2;
+	uint32_t aux;
+	uint32_t labels;
+	uint32_t comment;
+
+	static const uint8_t LOC_SRC = 1;
+	static const uint8_t LOC_TGT = 2;
+
+	static Quad assign(OpdID dst, OpdID src){
+		return make(ASSIGN_QUAD, 0, dst, src, NO_OPD, 0);
+	}
+	static Quad binOp(OpdID dst, BinOp opr, OpdID src1, OpdID src2){
+		return make(BINOP_QUAD, opr, dst, src1, src2, 0);
+	}
+	static Quad unaryOp(OpdID dst, UnaryOp opr, OpdID src){
+		return make(UNARYOP_QUAD, opr, dst, src, NO_OPD, 0);
+	}
+	static Quad loc(OpdID src, OpdID tgt, bool srcIsLoc, bool tgtIsLoc){
+		uint8_t flags = static_cast<uint8_t>(
+			(srcIsLoc ? LOC_SRC : 0) | (tgtIsLoc ? LOC_TGT : 0));
+		return make(LOC_QUAD, flags, tgt, src, NO_OPD, 0);
+	}
+	static Quad jump(Label * tgt){
+		return make(GOTO_QUAD, 0, NO_OPD, NO_OPD, NO_OPD, tgt->getSlot());
+	}
+	static Quad ifz(OpdID cnd, Label * tgt){
+		return make(IFZ_QUAD, 0, NO_OPD, cnd, NO_OPD, tgt->getSlot());
+	}
+	static Quad nop(){
+		return make(NOP_QUAD, 0, NO_OPD, NO_OPD, NO_OPD, 0);
+	}
+	static Quad setArg(size_t index, OpdID src){
+		return make(SETARG_QUAD, 0, NO_OPD, src, NO_OPD,
+			static_cast<uint32_t>(index));
+	}
+	static Quad getArg(size_t index, OpdID dst){
+		return make(GETARG_QUAD, 0, dst, NO_OPD, NO_OPD,
+			static_cast<uint32_t>(index));
+	}
+	static Quad setRet(OpdID src){
+		return make(SETRET_QUAD, 0, NO_OPD, src, NO_OPD, 0);
+	}
+	static Quad getRet(OpdID dst){
+		return make(GETRET_QUAD, 0, dst, NO_OPD, NO_OPD, 0);
+	}
+	//Report, receive, call and phi quads also need an entry
+	// in one of the procedure's tables, so they are made by
+	// Procedure (see Procedure::report)
+	static Quad make(QuadKind kind, uint8_t op, OpdID dst,
+		OpdID src1, OpdID src2, uint32_t aux){
+		Quad res;
+		res.kind = kind;
+		res.op = op;
+		res.dst = dst;
+		res.src1 = src1;
+		res.src2 = src2;
+		res.aux = aux;
+		res.labels = 0;
+		res.comment = 0;
+		return res;
+	}
 
-class SetRetQuad : public Quad{
-public:
-	SetRetQuad(Opd * opdIn);
-	std::string repr() override;
-	Opd * getSrc(){ return opd; }
-private:
-	Opd * opd;
-};
+	BinOp binOp() const { return static_cast<BinOp>(op); }
+	UnaryOp unaryOp() const { return static_cast<UnaryOp>(op); }
+	bool srcIsLoc() const { return (op & LOC_SRC) != 0; }
+	bool tgtIsLoc() const { return (op & LOC_TGT) != 0; }
+	bool isJump() const { return kind == GOTO_QUAD || kind == IFZ_QUAD; }
+	//The slot of the label a goto or IFZ jumps to
+	uint32_t target() const { return aux; }
+	size_t argIndex() const { return aux; }
+	bool hasLabels() const { return labels != 0; }
+
+	//The operand slot this quad writes, if any, so that
+	// passes can inspect and rewrite it without knowing
+	// each quad's layout (Procedure::useSlots gives the
+	// slots it reads).
+	//An AddrOpd in the def slot of anything but a LOC quad
+	// is a store through the address it holds, not a def.
+	OpdID * defSlot(){
+		switch (kind){
+		case ASSIGN_QUAD: case BINOP_QUAD: case UNARYOP_QUAD:
+		case LOC_QUAD: case RECEIVE_QUAD: case PHI_QUAD:
+		case GETARG_QUAD: case GETRET_QUAD:
+			return &dst;
+		default:
+			return nullptr;
+		}
+	}
 
-class GetRetQuad : public Quad{
-public:
-	GetRetQuad(Opd * opdIn);
-	std::string repr() override;
-	Opd * getDst(){ return opd; }
-private:
-	Opd * opd;
+	static std::string oprString(BinOp opr);
 };
 
 class Procedure{
 public:
 	Procedure(IRProgram * prog, std::string name);
-	void addQuad(Quad * quad);
-	Quad * popQuad();
+	//Add quad to the end of the body, with lbl on it if
+	// there is one
+	void addQuad(const Quad& quad, Label * lbl = nullptr);
+	std::vector<Quad>& getQuads(){ return body; }
 	IRProgram * getProg();
-	std::list<SymOpd *> getFormals() { return formals; }
-	SymOpd * getFormal(size_t idx){
-		auto itr = formals.begin();
-		for (size_t i = 0; i < idx; i++, itr++);
-		return *itr;
-	}
+	const std::vector<OpdID>& getFormals() { return formals; }
 	cminusminus::Label * makeLabel();
+	size_t numLabels(){ return labelCount; }
+	//The label with the given slot
+	Label * getLabel(uint32_t slot){ return labels[slot]; }
+	//A string literal, named and kept by the program
+	OpdID makeString(std::string val);
+
+	//Labels and strings are numbered across the whole
+	// program, so while procedures are built or optimized
+	// side by side (see Workers) each holds on to its new
+	// ones: after holdNumbers(), they go unnumbered until
+	// number() is called. Calling number() on each
+	// procedure in turn then hands out the numbers they
+	// would have had if the procedures were done one at a
+	// time. A new procedure starts out holding.
+	void holdNumbers(){ holding = true; }
+	void number();
+	//Find where each label is in the body, so quadAt can
+	// answer without a search. Like a CFG, the index is a
+	// snapshot and has to be rebuilt once the quads change.
+	void indexLabels();
+	//The index in the body of the quad the label with slot
+	// lbl is on (the end of the body for the leave label),
+	// as of the last indexLabels()
+	size_t quadAt(uint32_t lbl);
+
+	//The operand table
+	Opd * opd(OpdID id){ return opds[id]; }
+	OpdKind kindOf(OpdID id){ return opds[id]->kind(); }
+	size_t numOpds(){ return opds.size(); }
+	OpdID gatherLocal(SemSymbol * sym);
+	OpdID gatherFormal(SemSymbol * sym);
+	OpdID getSymOpd(SemSymbol * sym);
+	//The entry for an operand of the whole program (a global
+	// or a string), added the first time it is used here
+	OpdID shareOpd(Opd * opd);
+	OpdID literal(int64_t val, size_t width);
+	OpdID makeTmp(size_t width);
+	OpdID makeAddrOpd(size_t width);
+	//The value of a literal operand
+	int64_t litVal(OpdID id){ return static_cast<LitOpd *>(opds[id])->intVal(); }
+
+	//The quads that need an entry in a side table
+	Quad report(OpdID src, const DataType * type);
+	Quad receive(OpdID dst, const DataType * type);
+	Quad call(SemSymbol * callee);
+	//A phi with a source for each of numPreds predecessors,
+	// all NO_OPD to begin with
+	Quad phi(OpdID dst, size_t numPreds);
+	const DataType * getType(const Quad& quad){ return types[quad.aux]; }
+	SemSymbol * getCallee(const Quad& quad){ return callees[quad.aux]; }
+	OpdID& phiSrc(const Quad& quad, size_t pred){
+		return phiSrcs[quad.aux + pred];
+	}
+	//The operand slots quad reads
+	UseSlots useSlots(Quad& quad);
+
+	//The labels on quad, and its comment ("" if none)
+	const std::vector<Label *>& labelsOf(const Quad& quad){
+		return labelLists[quad.labels];
+	}
+	void addLabel(Quad& quad, Label * lbl);
+	void clearLabels(Quad& quad){ quad.labels = 0; }
+	const std::string& commentOf(const Quad& quad){
+		return comments[quad.comment];
+	}
+	void setComment(Quad& quad, std::string comment);
 
-	void gatherLocal(SemSymbol * sym);
-	void gatherFormal(SemSymbol * sym);
-	SymOpd * getSymOpd(SemSymbol * sym);
-	AuxOpd * makeTmp(size_t width);
-	AddrOpd * makeAddrOpd(size_t width);
+	//Format quad (labels, the quad itself and, if verbose,
+	// its comment) straight into out, without a trailing
+	// newline
+	void writeQuad(std::ostream& out, const Quad& quad, bool verbose=false);
+	std::string repr(const Quad& quad);
 
+	void write(std::ostream& out, bool verbose=false);
 	std::string toString(bool verbose=false); 
 	std::string getName();
 
+	//Run the passes enabled at level (see IRProgram::optimize)
+	void optimize(unsigned int level);
+	//Fold constant operations and propagate constants
+	// through assignments (see 3ac_opt.cpp)
+	void foldConstants();
+	//Thread jumps, merge labels, and delete unreachable
+	// quads and jumps to the next quad (see 3ac_opt.cpp)
+	void cleanupJumps();
+	//Let temps whose values are never live at the same time
+	// share one slot (see 3ac_opt.cpp)
+	void shareTempSlots();
+	//Rename the locals and formals whose address is never
+	// taken into SSA values, with phis where control
+	// merges, and turn the phis back into copies (see
+	// ssa.cpp)
+	void toSSA();
+	void fromSSA();
+
+	void writeBinary(IRWriter& out);
+	static Procedure * readBinary(IRProgram * prog, IRReader& in);
+
+	//Write the procedure as x86-64 assembly (see x64.cpp)
+	void toX64(std::ostream& out, const std::set<Opd *>& globals);
+
 	cminusminus::Label * getLeaveLabel();
 private:
-	EnterQuad * enter;
-	LeaveQuad * leave;
+	OpdID addOpd(Opd * opd);
+	OpdID gatherSym(SemSymbol * sym);
+	Label * newLabel(uint32_t id);
+	void writeEnter(std::ostream& out);
+	void writeLeave(std::ostream& out);
+	//Keep the quads for which keep(quad) is true, in order.
+	// Passes delete quads through this, in one pass over
+	// the body, rather than erasing them one at a time.
+	template <typename Keep>
+	void keepQuads(Keep keep){
+		size_t to = 0;
+		for (size_t from = 0; from < body.size(); from++){
+			if (keep(body[from])){ body[to++] = body[from]; }
+		}
+		body.resize(to);
+	}
+	//Delete the quads whose entry in drop is set
+	void dropQuads(const std::vector<bool>& drop){
+		size_t idx = 0;
+		keepQuads([&](const Quad&){ return !drop[idx++]; });
+	}
+
+	Label * enterLabel;
 	Label * leaveLabel;
 
 	IRProgram * myProg;
-	std::map<SemSymbol *, SymOpd *> locals;
-	std::list<AuxOpd *> temps; 
-	std::list<SymOpd *> formals; 
-	std::list<AddrOpd *> addrOpds;
-	std::list<Quad *> * bodyQuads;
+	std::vector<Quad> body;
+	//The operand table, and the indices of the operands
+	// that are made once and looked up again: globals,
+	// strings read back from binary 3AC, and literals
+	std::vector<Opd *> opds;
+	HashMap<Opd *, OpdID> sharedIDs;
+	std::map<std::pair<int64_t, size_t>, OpdID> litIDs;
+	//Every formal and local, indexed by its symbol's slot
+	std::vector<OpdID> symOpds;
+	//Locals in declaration order, for printing
+	std::vector<OpdID> localsInOrder;
+	std::vector<OpdID> temps;
+	std::vector<OpdID> formals;
+	std::vector<OpdID> addrOpds;
+
+	//The side tables. The first entry of labelLists and
+	// comments is the empty one every quad starts with.
+	std::vector<std::vector<Label *>> labelLists;
+	std::vector<std::string> comments;
+	std::vector<OpdID> phiSrcs;
+	std::vector<const DataType *> types;
+	HashMap<const DataType *, uint32_t> typeIDs;
+	std::vector<SemSymbol *> callees;
+	HashMap<SemSymbol *, uint32_t> calleeIDs;
+
 	std::string myName;
 	size_t maxTmp;
+	uint32_t labelCount = 0;
+	//Every label made here, by slot
+	std::vector<Label *> labels;
+	bool holding = true;
+	std::vector<Label *> heldLabels;
+	std::vector<std::pair<StringOpd *, std::string>> heldStrings;
+	//The label index, by slot
+	std::vector<size_t> labelPos;
+	std::vector<bool> labelPlaced;
 };
 
 class IRProgram{
@@ -358,22 +543,58 @@ public:
 	}
 	Procedure * makeProc(std::string name);
 	std::list<Procedure *> * getProcs();
-	Label * makeLabel();
-	Opd * makeString(std::string val);
+	//A new program-wide label number (see Procedure::makeLabel)
+	uint32_t nextLabelID(){ return static_cast<uint32_t>(max_label++); }
+	//Give opd the next string name, and keep its value
+	void addString(StringOpd * opd, std::string val);
 	void gatherGlobal(SemSymbol * sym);
 	SymOpd * getGlobal(SemSymbol * sym);
 	size_t opWidth(ASTNode * node);
 	const DataType * nodeType(ASTNode * node);
 	std::set<Opd *> globalSyms();
 
+	//Stream the program one quad at a time; toString()
+	// is only meant for small programs and debugging
+	void write(std::ostream& out, bool verbose=false);
 	std::string toString(bool verbose=false);
+
+	//Run the optimization passes enabled at level on every
+	// procedure, side by side on workers. Level 0 leaves
+	// the program as lowered.
+	void optimize(unsigned int level, Workers& workers);
+
+	//The same program in a compact binary form (see
+	// 3ac_binary.cpp), which can be loaded back without
+	// running the front end. A loaded program has no
+	// TypeAnalysis, so nodeType() can't be used on it.
+	//readBinary reads size bytes from data, which needn't
+	// outlive the call.
+	void writeBinary(std::ostream& out);
+	static IRProgram * readBinary(const char * data, size_t size);
+
+	//The whole program as a GNU assembler file for x86-64
+	// Linux, runtime included, that links into an
+	// executable on its own (see x64.cpp)
+	void toX64(std::ostream& out);
+
+	//Each procedure's control-flow graph, for debugging the
+	// passes that use it (see cfg.cpp)
+	void writeCFGs(std::ostream& out);
+
+	//Translate the program to bytecode and run it on the
+	// interpreter (see interp.cpp), returning what main
+	// returned
+	int64_t run();
 private:
 	TypeAnalysis * ta;
 	size_t max_label = 0;
 	size_t str_idx = 0;
 	std::list<Procedure *> * procs; 
-	HashMap<StringOpd *, std::string> strings;
-	std::map<SemSymbol *, SymOpd *> globals;
+	//String literals, in the order they were named
+	std::vector<std::pair<StringOpd *, std::string>> strings;
+	HashMap<SemSymbol *, SymOpd *> globals;
+	//Globals in declaration order, for printing
+	std::list<SymOpd *> globalsInOrder;
 };
 
 }
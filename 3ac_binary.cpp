@@ -0,0 +1,607 @@
+#include <cstring>
+#include <vector>
+#include "3ac.hpp"
+
+//The binary 3AC format. All integers are little-endian,
+// strings are a u32 length followed by their bytes.
+//
+//  program:   "C3AC" u32:version u32:max_label u32:str_idx
+//             u32:#globals (str:name type)*
+//             u32:#strings (str:name str:value)*
+//             u32:#procs proc*
+//  proc:      str:name
+//             u32:#labels u32:id*  u32:leaveLabel
+//             u32:#formals (str:name type)*
+//             u32:#locals (str:name type)*
+//             u32:#temps (str:name u8:width)*
+//             u32:#addrOpds (str:name u8:width)*
+//             u32:#quads quad*
+//  quad:      u8:opcode u8:#labels u32:label* str:comment
+//             operands (depending on the opcode)
+//  opd:       u8:kind, then u32:index into the table for that
+//             kind, or i64:value u8:width for a literal
+//  type:      u8:kind, then u8:base for a basic type, the
+//             pointee for a pointer, or the return type,
+//             u32:#formals and formal types for a function
+
+namespace cminusminus{
+
+static const char IR_MAGIC[4] = {'C', '3', 'A', 'C'};
+static const uint32_t IR_VERSION = 2;
+
+enum IROpcode : uint8_t {
+	OP_BINOP, OP_UNARYOP, OP_ASSIGN, OP_LOC, OP_GOTO, OP_IFZ,
+	OP_NOP, OP_REPORT, OP_RECEIVE, OP_CALL, OP_SETARG,
+	OP_GETARG, OP_SETRET, OP_GETRET
+};
+
+enum IROpdKind : uint8_t {
+	OPD_GLOBAL, OPD_STRING, OPD_FORMAL, OPD_LOCAL,
+	OPD_TMP, OPD_ADDR, OPD_LIT
+};
+
+enum IRTypeKind : uint8_t {
+	TY_BASIC, TY_PTR, TY_FN, TY_ERROR
+};
+
+class IRWriter{
+public:
+	IRWriter(std::ostream& outIn) : out(outIn){ }
+
+	void u8(uint8_t v){ out.put(static_cast<char>(v)); }
+	void u32(uint32_t v){
+		char buf[4];
+		for (int i = 0; i < 4; i++){
+			buf[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+		}
+		out.write(buf, 4);
+	}
+	void i64(int64_t v){
+		uint64_t bits = static_cast<uint64_t>(v);
+		char buf[8];
+		for (int i = 0; i < 8; i++){
+			buf[i] = static_cast<char>((bits >> (8 * i)) & 0xff);
+		}
+		out.write(buf, 8);
+	}
+	void count(size_t v){ u32(static_cast<uint32_t>(v)); }
+	void str(const std::string& s){
+		count(s.length());
+		out.write(s.data(), static_cast<std::streamsize>(s.length()));
+	}
+
+	void type(const DataType * t){
+		if (const BasicType * basic = t->asBasic()){
+			u8(TY_BASIC);
+			u8(static_cast<uint8_t>(basic->getBaseType()));
+		} else if (const PtrType * ptr = t->asPtr()){
+			u8(TY_PTR);
+			type(ptr->baseType());
+		} else if (const FnType * fn = t->asFn()){
+			u8(TY_FN);
+			type(fn->getReturnType());
+			count(fn->getFormalTypes()->size());
+			for (auto formal : *fn->getFormalTypes()){
+				type(formal);
+			}
+		} else {
+			u8(TY_ERROR);
+		}
+	}
+
+	void opd(Opd * o){
+		auto found = opds.find(o);
+		if (found != opds.end()){
+			u8(found->second.first);
+			u32(found->second.second);
+			return;
+		}
+		//Anything not in a table is a literal
+		LitOpd * lit = irCast<LitOpd>(o);
+		if (lit == nullptr){
+			throw new InternalError("Unknown operand in binary 3AC");
+		}
+		u8(OPD_LIT);
+		i64(lit->intVal());
+		u8(static_cast<uint8_t>(lit->getWidth()));
+	}
+
+	void label(Label * lbl){
+		auto found = labels.find(lbl);
+		if (found == labels.end()){
+			throw new InternalError("Unknown label in binary 3AC");
+		}
+		u32(found->second);
+	}
+
+	std::ostream& out;
+	//Where each operand and label in scope lives in the
+	// tables already written out
+	HashMap<Opd *, std::pair<IROpdKind, uint32_t>> opds;
+	HashMap<Label *, uint32_t> labels;
+};
+
+class IRReader{
+public:
+	IRReader(const char * bufIn, size_t sizeIn)
+	: buf(bufIn), size(sizeIn), pos(0){ }
+
+	uint8_t u8(){
+		need(1);
+		return static_cast<uint8_t>(buf[pos++]);
+	}
+	uint32_t u32(){
+		need(4);
+		uint32_t v = 0;
+		for (int i = 0; i < 4; i++){
+			v |= static_cast<uint32_t>(
+				static_cast<uint8_t>(buf[pos++])) << (8 * i);
+		}
+		return v;
+	}
+	int64_t i64(){
+		need(8);
+		uint64_t v = 0;
+		for (int i = 0; i < 8; i++){
+			v |= static_cast<uint64_t>(
+				static_cast<uint8_t>(buf[pos++])) << (8 * i);
+		}
+		return static_cast<int64_t>(v);
+	}
+	std::string str(){
+		uint32_t len = u32();
+		need(len);
+		std::string res(buf + pos, len);
+		pos += len;
+		return res;
+	}
+	bool magic(){
+		need(sizeof(IR_MAGIC));
+		bool ok = memcmp(buf + pos, IR_MAGIC, sizeof(IR_MAGIC)) == 0;
+		pos += sizeof(IR_MAGIC);
+		return ok;
+	}
+
+	const DataType * type(){
+		switch (u8()){
+		case TY_BASIC: {
+			uint8_t base = u8();
+			if (base > BaseType::SHORT){ bad("base type"); }
+			return BasicType::produce(static_cast<BaseType>(base));
+		}
+		case TY_PTR:
+			return PtrType::produce(type());
+		case TY_FN: {
+			const DataType * ret = type();
+			std::list<const DataType *> formals;
+			for (uint32_t i = u32(); i > 0; i--){
+				formals.push_back(type());
+			}
+			return FnType::produce(formals, ret);
+		}
+		case TY_ERROR:
+			return ErrorType::produce();
+		}
+		bad("type");
+		return nullptr;
+	}
+
+	//An operand of proc, read as an entry of its operand
+	// table
+	OpdID opd(Procedure * proc){
+		uint8_t kind = u8();
+		if (kind == OPD_LIT){
+			int64_t val = i64();
+			return proc->literal(val, u8());
+		}
+		if (kind >= OPD_LIT){ bad("operand kind"); }
+		uint32_t idx = u32();
+		if (kind == OPD_GLOBAL || kind == OPD_STRING){
+			std::vector<Opd *>& table = shared[kind];
+			if (idx >= table.size()){ bad("operand"); }
+			return proc->shareOpd(table[idx]);
+		}
+		std::vector<OpdID>& table = opds[kind];
+		if (idx >= table.size()){ bad("operand"); }
+		return table[idx];
+	}
+
+	Label * label(){
+		uint32_t idx = u32();
+		if (idx >= labels.size()){ bad("label"); }
+		return labels[idx];
+	}
+
+	//Functions are only referred to by the calls to them,
+	// so one symbol is made per callee name
+	SemSymbol * callee(const std::string& name, const DataType * type){
+		auto found = callees.find(name);
+		if (found != callees.end()){ return found->second; }
+		if (type->asFn() == nullptr){ bad("callee type"); }
+		SemSymbol * sym = new FnSymbol(Interner::intern(name), type->asFn());
+		callees[name] = sym;
+		return sym;
+	}
+
+	[[noreturn]] void bad(const char * what){
+		std::string msg = "Bad binary 3AC file (";
+		msg += what;
+		msg += ")";
+		throw new UserError(msg.c_str());
+	}
+
+	//The globals and strings, and the operands of the
+	// procedure being read, by kind
+	std::vector<Opd *> shared[OPD_FORMAL];
+	std::vector<OpdID> opds[OPD_LIT];
+	std::vector<Label *> labels;
+private:
+	void need(size_t n){
+		if (size - pos < n){ bad("truncated"); }
+	}
+
+	const char * buf;
+	size_t size;
+	size_t pos;
+	HashMap<std::string, SemSymbol *> callees;
+};
+
+static IROpcode opcodeOf(const Quad& quad){
+	switch (quad.kind){
+	case BINOP_QUAD: return OP_BINOP;
+	case UNARYOP_QUAD: return OP_UNARYOP;
+	case ASSIGN_QUAD: return OP_ASSIGN;
+	case LOC_QUAD: return OP_LOC;
+	case GOTO_QUAD: return OP_GOTO;
+	case IFZ_QUAD: return OP_IFZ;
+	case NOP_QUAD: return OP_NOP;
+	case REPORT_QUAD: return OP_REPORT;
+	case RECEIVE_QUAD: return OP_RECEIVE;
+	case CALL_QUAD: return OP_CALL;
+	case SETARG_QUAD: return OP_SETARG;
+	case GETARG_QUAD: return OP_GETARG;
+	case SETRET_QUAD: return OP_SETRET;
+	case GETRET_QUAD: return OP_GETRET;
+	default: break;
+	}
+	throw new InternalError("Quad with no binary 3AC form");
+}
+
+static void writeBinaryQuad(IRWriter& out, Procedure * proc, const Quad& quad){
+	IROpcode op = opcodeOf(quad);
+	out.u8(op);
+	out.u8(static_cast<uint8_t>(proc->labelsOf(quad).size()));
+	for (auto lbl : proc->labelsOf(quad)){
+		out.label(lbl);
+	}
+	out.str(proc->commentOf(quad));
+
+	switch (op){
+	case OP_BINOP:
+		out.u8(static_cast<uint8_t>(quad.binOp()));
+		out.opd(proc->opd(quad.dst));
+		out.opd(proc->opd(quad.src1));
+		out.opd(proc->opd(quad.src2));
+		break;
+	case OP_UNARYOP:
+		out.u8(static_cast<uint8_t>(quad.unaryOp()));
+		out.opd(proc->opd(quad.dst));
+		out.opd(proc->opd(quad.src1));
+		break;
+	case OP_ASSIGN:
+		out.opd(proc->opd(quad.dst));
+		out.opd(proc->opd(quad.src1));
+		break;
+	case OP_LOC:
+		out.opd(proc->opd(quad.src1));
+		out.opd(proc->opd(quad.dst));
+		out.u8(quad.srcIsLoc());
+		out.u8(quad.tgtIsLoc());
+		break;
+	case OP_GOTO:
+		out.label(proc->getLabel(quad.target()));
+		break;
+	case OP_IFZ:
+		out.opd(proc->opd(quad.src1));
+		out.label(proc->getLabel(quad.target()));
+		break;
+	case OP_NOP:
+		break;
+	case OP_REPORT:
+		out.opd(proc->opd(quad.src1));
+		out.type(proc->getType(quad));
+		break;
+	case OP_RECEIVE:
+		out.opd(proc->opd(quad.dst));
+		out.type(proc->getType(quad));
+		break;
+	case OP_CALL: {
+		SemSymbol * callee = proc->getCallee(quad);
+		out.str(callee->getName());
+		out.type(callee->getDataType());
+		break;
+	}
+	case OP_SETARG:
+		out.count(quad.argIndex());
+		out.opd(proc->opd(quad.src1));
+		break;
+	case OP_GETARG:
+		out.count(quad.argIndex());
+		out.opd(proc->opd(quad.dst));
+		break;
+	case OP_SETRET:
+		out.opd(proc->opd(quad.src1));
+		break;
+	case OP_GETRET:
+		out.opd(proc->opd(quad.dst));
+		break;
+	}
+}
+
+static void readBinaryQuad(IRReader& in, Procedure * proc){
+	uint8_t op = in.u8();
+	std::list<Label *> labels;
+	for (uint8_t i = in.u8(); i > 0; i--){
+		labels.push_back(in.label());
+	}
+	std::string comment = in.str();
+
+	Quad quad;
+	switch (op){
+	case OP_BINOP: {
+		uint8_t opr = in.u8();
+		if (opr > OR64){ in.bad("binary operator"); }
+		OpdID dst = in.opd(proc);
+		OpdID src1 = in.opd(proc);
+		OpdID src2 = in.opd(proc);
+		quad = Quad::binOp(dst, static_cast<BinOp>(opr), src1, src2);
+		break;
+	}
+	case OP_UNARYOP: {
+		uint8_t opr = in.u8();
+		if (opr > NOT8){ in.bad("unary operator"); }
+		OpdID dst = in.opd(proc);
+		OpdID src = in.opd(proc);
+		quad = Quad::unaryOp(dst, static_cast<UnaryOp>(opr), src);
+		break;
+	}
+	case OP_ASSIGN: {
+		OpdID dst = in.opd(proc);
+		OpdID src = in.opd(proc);
+		quad = Quad::assign(dst, src);
+		break;
+	}
+	case OP_LOC: {
+		OpdID src = in.opd(proc);
+		OpdID tgt = in.opd(proc);
+		bool srcLoc = in.u8() != 0;
+		bool tgtLoc = in.u8() != 0;
+		quad = Quad::loc(src, tgt, srcLoc, tgtLoc);
+		break;
+	}
+	case OP_GOTO:
+		quad = Quad::jump(in.label());
+		break;
+	case OP_IFZ: {
+		OpdID cnd = in.opd(proc);
+		quad = Quad::ifz(cnd, in.label());
+		break;
+	}
+	case OP_NOP:
+		quad = Quad::nop();
+		break;
+	case OP_REPORT: {
+		OpdID src = in.opd(proc);
+		quad = proc->report(src, in.type());
+		break;
+	}
+	case OP_RECEIVE: {
+		OpdID dst = in.opd(proc);
+		quad = proc->receive(dst, in.type());
+		break;
+	}
+	case OP_CALL: {
+		std::string name = in.str();
+		quad = proc->call(in.callee(name, in.type()));
+		break;
+	}
+	case OP_SETARG: {
+		size_t idx = in.u32();
+		quad = Quad::setArg(idx, in.opd(proc));
+		break;
+	}
+	case OP_GETARG: {
+		size_t idx = in.u32();
+		quad = Quad::getArg(idx, in.opd(proc));
+		break;
+	}
+	case OP_SETRET:
+		quad = Quad::setRet(in.opd(proc));
+		break;
+	case OP_GETRET:
+		quad = Quad::getRet(in.opd(proc));
+		break;
+	default:
+		in.bad("opcode");
+	}
+
+	for (auto lbl : labels){
+		proc->addLabel(quad, lbl);
+	}
+	proc->setComment(quad, comment);
+	proc->addQuad(quad);
+}
+
+void Procedure::writeBinary(IRWriter& out){
+	out.str(myName);
+
+	//Every label a quad carries or jumps to, in order
+	// of first appearance
+	std::vector<Label *> lbls;
+	auto addLabel = [&](Label * lbl){
+		if (out.labels.find(lbl) == out.labels.end()){
+			out.labels[lbl] = static_cast<uint32_t>(lbls.size());
+			lbls.push_back(lbl);
+		}
+	};
+	out.labels.clear();
+	addLabel(leaveLabel);
+	for (auto& quad : body){
+		for (auto lbl : labelsOf(quad)){ addLabel(lbl); }
+		if (quad.isJump()){ addLabel(labels[quad.target()]); }
+	}
+	out.count(lbls.size());
+	for (auto lbl : lbls){
+		out.u32(lbl->getID());
+	}
+	out.label(leaveLabel);
+
+	uint32_t idx = 0;
+	out.count(formals.size());
+	for (auto formal : formals){
+		SymOpd * sym = static_cast<SymOpd *>(opds[formal]);
+		out.opds[sym] = std::make_pair(OPD_FORMAL, idx++);
+		out.str(sym->getName());
+		out.type(sym->getSym()->getDataType());
+	}
+	idx = 0;
+	out.count(localsInOrder.size());
+	for (auto local : localsInOrder){
+		SymOpd * sym = static_cast<SymOpd *>(opds[local]);
+		out.opds[sym] = std::make_pair(OPD_LOCAL, idx++);
+		out.str(sym->getName());
+		out.type(sym->getSym()->getDataType());
+	}
+	idx = 0;
+	out.count(temps.size());
+	for (auto tmp : temps){
+		out.opds[opds[tmp]] = std::make_pair(OPD_TMP, idx++);
+		out.str(opds[tmp]->locString());
+		out.u8(static_cast<uint8_t>(opds[tmp]->getWidth()));
+	}
+	idx = 0;
+	out.count(addrOpds.size());
+	for (auto addr : addrOpds){
+		AddrOpd * opd = static_cast<AddrOpd *>(opds[addr]);
+		out.opds[opd] = std::make_pair(OPD_ADDR, idx++);
+		out.str(opd->getName());
+		out.u8(static_cast<uint8_t>(opd->getWidth()));
+	}
+
+	out.count(body.size());
+	for (auto& quad : body){
+		writeBinaryQuad(out, this, quad);
+	}
+
+	for (auto formal : formals){ out.opds.erase(opds[formal]); }
+	for (auto local : localsInOrder){ out.opds.erase(opds[local]); }
+	for (auto tmp : temps){ out.opds.erase(opds[tmp]); }
+	for (auto addr : addrOpds){ out.opds.erase(opds[addr]); }
+}
+
+Procedure * Procedure::readBinary(IRProgram * prog, IRReader& in){
+	Procedure * proc = prog->makeProc(in.str());
+
+	in.labels.clear();
+	for (uint32_t i = in.u32(); i > 0; i--){
+		in.labels.push_back(proc->newLabel(in.u32()));
+	}
+	//Replace the leave label the constructor made with the
+	// one the quads refer to
+	proc->leaveLabel = in.label();
+
+	for (int kind = OPD_FORMAL; kind <= OPD_ADDR; kind++){
+		in.opds[kind].clear();
+	}
+	for (uint32_t i = in.u32(); i > 0; i--){
+		std::string name = in.str();
+		SemSymbol * sym = new VarSymbol(Interner::intern(name), in.type());
+		in.opds[OPD_FORMAL].push_back(proc->gatherFormal(sym));
+	}
+	for (uint32_t i = in.u32(); i > 0; i--){
+		std::string name = in.str();
+		SemSymbol * sym = new VarSymbol(Interner::intern(name), in.type());
+		in.opds[OPD_LOCAL].push_back(proc->gatherLocal(sym));
+	}
+	for (uint32_t i = in.u32(); i > 0; i--){
+		std::string name = in.str();
+		OpdID opd = proc->addOpd(new AuxOpd(name, in.u8()));
+		proc->temps.push_back(opd);
+		in.opds[OPD_TMP].push_back(opd);
+	}
+	for (uint32_t i = in.u32(); i > 0; i--){
+		std::string name = in.str();
+		OpdID opd = proc->addOpd(new AddrOpd(name, in.u8()));
+		proc->addrOpds.push_back(opd);
+		in.opds[OPD_ADDR].push_back(opd);
+	}
+	proc->maxTmp = proc->temps.size() + proc->addrOpds.size();
+
+	for (uint32_t i = in.u32(); i > 0; i--){
+		readBinaryQuad(in, proc);
+	}
+	return proc;
+}
+
+void IRProgram::writeBinary(std::ostream& stream){
+	IRWriter out(stream);
+	stream.write(IR_MAGIC, sizeof(IR_MAGIC));
+	out.u32(IR_VERSION);
+	out.count(max_label);
+	out.count(str_idx);
+
+	uint32_t idx = 0;
+	out.count(globalsInOrder.size());
+	for (auto global : globalsInOrder){
+		out.opds[global] = std::make_pair(OPD_GLOBAL, idx++);
+		out.str(global->getName());
+		out.type(global->getSym()->getDataType());
+	}
+	idx = 0;
+	out.count(strings.size());
+	for (auto entry : strings){
+		out.opds[entry.first] = std::make_pair(OPD_STRING, idx++);
+		out.str(entry.first->getName());
+		out.str(entry.second);
+	}
+
+	out.count(procs->size());
+	for (auto proc : *procs){
+		proc->writeBinary(out);
+	}
+}
+
+IRProgram * IRProgram::readBinary(const char * data, size_t size){
+	IRReader in(data, size);
+	if (!in.magic()){ in.bad("not a binary 3AC file"); }
+	if (in.u32() != IR_VERSION){ in.bad("version"); }
+
+	IRProgram * prog = new IRProgram(nullptr);
+	prog->max_label = in.u32();
+	prog->str_idx = in.u32();
+
+	for (uint32_t i = in.u32(); i > 0; i--){
+		std::string name = in.str();
+		SemSymbol * sym = new VarSymbol(Interner::intern(name), in.type());
+		prog->gatherGlobal(sym);
+		in.shared[OPD_GLOBAL].push_back(prog->globalsInOrder.back());
+	}
+	for (uint32_t i = in.u32(); i > 0; i--){
+		std::string name = in.str();
+		StringOpd * opd = new StringOpd(name, 1);
+		prog->strings.push_back(std::make_pair(opd, in.str()));
+		in.shared[OPD_STRING].push_back(opd);
+	}
+
+	//Numbering the procedures takes a label for each (the
+	// one their constructor made, which reading replaces),
+	// so put the counter back afterwards
+	size_t maxLabel = prog->max_label;
+	for (uint32_t i = in.u32(); i > 0; i--){
+		Procedure::readBinary(prog, in)->number();
+	}
+	prog->max_label = maxLabel;
+	return prog;
+}
+
+}
@@ -0,0 +1,463 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "3ac.hpp"
+#include "cfg.hpp"
+#include "liveness.hpp"
+#include "workers.hpp"
+
+namespace cminusminus{
+
+void IRProgram::optimize(unsigned int level, Workers& workers){
+	if (level == 0){ return; }
+	std::vector<Procedure *> order(procs->begin(), procs->end());
+	for (auto proc : order){
+		proc->holdNumbers();
+	}
+	workers.concurrently(order.size(), [&](size_t i){
+		order[i]->optimize(level);
+	});
+	workers.flush();
+	for (auto proc : order){
+		proc->number();
+	}
+}
+
+void Procedure::optimize(unsigned int level){
+	if (level == 0){ return; }
+	foldConstants();
+	cleanupJumps();
+	if (level >= 2){
+		//Going through SSA gives each write to a local its
+		// own temp, which folding and slot sharing can then
+		// treat like any other.
+		//Nothing may run between the two: fromSSA makes a
+		// block's phi copies one after another, which is only
+		// right while no phi reads another's result, and any
+		// pass that merged versions could break that.
+		toSSA();
+		fromSSA();
+		foldConstants();
+		shareTempSlots();
+		cleanupJumps();
+	}
+}
+
+//to, with the labels and comment of from, so that it can
+// take from's place in the body
+static Quad replaces(Quad to, const Quad& from){
+	to.labels = from.labels;
+	to.comment = from.comment;
+	return to;
+}
+
+static bool foldBinOp(BinOp opr, int64_t a, int64_t b, int64_t& res){
+	//Arithmetic wraps around, as it does in a 64-bit register
+	uint64_t ua = static_cast<uint64_t>(a);
+	uint64_t ub = static_cast<uint64_t>(b);
+	switch (opr){
+	case ADD64: res = static_cast<int64_t>(ua + ub); return true;
+	case SUB64: res = static_cast<int64_t>(ua - ub); return true;
+	case MULT64: res = static_cast<int64_t>(ua * ub); return true;
+	case DIV64:
+		//Leave a division that would trap for run time
+		if (b == 0){ return false; }
+		if (b == -1 && a == INT64_MIN){ return false; }
+		res = a / b;
+		return true;
+	case EQ64: res = a == b; return true;
+	case NEQ64: res = a != b; return true;
+	case LT64: res = a < b; return true;
+	case GT64: res = a > b; return true;
+	case LTE64: res = a <= b; return true;
+	case GTE64: res = a >= b; return true;
+	case AND64: res = a & b; return true;
+	case OR64: res = a | b; return true;
+	}
+	return false;
+}
+
+static int64_t foldUnaryOp(UnaryOp opr, int64_t a){
+	switch (opr){
+	case NEG64: return static_cast<int64_t>(0 - static_cast<uint64_t>(a));
+	case NOT8: return a == 0;
+	}
+	return 0;
+}
+
+//Constants are tracked within a run of quads that can't
+// be entered from anywhere but its top, so a quad with a
+// label forgets everything known so far. The exception is
+// an operand with only one definition in the whole body,
+// which sets it to a constant: it holds that constant
+// wherever the definition dominates, whatever the path
+// taken there. After toSSA every version of a local is
+// like that, so a local set once before a loop is known
+// inside the loop too.
+//Only temps and the locals and formals whose address is
+// never taken are tracked: nothing else can change them
+// behind the procedure's back.
+void Procedure::foldConstants(){
+	//Literals made below are never tracked or defined, so
+	// these only need to cover the operands there are now
+	std::vector<bool> tracked(opds.size(), false);
+	for (OpdID tmp : temps){ tracked[tmp] = true; }
+	for (OpdID formal : formals){ tracked[formal] = true; }
+	for (OpdID local : localsInOrder){ tracked[local] = true; }
+	for (auto& quad : body){
+		if (quad.kind == LOC_QUAD && quad.srcIsLoc()){
+			tracked[quad.src1] = false;
+		}
+	}
+
+	std::vector<size_t> defCount(opds.size(), 0);
+	for (auto& quad : body){
+		OpdID * def = quad.defSlot();
+		if (def != nullptr){ defCount[*def]++; }
+	}
+	//The quads below are only replaced or deleted, which
+	// can take edges out of the CFG but never add any, so
+	// a block that dominates another still does
+	CFG cfg(this);
+	auto isLit = [&](OpdID opd){ return kindOf(opd) == LIT_OPD; };
+
+	HashMap<OpdID, int64_t> consts;
+	//The operands defined once, with the constant they are
+	// set to and the block that does it
+	HashMap<OpdID, std::pair<int64_t, BasicBlock *>> setOnce;
+	std::vector<Quad> folded;
+	folded.reserve(body.size());
+	//Nothing can fall through a goto, so whatever follows
+	// it without a label can never run
+	bool afterGoto = false;
+	for (auto block : cfg.blocks()){
+		for (size_t i = block->begin(); i != block->end(); i++){
+			Quad quad = body[i];
+			if (quad.hasLabels()){
+				consts.clear();
+				afterGoto = false;
+			}
+			if (afterGoto){ continue; }
+
+			for (OpdID * use : useSlots(quad)){
+				auto known = consts.find(*use);
+				if (known != consts.end()){
+					*use = literal(known->second, opds[*use]->getWidth());
+					continue;
+				}
+				auto once = setOnce.find(*use);
+				if (once != setOnce.end()
+					&& cfg.dominates(once->second.second, block)){
+					*use = literal(once->second.first, opds[*use]->getWidth());
+				}
+			}
+
+			if (quad.kind == BINOP_QUAD){
+				int64_t res;
+				if (isLit(quad.src1) && isLit(quad.src2)
+					&& foldBinOp(quad.binOp(), litVal(quad.src1),
+						litVal(quad.src2), res)){
+					OpdID lit = literal(res, opds[quad.dst]->getWidth());
+					quad = replaces(Quad::assign(quad.dst, lit), quad);
+				}
+			} else if (quad.kind == UNARYOP_QUAD){
+				if (isLit(quad.src1)){
+					int64_t res = foldUnaryOp(quad.unaryOp(), litVal(quad.src1));
+					OpdID lit = literal(res, opds[quad.dst]->getWidth());
+					quad = replaces(Quad::assign(quad.dst, lit), quad);
+				}
+			} else if (quad.kind == IFZ_QUAD){
+				if (isLit(quad.src1)){
+					if (litVal(quad.src1) == 0){
+						quad = replaces(Quad::jump(labels[quad.target()]), quad);
+					} else if (!quad.hasLabels()){
+						continue;
+					} else {
+						quad = replaces(Quad::nop(), quad);
+					}
+				}
+			}
+
+			OpdID * def = quad.defSlot();
+			if (def != nullptr){
+				bool lit = quad.kind == ASSIGN_QUAD && isLit(quad.src1);
+				if (lit && tracked[*def]){
+					consts[*def] = litVal(quad.src1);
+					if (defCount[*def] == 1){
+						setOnce[*def] = std::make_pair(litVal(quad.src1), block);
+					}
+				} else {
+					consts.erase(*def);
+				}
+			}
+			folded.push_back(quad);
+
+			if (quad.kind == GOTO_QUAD){
+				consts.clear();
+				afterGoto = true;
+			}
+		}
+	}
+	body.swap(folded);
+
+	//Propagation leaves behind assignments to temps that
+	// nothing reads any more. Computing a temp has no other
+	// effect, so those go, along with the temps themselves.
+	std::vector<size_t> uses(opds.size(), 0);
+	for (auto& quad : body){
+		for (OpdID * use : useSlots(quad)){ uses[*use]++; }
+	}
+	bool changed = true;
+	while (changed){
+		changed = false;
+		for (auto& quad : body){
+			bool pure = quad.kind == ASSIGN_QUAD
+				|| quad.kind == BINOP_QUAD
+				|| quad.kind == UNARYOP_QUAD
+				|| quad.kind == LOC_QUAD;
+			if (!pure || kindOf(quad.dst) != AUX_OPD || uses[quad.dst] > 0){
+				continue;
+			}
+			for (OpdID * use : useSlots(quad)){ uses[*use]--; }
+			quad = replaces(Quad::nop(), quad);
+			changed = true;
+		}
+	}
+	keepQuads([](const Quad& quad){
+		return quad.kind != NOP_QUAD || quad.hasLabels();
+	});
+	std::vector<bool> referenced(opds.size(), false);
+	for (auto& quad : body){
+		for (OpdID * use : useSlots(quad)){ referenced[*use] = true; }
+		if (quad.defSlot() != nullptr){ referenced[*quad.defSlot()] = true; }
+	}
+	temps.erase(std::remove_if(temps.begin(), temps.end(),
+		[&](OpdID tmp){ return !referenced[tmp]; }), temps.end());
+}
+
+//Each step below can open up chances for the others (a
+// deleted jump leaves a label with nothing jumping to it,
+// which leaves a nop to merge away), so they are repeated
+// until none of them finds anything to do
+void Procedure::cleanupJumps(){
+	bool changed = true;
+	while (changed){
+		changed = false;
+
+		//Give every quad at most one label, and move the
+		// labels of a nop onto the quad after it (or the
+		// leave quad, if it is last). The labels dropped are
+		// mapped to the one kept in their place.
+		std::vector<uint32_t> alias(labelCount, Label::NONE);
+		std::vector<bool> drop(body.size(), false);
+		for (size_t i = 0; i < body.size(); i++){
+			if (!body[i].hasLabels()){ continue; }
+			std::vector<Label *> lbls = labelsOf(body[i]);
+			Label * keep = lbls.front();
+			bool isNop = body[i].kind == NOP_QUAD;
+			if (isNop && i + 1 == body.size()){
+				keep = leaveLabel;
+			} else if (isNop && body[i + 1].hasLabels()){
+				keep = labelsOf(body[i + 1]).front();
+			} else if (isNop){
+				addLabel(body[i + 1], keep);
+			}
+			for (auto lbl : lbls){
+				if (lbl != keep){ alias[lbl->getSlot()] = keep->getSlot(); }
+			}
+			if (isNop){
+				drop[i] = true;
+				changed = true;
+			} else if (lbls.size() > 1){
+				clearLabels(body[i]);
+				addLabel(body[i], keep);
+				changed = true;
+			}
+		}
+		dropQuads(drop);
+
+		indexLabels();
+
+		//Retarget jumps through the labels merged away, and
+		// thread jumps to a goto straight to where it goes
+		auto resolve = [&](uint32_t lbl){
+			while (alias[lbl] != Label::NONE){
+				lbl = alias[lbl];
+			}
+			return lbl;
+		};
+		for (auto& quad : body){
+			if (!quad.isJump()){ continue; }
+			uint32_t orig = quad.target();
+			uint32_t tgt = resolve(orig);
+			//A cycle of gotos never leaves, so stop following
+			// after as many hops as there are quads
+			for (size_t hops = 0; hops < body.size(); hops++){
+				size_t at = quadAt(tgt);
+				if (at == body.size() || body[at].kind != GOTO_QUAD){ break; }
+				uint32_t next = resolve(body[at].target());
+				if (next == tgt){ break; }
+				tgt = next;
+			}
+			if (tgt != orig){
+				quad.aux = tgt;
+				changed = true;
+			}
+		}
+
+		//A jump to the very next quad does nothing (an IFZ's
+		// condition is just an operand, so it has no effect
+		// either)
+		drop.assign(body.size(), false);
+		for (size_t i = 0; i < body.size(); i++){
+			Quad& quad = body[i];
+			if (!quad.isJump() || quadAt(quad.target()) != i + 1){ continue; }
+			if (!quad.hasLabels()){
+				drop[i] = true;
+			} else {
+				quad = replaces(Quad::nop(), quad);
+			}
+			changed = true;
+		}
+		dropQuads(drop);
+
+		//Delete every block that can't be reached from the
+		// entry
+		{
+			CFG cfg(this);
+			drop.assign(body.size(), false);
+			for (auto block : cfg.blocks()){
+				if (block->reachable() || block->isExit()){ continue; }
+				for (size_t i = block->begin(); i != block->end(); i++){
+					drop[i] = true;
+				}
+				changed = true;
+			}
+			dropQuads(drop);
+		}
+
+		//Drop labels nothing jumps to, and the nops that are
+		// left with none
+		std::vector<bool> targets(labelCount, false);
+		for (auto& quad : body){
+			if (quad.isJump()){ targets[quad.target()] = true; }
+		}
+		for (auto& quad : body){
+			if (quad.hasLabels()
+				&& !targets[labelsOf(quad).front()->getSlot()]){
+				clearLabels(quad);
+				changed = true;
+			}
+		}
+		keepQuads([&](const Quad& quad){
+			if (!quad.hasLabels() && quad.kind == NOP_QUAD){
+				changed = true;
+				return false;
+			}
+			return true;
+		});
+	}
+}
+
+//Two temps interfere when one is written while the other
+// still holds a value that will be read. Temps that never
+// interfere can live in the same slot, so the temps are
+// colored greedily (in the order they were made) and each
+// color keeps only its first temp. A copy from one temp to
+// another doesn't make them interfere, since they hold the
+// same value afterwards.
+void Procedure::shareTempSlots(){
+	CFG cfg(this);
+	std::vector<OpdID> tracked(temps.begin(), temps.end());
+	tracked.insert(tracked.end(), addrOpds.begin(), addrOpds.end());
+	Liveness live(&cfg, tracked);
+	size_t count = tracked.size();
+
+	//Kept as adjacency lists, since a big procedure has
+	// thousands of temps but few are live at once
+	std::vector<std::vector<size_t>> interferes(count);
+	std::vector<OpdID> read;
+	for (auto block : cfg.blocks()){
+		BitSet now = live.liveOut(block);
+		for (size_t i = block->end(); i != block->begin(); ){
+			--i;
+			Quad& quad = body[i];
+			size_t def = live.indexOf(Liveness::def(this, quad));
+			if (def != Liveness::NONE){
+				size_t copied = Liveness::NONE;
+				if (quad.kind == ASSIGN_QUAD){
+					copied = live.indexOf(quad.src1);
+				}
+				now.each([&](size_t other){
+					if (other == def || other == copied){ return; }
+					interferes[def].push_back(other);
+					interferes[other].push_back(def);
+				});
+				now.remove(def);
+			}
+			Liveness::uses(this, quad, read);
+			for (OpdID opd : read){
+				size_t use = live.indexOf(opd);
+				if (use != Liveness::NONE){ now.add(use); }
+			}
+		}
+	}
+
+	//Only temps of the same kind and width can share a slot
+	auto sameSlotKind = [&](size_t a, size_t b){
+		return (a < temps.size()) == (b < temps.size())
+			&& opds[tracked[a]]->getWidth() == opds[tracked[b]]->getWidth();
+	};
+	std::vector<size_t> color(count, Liveness::NONE);
+	std::vector<OpdID> slotOf(count, NO_OPD);
+	std::vector<OpdID> firstOfColor;
+	std::vector<size_t> kindOfColor;
+	for (size_t i = 0; i < count; i++){
+		std::vector<bool> taken(firstOfColor.size(), false);
+		for (size_t other : interferes[i]){
+			if (color[other] != Liveness::NONE){ taken[color[other]] = true; }
+		}
+		for (size_t c = 0; c < firstOfColor.size(); c++){
+			if (!taken[c] && sameSlotKind(kindOfColor[c], i)){
+				color[i] = c;
+				break;
+			}
+		}
+		if (color[i] == Liveness::NONE){
+			color[i] = firstOfColor.size();
+			firstOfColor.push_back(tracked[i]);
+			kindOfColor.push_back(i);
+		}
+		slotOf[i] = firstOfColor[color[i]];
+	}
+
+	auto rename = [&](OpdID * slot){
+		size_t idx = live.indexOf(*slot);
+		if (idx != Liveness::NONE){ *slot = slotOf[idx]; }
+	};
+	std::vector<bool> drop(body.size(), false);
+	for (size_t i = 0; i < body.size(); i++){
+		Quad& quad = body[i];
+		for (OpdID * slot : useSlots(quad)){ rename(slot); }
+		if (quad.defSlot() != nullptr){ rename(quad.defSlot()); }
+		//A copy between temps that now share a slot is a no-op
+		if (quad.kind == ASSIGN_QUAD && quad.dst == quad.src1
+			&& live.indexOf(quad.dst) != Liveness::NONE){
+			if (quad.hasLabels()){
+				quad = replaces(Quad::nop(), quad);
+			} else {
+				drop[i] = true;
+			}
+		}
+	}
+	dropQuads(drop);
+
+	std::vector<bool> kept(opds.size(), false);
+	for (OpdID first : firstOfColor){ kept[first] = true; }
+	auto notKept = [&](OpdID tmp){ return !kept[tmp]; };
+	temps.erase(std::remove_if(temps.begin(), temps.end(), notKept), temps.end());
+	addrOpds.erase(std::remove_if(addrOpds.begin(), addrOpds.end(), notKept),
+		addrOpds.end());
+}
+
+}
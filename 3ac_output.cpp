@@ -1,24 +1,39 @@
+#include <vector>
 #include "ast.hpp"
+#include "workers.hpp"
 
 namespace cminusminus{
 
-IRProgram * ProgramNode::to3AC(TypeAnalysis * ta){
+//Every global and procedure is added to the program in
+// order, and then the bodies are lowered side by side
+IRProgram * ProgramNode::to3AC(TypeAnalysis * ta, Workers& workers){
 	IRProgram * prog = new IRProgram(ta);
-	for (auto global : *myGlobals){
+	std::vector<DeclNode *> decls(myGlobals->begin(), myGlobals->end());
+	for (auto global : decls){
 		global->to3AC(prog);
 	}
+	workers.concurrently(decls.size(), [&](size_t i){
+		decls[i]->to3ACBody();
+	});
+	workers.flush();
+	for (auto proc : *prog->getProcs()){
+		proc->number();
+	}
 	return prog;
 }
 
 void FnDeclNode::to3AC(IRProgram * prog){
-	//make a procedure and add it to prog then call its interior statements
-	//with the proc
-	Procedure * proc = prog->makeProc(ID()->getName());
+	//make a procedure and add it to prog, the body's
+	// interior statements are lowered into it by to3ACBody
+	myProc = prog->makeProc(ID()->getName());
+}
+
+void FnDeclNode::to3ACBody(){
 	for (auto formal : *myFormals) {
-		formal->to3AC(proc);
+		formal->to3AC(myProc);
 	}
 	for (auto body : *myBody) {
-		body->to3AC(proc);
+		body->to3AC(myProc);
 	}
 }
 
@@ -42,349 +57,324 @@ void FormalDeclNode::to3AC(Procedure * proc){ //this is for a formal in a functi
 
 	SemSymbol * sym = ID()->getSymbol();
 	assert(sym != nullptr);
-	proc->gatherFormal(sym);
+	OpdID opd = proc->gatherFormal(sym);
 	//create quad to getarg
 	size_t index = proc->getFormals().size();
-	SymOpd * opd = proc->getFormal(index-1);
-	GetArgQuad * quad = new GetArgQuad(index, opd);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::getArg(index, opd));
 }
 
-Opd * ShortLitNode::flatten(Procedure * proc){
+OpdID ShortLitNode::flatten(Procedure * proc){
 	const DataType * type = proc->getProg()->nodeType(this);
-	return new LitOpd(std::to_string(myNum), 1);
+	return proc->literal(myNum, 1);
 }
 
-Opd * IntLitNode::flatten(Procedure * proc){
+OpdID IntLitNode::flatten(Procedure * proc){
 	const DataType * type = proc->getProg()->nodeType(this);
-	return new LitOpd(std::to_string(myNum), 8);
+	return proc->literal(myNum, 8);
 }
 
-Opd * StrLitNode::flatten(Procedure * proc){
-	Opd * res = proc->getProg()->makeString(myStr);
+OpdID StrLitNode::flatten(Procedure * proc){
+	OpdID res = proc->makeString(myStr.str());
 	return res;
 }
 
-Opd * TrueNode::flatten(Procedure * proc){
+OpdID TrueNode::flatten(Procedure * proc){
 	const DataType * type = proc->getProg()->nodeType(this);
-	return new LitOpd("1", 8);
+	return proc->literal(1, 8);
 }
 
-Opd * FalseNode::flatten(Procedure * proc){
+OpdID FalseNode::flatten(Procedure * proc){
 	const DataType * type = proc->getProg()->nodeType(this);
-	return new LitOpd("0", 8);
+	return proc->literal(0, 8);
 }
 
-Opd * AssignExpNode::flatten(Procedure * proc){
+OpdID AssignExpNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src = mySrc->flatten(proc);
-	Opd * dst = myDst->flatten(proc);
-	assert(dst != nullptr);
-	assert(src != nullptr);
+	OpdID src = mySrc->flatten(proc);
+	OpdID dst = myDst->flatten(proc);
+	assert(dst != NO_OPD);
+	assert(src != NO_OPD);
 
 	//create quad
-	AssignQuad * quad = new AssignQuad(dst, src);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::assign(dst, src));
 	return dst;
 	//return nullptr;//?? what to return??
 }
 
-Opd * LValNode::flatten(Procedure * proc){
+OpdID LValNode::flatten(Procedure * proc){
 	throw new InternalError("Inside LVal");
 }
 
-Opd * CallExpNode::flatten(Procedure * proc){
-	std::list<Opd*>* lst = new std::list<Opd*>;
+OpdID CallExpNode::flatten(Procedure * proc){
+	std::list<OpdID>* lst = new std::list<OpdID>;
 	for (auto arg : *myArgs) {
-		Opd * opd = arg -> flatten(proc);
+		OpdID opd = arg -> flatten(proc);
 		lst -> push_back(opd);
 	}
 
 	size_t i = 1;
 	while (!lst -> empty()) {
-		Opd * opd = lst -> front();
+		OpdID opd = lst -> front();
 		lst -> pop_front();
-		SetArgQuad * setArgQuad = new SetArgQuad(i, opd);
-		proc -> addQuad(setArgQuad);
+		proc -> addQuad(Quad::setArg(i, opd));
 		i++;
 	}
 
-	CallQuad * quad = new CallQuad(myID -> getSymbol());
-	proc -> addQuad(quad);
+	proc -> addQuad(proc -> call(myID -> getSymbol()));
 	if (getRetType() -> isVoid()) {
 		return myID -> flatten(proc);
 	}
 
-	AuxOpd * tmp = proc -> makeTmp(8);
-	GetRetQuad* grQuad = new GetRetQuad(tmp);
-	proc -> addQuad(grQuad);
+	OpdID tmp = proc -> makeTmp(8);
+	proc -> addQuad(Quad::getRet(tmp));
 	return tmp;
 }
 
-Opd* CallExpNode::flattenAsStmt(Procedure * proc)
+OpdID CallExpNode::flattenAsStmt(Procedure * proc)
 {
-	std::list<Opd*>* lst = new std::list<Opd*>;
+	std::list<OpdID>* lst = new std::list<OpdID>;
 	for (auto arg : *myArgs) {
-		Opd * opd = arg -> flatten(proc);
+		OpdID opd = arg -> flatten(proc);
 		lst -> push_back(opd);
 	}
 
 	size_t i = 1;
 	while (!lst -> empty()) {
-		Opd * opd = lst -> front();
+		OpdID opd = lst -> front();
 		lst -> pop_front();
-		SetArgQuad * setArgQuad = new SetArgQuad(i, opd);
-		proc -> addQuad(setArgQuad);
+		proc -> addQuad(Quad::setArg(i, opd));
 		i++;
 	}
 
 	if (!(getRetType() -> asFn() -> isVoid())) {
-		AuxOpd * tmp = proc -> makeTmp(8);
+		OpdID tmp = proc -> makeTmp(8);
 	}
 
-	CallQuad * quad = new CallQuad(myID -> getSymbol());
-	proc -> addQuad(quad);
+	proc -> addQuad(proc -> call(myID -> getSymbol()));
 	return myID -> flatten(proc);
 }
 
-Opd * NegNode::flatten(Procedure * proc){
+OpdID NegNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src = myExp->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
+	OpdID src = myExp->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
 
-	//create UnaryOpQuad and add to function body
+	//create a UNARYOP quad and add to function body
 	UnaryOp neg = NEG64;
-	UnaryOpQuad * quad = new UnaryOpQuad(tmp, neg, src);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::unaryOp(tmp, neg, src));
 	return tmp;
 }
 
-Opd * NotNode::flatten(Procedure * proc){
+OpdID NotNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src = myExp->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
+	OpdID src = myExp->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
 
-	//create UnaryOpQuad and add to function body
+	//create a UNARYOP quad and add to function body
 	UnaryOp _not = NOT8; // should it be NOT64 as on the oracle
-	UnaryOpQuad * quad = new UnaryOpQuad(tmp, _not, src);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::unaryOp(tmp, _not, src));
 	return tmp;
 }
 
-Opd * PlusNode::flatten(Procedure * proc){
+OpdID PlusNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src1 = myExp1->flatten(proc);
-	Opd * src2 = myExp2->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
-	assert(src1 != nullptr);
-	assert(src2 != nullptr);
-	//create BinOpQuad and add to function body
+	OpdID src1 = myExp1->flatten(proc);
+	OpdID src2 = myExp2->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
+	assert(src1 != NO_OPD);
+	assert(src2 != NO_OPD);
+	//create a BINOP quad and add to function body
 	BinOp plus = ADD64;
-	BinOpQuad * quad = new BinOpQuad(tmp, plus, src1, src2);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::binOp(tmp, plus, src1, src2));
 	return tmp;
 }
 //Hello everyone... I am a computer
-Opd * MinusNode::flatten(Procedure * proc){
+OpdID MinusNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src1 = myExp1->flatten(proc);
-	Opd * src2 = myExp2->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
-	assert(src1 != nullptr);
-	assert(src2 != nullptr);
-
-	//create BinOpQuad and add to function body
+	OpdID src1 = myExp1->flatten(proc);
+	OpdID src2 = myExp2->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
+	assert(src1 != NO_OPD);
+	assert(src2 != NO_OPD);
+
+	//create a BINOP quad and add to function body
 	BinOp minus = SUB64;
-	BinOpQuad * quad = new BinOpQuad(tmp, minus, src1, src2);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::binOp(tmp, minus, src1, src2));
 	return tmp;
 }
 
-Opd * TimesNode::flatten(Procedure * proc){
+OpdID TimesNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src1 = myExp1->flatten(proc);
-	Opd * src2 = myExp2->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
-	assert(src1 != nullptr);
-	assert(src2 != nullptr);
-
-	//create BinOpQuad and add to function body
+	OpdID src1 = myExp1->flatten(proc);
+	OpdID src2 = myExp2->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
+	assert(src1 != NO_OPD);
+	assert(src2 != NO_OPD);
+
+	//create a BINOP quad and add to function body
 	BinOp times = MULT64;
-	BinOpQuad * quad = new BinOpQuad(tmp, times, src1, src2);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::binOp(tmp, times, src1, src2));
 	return tmp;
 }
 
-Opd * DivideNode::flatten(Procedure * proc){
+OpdID DivideNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src1 = myExp1->flatten(proc);
-	Opd * src2 = myExp2->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
-	assert(src1 != nullptr);
-	assert(src2 != nullptr);
-
-	//create BinOpQuad and add to function body
+	OpdID src1 = myExp1->flatten(proc);
+	OpdID src2 = myExp2->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
+	assert(src1 != NO_OPD);
+	assert(src2 != NO_OPD);
+
+	//create a BINOP quad and add to function body
 	BinOp div = DIV64;
-	BinOpQuad * quad = new BinOpQuad(tmp, div, src1, src2);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::binOp(tmp, div, src1, src2));
 	return tmp;
 }
 
-Opd * AndNode::flatten(Procedure * proc){
+OpdID AndNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src1 = myExp1->flatten(proc);
-	Opd * src2 = myExp2->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
-	assert(src1 != nullptr);
-	assert(src2 != nullptr);
-
-	//create BinOpQuad and add to function body
+	OpdID src1 = myExp1->flatten(proc);
+	OpdID src2 = myExp2->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
+	assert(src1 != NO_OPD);
+	assert(src2 != NO_OPD);
+
+	//create a BINOP quad and add to function body
 	BinOp _and = AND64;
-	BinOpQuad * quad = new BinOpQuad(tmp, _and, src1, src2);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::binOp(tmp, _and, src1, src2));
 	return tmp;
 }
 
-Opd * OrNode::flatten(Procedure * proc){
+OpdID OrNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src1 = myExp1->flatten(proc);
-	Opd * src2 = myExp2->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
-	assert(src1 != nullptr);
-	assert(src2 != nullptr);
-
-	//create BinOpQuad and add to function body
+	OpdID src1 = myExp1->flatten(proc);
+	OpdID src2 = myExp2->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
+	assert(src1 != NO_OPD);
+	assert(src2 != NO_OPD);
+
+	//create a BINOP quad and add to function body
 	BinOp _or = OR64;
-	BinOpQuad * quad = new BinOpQuad(tmp, _or, src1, src2);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::binOp(tmp, _or, src1, src2));
 	return tmp;
 }
 
-Opd * EqualsNode::flatten(Procedure * proc){
+OpdID EqualsNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src1 = myExp1->flatten(proc);
-	Opd * src2 = myExp2->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
-	assert(src1 != nullptr);
-	assert(src2 != nullptr);
-
-	//create BinOpQuad and add to function body
+	OpdID src1 = myExp1->flatten(proc);
+	OpdID src2 = myExp2->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
+	assert(src1 != NO_OPD);
+	assert(src2 != NO_OPD);
+
+	//create a BINOP quad and add to function body
 	BinOp eq = EQ64;
-	BinOpQuad * quad = new BinOpQuad(tmp, eq, src1, src2);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::binOp(tmp, eq, src1, src2));
 	return tmp;
 }
 
-Opd * NotEqualsNode::flatten(Procedure * proc){
+OpdID NotEqualsNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src1 = myExp1->flatten(proc);
-	Opd * src2 = myExp2->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
-	assert(src1 != nullptr);
-	assert(src2 != nullptr);
-
-	//create BinOpQuad and add to function body
+	OpdID src1 = myExp1->flatten(proc);
+	OpdID src2 = myExp2->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
+	assert(src1 != NO_OPD);
+	assert(src2 != NO_OPD);
+
+	//create a BINOP quad and add to function body
 	BinOp neq = NEQ64;
-	BinOpQuad * quad = new BinOpQuad(tmp, neq, src1, src2);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::binOp(tmp, neq, src1, src2));
 	return tmp;
 }
 
-Opd * LessNode::flatten(Procedure * proc){
+OpdID LessNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src1 = myExp1->flatten(proc);
-	Opd * src2 = myExp2->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
-	assert(src1 != nullptr);
-	assert(src2 != nullptr);
-
-	//create BinOpQuad and add to function body
+	OpdID src1 = myExp1->flatten(proc);
+	OpdID src2 = myExp2->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
+	assert(src1 != NO_OPD);
+	assert(src2 != NO_OPD);
+
+	//create a BINOP quad and add to function body
 	BinOp lt = LT64;
-	BinOpQuad * quad = new BinOpQuad(tmp, lt, src1, src2);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::binOp(tmp, lt, src1, src2));
 	return tmp;
 }
 
-Opd * GreaterNode::flatten(Procedure * proc){
+OpdID GreaterNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src1 = myExp1->flatten(proc);
-	Opd * src2 = myExp2->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
-	assert(src1 != nullptr);
-	assert(src2 != nullptr);
-
-	//create BinOpQuad and add to function body
+	OpdID src1 = myExp1->flatten(proc);
+	OpdID src2 = myExp2->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
+	assert(src1 != NO_OPD);
+	assert(src2 != NO_OPD);
+
+	//create a BINOP quad and add to function body
 	BinOp gt = GT64;
-	BinOpQuad * quad = new BinOpQuad(tmp, gt, src1, src2);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::binOp(tmp, gt, src1, src2));
 	return tmp;
 }
 
-Opd * LessEqNode::flatten(Procedure * proc){
+OpdID LessEqNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src1 = myExp1->flatten(proc);
-	Opd * src2 = myExp2->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
-	assert(src1 != nullptr);
-	assert(src2 != nullptr);
-
-	//create BinOpQuad and add to function body
+	OpdID src1 = myExp1->flatten(proc);
+	OpdID src2 = myExp2->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
+	assert(src1 != NO_OPD);
+	assert(src2 != NO_OPD);
+
+	//create a BINOP quad and add to function body
 	BinOp lte = LTE64;
-	BinOpQuad * quad = new BinOpQuad(tmp, lte, src1, src2);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::binOp(tmp, lte, src1, src2));
 	return tmp;
 }
 
-Opd * GreaterEqNode::flatten(Procedure * proc){
+OpdID GreaterEqNode::flatten(Procedure * proc){
 	//get operands
-	Opd * src1 = myExp1->flatten(proc);
-	Opd * src2 = myExp2->flatten(proc);
-	AuxOpd * tmp = proc->makeTmp(8); //8?
-	assert(tmp != nullptr);
-	assert(src1 != nullptr);
-	assert(src2 != nullptr);
-
-	//create BinOpQuad and add to function body
+	OpdID src1 = myExp1->flatten(proc);
+	OpdID src2 = myExp2->flatten(proc);
+	OpdID tmp = proc->makeTmp(8); //8?
+	assert(tmp != NO_OPD);
+	assert(src1 != NO_OPD);
+	assert(src2 != NO_OPD);
+
+	//create a BINOP quad and add to function body
 	BinOp gte = GTE64;
-	BinOpQuad * quad = new BinOpQuad(tmp, gte, src1, src2);
-	proc->addQuad(quad);
+	proc->addQuad(Quad::binOp(tmp, gte, src1, src2));
 	return tmp;
 }
 
-Opd * ShortToIntNode::flatten(Procedure * proc){
-	Opd* src = myExp -> flatten(proc);
-	AuxOpd* tmp = proc->makeTmp(8);
-	AssignQuad * quad = new AssignQuad(tmp, src);
-	proc -> addQuad(quad);
+OpdID ShortToIntNode::flatten(Procedure * proc){
+	OpdID src = myExp -> flatten(proc);
+	OpdID tmp = proc->makeTmp(8);
+	proc -> addQuad(Quad::assign(tmp, src));
 	return tmp;
 }
 
-Opd * RefNode::flatten(Procedure * proc){
-	Opd* id = myID -> flatten(proc);
-	AuxOpd * tmp = proc -> makeTmp(8);
-	LocQuad * quad = new LocQuad(id, tmp, true, false);
-	proc -> addQuad(quad);
+OpdID RefNode::flatten(Procedure * proc){
+	OpdID id = myID -> flatten(proc);
+	OpdID tmp = proc -> makeTmp(8);
+	proc -> addQuad(Quad::loc(id, tmp, true, false));
 	return tmp;
 }
 
-Opd * DerefNode::flatten(Procedure * proc){
-	Opd * id = myID -> flatten(proc);
-	AddrOpd * addrTemp = proc -> makeAddrOpd(8);
-	LocQuad * quad = new LocQuad(id, addrTemp, false, true);
-	proc -> addQuad(quad);
+OpdID DerefNode::flatten(Procedure * proc){
+	OpdID id = myID -> flatten(proc);
+	OpdID addrTemp = proc -> makeAddrOpd(8);
+	proc -> addQuad(Quad::loc(id, addrTemp, false, true));
 	return addrTemp;
 }
 
@@ -393,98 +383,78 @@ void AssignStmtNode::to3AC(Procedure * proc){
 }
 
 void PostIncStmtNode::to3AC(Procedure * proc){
-	LitOpd* lit = new LitOpd("1", 8);
-	Opd * src = myLVal -> flatten(proc);
+	OpdID lit = proc -> literal(1, 8);
+	OpdID src = myLVal -> flatten(proc);
 	BinOp op = ADD64;
-	BinOpQuad * quad = new BinOpQuad(src, op, src, lit);
-	proc -> addQuad(quad);
+	proc->addQuad(Quad::binOp(src, op, src, lit));
 }
 
 void PostDecStmtNode::to3AC(Procedure * proc){
-	LitOpd* lit = new LitOpd("1", 8);
-	Opd * src = myLVal -> flatten(proc);
+	OpdID lit = proc -> literal(1, 8);
+	OpdID src = myLVal -> flatten(proc);
 	BinOp op = SUB64;
-	BinOpQuad * quad = new BinOpQuad(src, op, src, lit);
-	proc -> addQuad(quad);
+	proc->addQuad(Quad::binOp(src, op, src, lit));
 }
 
 void ReadStmtNode::to3AC(Procedure * proc){
-	Opd * dst = myDst -> flatten(proc);
+	OpdID dst = myDst -> flatten(proc);
 	const DataType * t = proc -> getProg() -> nodeType(myDst);
-	ReceiveQuad * rQuad = new ReceiveQuad(dst, t);
-	proc -> addQuad(rQuad);
+	proc -> addQuad(proc -> receive(dst, t));
 }
 
 void WriteStmtNode::to3AC(Procedure * proc){
-	Opd * src = mySrc -> flatten(proc);
+	OpdID src = mySrc -> flatten(proc);
 	const DataType * t = proc -> getProg() -> nodeType(mySrc);
-	ReportQuad * quad = new ReportQuad(src, t);
-	proc -> addQuad(quad);
+	proc -> addQuad(proc -> report(src, t));
 }
 
 void IfStmtNode::to3AC(Procedure * proc){
-	Opd* cond = myCond -> flatten(proc);
+	OpdID cond = myCond -> flatten(proc);
 	Label * skip = proc -> makeLabel();
-	IfzQuad * ifzQuad = new IfzQuad(cond, skip);
-	proc -> addQuad(ifzQuad);
+	proc -> addQuad(Quad::ifz(cond, skip));
 
 	for (auto stmt : *myBody) {
 		stmt -> to3AC(proc);
 	}
 
-	NopQuad * nop = new NopQuad();
-	nop -> addLabel(skip);
-	proc -> addQuad(nop);
+	proc -> addQuad(Quad::nop(), skip);
 }
 
 void IfElseStmtNode::to3AC(Procedure * proc){
-	Opd* cond = myCond -> flatten(proc);
+	OpdID cond = myCond -> flatten(proc);
 	Label * skip = proc -> makeLabel();
 	Label * end = proc -> makeLabel();
-	IfzQuad * ifzQuad = new IfzQuad(cond, skip);
-	proc -> addQuad(ifzQuad);
+	proc -> addQuad(Quad::ifz(cond, skip));
 
 	for (auto stmt : *myBodyTrue) {
 		stmt -> to3AC(proc);
 	}
 
-	GotoQuad * gotoQuad = new GotoQuad(end);
-	proc -> addQuad(gotoQuad);
+	proc -> addQuad(Quad::jump(end));
 	
-	NopQuad * nop = new NopQuad();
-	nop -> addLabel(skip);
-	proc -> addQuad(nop);
+	proc -> addQuad(Quad::nop(), skip);
 
 	for (auto stmt : *myBodyFalse) {
 		stmt -> to3AC(proc);
 	}
 
-	NopQuad * nop2 = new NopQuad();
-	nop2 -> addLabel(end);
-	proc -> addQuad(nop2);
+	proc -> addQuad(Quad::nop(), end);
 }
 
 void WhileStmtNode::to3AC(Procedure * proc){
 	Label * start = proc -> makeLabel();
 	Label * end = proc -> makeLabel();
-	NopQuad * nop1 = new NopQuad();
-
-	nop1 -> addLabel(start);
-	proc -> addQuad(nop1);
+	proc -> addQuad(Quad::nop(), start);
 
-	Opd* cond = myCond -> flatten(proc);
-	IfzQuad * ifzQuad = new IfzQuad(cond, end);
-	proc -> addQuad(ifzQuad);
+	OpdID cond = myCond -> flatten(proc);
+	proc -> addQuad(Quad::ifz(cond, end));
 
 	for (auto stmt : *myBody) {
 		stmt -> to3AC(proc);
 	}
 
-	GotoQuad * gotoQuad = new GotoQuad(start);
-	NopQuad * nop2 = new NopQuad();
-	proc -> addQuad(gotoQuad);
-	nop2 -> addLabel(end);
-	proc -> addQuad(nop2);
+	proc -> addQuad(Quad::jump(start));
+	proc -> addQuad(Quad::nop(), end);
 }
 
 void CallStmtNode::to3AC(Procedure * proc){
@@ -493,12 +463,10 @@ void CallStmtNode::to3AC(Procedure * proc){
 
 void ReturnStmtNode::to3AC(Procedure * proc){
 	if (myExp != nullptr) {
-		Opd * src = myExp -> flatten(proc);
-		SetRetQuad * srQuad = new SetRetQuad(src);
-		proc -> addQuad(srQuad);
+		OpdID src = myExp -> flatten(proc);
+		proc -> addQuad(Quad::setRet(src));
 	}
-	GotoQuad * gotoQuad = new GotoQuad(proc -> getLeaveLabel());
-	proc -> addQuad(gotoQuad);
+	proc -> addQuad(Quad::jump(proc -> getLeaveLabel()));
 }
 
 void VarDeclNode::to3AC(Procedure * proc){
@@ -515,7 +483,7 @@ void VarDeclNode::to3AC(IRProgram * prog){
 
 //We only get to this node if we are in a stmt
 // context (DeclNodes protect descent) 
-Opd * IDNode::flatten(Procedure * proc){
+OpdID IDNode::flatten(Procedure * proc){
 	SemSymbol * sym = mySymbol;
 	return proc->getSymOpd(sym);
 }
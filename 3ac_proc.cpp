@@ -1,21 +1,18 @@
 #include "3ac.hpp"
 #include <algorithm>
+#include <sstream>
 
 namespace cminusminus{
 
+const uint32_t Label::NONE;
+
 Procedure::Procedure(IRProgram * prog, std::string name)
 : myProg(prog), myName(name){
 	maxTmp = 0;
-	enter = new EnterQuad(this);
-	leave = new LeaveQuad(this);
-	bodyQuads = new std::list<Quad *>();
-	if (myName.compare("main") == 0){
-		enter->addLabel(new Label("main"));
-	} else {
-		enter->addLabel(new Label("fun_" + myName));
-	}
-	leaveLabel = myProg->makeLabel();
-	leave->addLabel(leaveLabel);
+	labelLists.emplace_back();
+	comments.emplace_back();
+	enterLabel = new Label(Interner::intern(myName));
+	leaveLabel = makeLabel();
 }
 
 std::string Procedure::getName(){
@@ -28,94 +25,179 @@ Label * Procedure::getLeaveLabel(){
 
 IRProgram * Procedure::getProg(){ return myProg; }
 
-std::string Procedure::toString(bool verbose){
-	std::string res = "";
-
-	res += "[BEGIN " + this->getName() + " LOCALS]\n";
+void Procedure::write(std::ostream& out, bool verbose){
+	out << "[BEGIN " << this->getName() << " LOCALS]\n";
 	for (const auto formal : this->formals){
-		res += formal->getName() + " (formal arg of " 
-			+ std::to_string(formal->getWidth()) + ")\n";
-			+ " bytes)\n";
+		out << opds[formal]->locString() << " (formal arg of " 
+			<< opds[formal]->getWidth() << ")\n";
 	}
 
-	for (auto local : this->locals){
-		res += local.second->getName() + " (local var of "
-			+ std::to_string(local.second->getWidth())
-			+ " bytes)\n";
+	for (auto local : this->localsInOrder){
+		out << opds[local]->locString() << " (local var of "
+			<< opds[local]->getWidth()
+			<< " bytes)\n";
 	}
 
 	for (auto tmp : temps){
-		res += tmp->locString() + " (tmp var of "
-			+ std::to_string(tmp->getWidth())
-			+ " bytes)\n";
+		out << opds[tmp]->locString() << " (tmp var of "
+			<< opds[tmp]->getWidth()
+			<< " bytes)\n";
 	}
 	for (auto addrOpd : this->addrOpds){
-		res += addrOpd->locString() + " (tmp loc of "
-			+ std::to_string(addrOpd->getWidth())
-			+ " bytes)\n";
+		out << opds[addrOpd]->locString() << " (tmp loc of "
+			<< opds[addrOpd]->getWidth()
+			<< " bytes)\n";
 	}
-	res += "[END " + this->getName() + " LOCALS]\n";
+	out << "[END " << this->getName() << " LOCALS]\n";
 
-	res += enter->toString(verbose) + "\n";
-	for (auto quad : *bodyQuads){
-		res += quad->toString(verbose) + "\n";
+	writeEnter(out);
+	out << "\n";
+	for (auto& quad : body){
+		writeQuad(out, quad, verbose);
+		out << "\n";
 	}
-	res += leave->toString(verbose) + "\n";
-	return res;
+	writeLeave(out);
+	out << "\n";
 }
 
-Label * Procedure::makeLabel(){
-	return myProg->makeLabel();
+std::string Procedure::toString(bool verbose){
+	std::ostringstream res;
+	write(res, verbose);
+	return res.str();
 }
 
-void Procedure::addQuad(Quad * quad){
-	bodyQuads->push_back(quad);
+Label * Procedure::makeLabel(){
+	if (holding){
+		Label * lbl = newLabel(Label::NONE);
+		heldLabels.push_back(lbl);
+		return lbl;
+	}
+	return newLabel(myProg->nextLabelID());
 }
 
-Quad * Procedure::popQuad(){
-	Quad * last = bodyQuads->back();
-	bodyQuads->pop_back();
-	return last;
+OpdID Procedure::makeString(std::string val){
+	StringOpd * opd = new StringOpd("", 1);
+	if (holding){
+		heldStrings.push_back(std::make_pair(opd, val));
+	} else {
+		myProg->addString(opd, val);
+	}
+	return addOpd(opd);
 }
 
-void Procedure::gatherLocal(SemSymbol * sym){
-	size_t width = Opd::width(sym->getDataType());
-	locals[sym] = new SymOpd(sym, width);
+void Procedure::number(){
+	for (auto lbl : heldLabels){
+		lbl->id = myProg->nextLabelID();
+	}
+	for (auto& entry : heldStrings){
+		myProg->addString(entry.first, entry.second);
+	}
+	heldLabels.clear();
+	heldStrings.clear();
+	holding = false;
 }
 
-void Procedure::gatherFormal(SemSymbol * sym){
-	size_t width = Opd::width(sym->getDataType());
-	formals.push_back(new SymOpd(sym, width));
+Label * Procedure::newLabel(uint32_t id){
+	Label * lbl = new Label(id, labelCount++);
+	labels.push_back(lbl);
+	return lbl;
 }
 
-SymOpd * Procedure::getSymOpd(SemSymbol * sym){
-	for(auto formalSeek : formals){
-		if (formalSeek->getSym() == sym){
-			return formalSeek;
+void Procedure::indexLabels(){
+	labelPos.assign(labelCount, body.size());
+	labelPlaced.assign(labelCount, false);
+	for (size_t i = 0; i < body.size(); i++){
+		for (auto lbl : labelsOf(body[i])){
+			labelPos[lbl->getSlot()] = i;
+			labelPlaced[lbl->getSlot()] = true;
 		}
 	}
+	labelPlaced[leaveLabel->getSlot()] = true;
+}
 
-	auto localFound = locals.find(sym);
-	if (localFound != locals.end()){
-		return localFound->second;
+size_t Procedure::quadAt(uint32_t lbl){
+	if (lbl >= labelPlaced.size() || !labelPlaced[lbl]){
+		throw new InternalError(
+			("Jump to unplaced label " + labels[lbl]->getName()).c_str());
 	}
-	
-	return this->getProg()->getGlobal(sym);
+	return labelPos[lbl];
+}
+
+void Procedure::addQuad(const Quad& quad, Label * lbl){
+	body.push_back(quad);
+	addLabel(body.back(), lbl);
+}
+
+OpdID Procedure::addOpd(Opd * opd){
+	opds.push_back(opd);
+	return static_cast<OpdID>(opds.size() - 1);
+}
+
+//A symbol is declared in only one procedure, so it can
+// carry the index of its operand in that procedure
+OpdID Procedure::gatherSym(SemSymbol * sym){
+	size_t width = Opd::width(sym->getDataType());
+	OpdID id = addOpd(new SymOpd(sym, width));
+	sym->setSlot(static_cast<uint32_t>(symOpds.size()));
+	symOpds.push_back(id);
+	return id;
+}
+
+OpdID Procedure::gatherLocal(SemSymbol * sym){
+	OpdID id = gatherSym(sym);
+	localsInOrder.push_back(id);
+	return id;
+}
+
+OpdID Procedure::gatherFormal(SemSymbol * sym){
+	OpdID id = gatherSym(sym);
+	formals.push_back(id);
+	return id;
+}
+
+OpdID Procedure::getSymOpd(SemSymbol * sym){
+	//The slot may be another procedure's if sym isn't
+	// declared here, so check it really is sym's operand
+	uint32_t slot = sym->getSlot();
+	if (slot < symOpds.size() && symOpds[slot] != NO_OPD
+		&& static_cast<SymOpd *>(opds[symOpds[slot]])->getSym() == sym){
+		return symOpds[slot];
+	}
+	SymOpd * global = this->getProg()->getGlobal(sym);
+	if (global == nullptr){ return NO_OPD; }
+	return shareOpd(global);
+}
+
+OpdID Procedure::shareOpd(Opd * opd){
+	auto found = sharedIDs.find(opd);
+	if (found != sharedIDs.end()){ return found->second; }
+	OpdID id = addOpd(opd);
+	sharedIDs[opd] = id;
+	return id;
+}
+
+OpdID Procedure::literal(int64_t val, size_t width){
+	auto key = std::make_pair(val, width);
+	auto found = litIDs.find(key);
+	if (found != litIDs.end()){ return found->second; }
+	OpdID id = addOpd(new LitOpd(val, width));
+	litIDs[key] = id;
+	return id;
 }
 
-AuxOpd * Procedure::makeTmp(size_t width){
+OpdID Procedure::makeTmp(size_t width){
 	std::string name = "tmp";
 	name += std::to_string(maxTmp++);
-	AuxOpd * res = new AuxOpd(name, width);
+	OpdID res = addOpd(new AuxOpd(name, width));
 	temps.push_back(res);
 
 	return res;
 }
 
-AddrOpd * Procedure::makeAddrOpd(size_t width){
+OpdID Procedure::makeAddrOpd(size_t width){
 	std::string name = "addrTmp";
 	name += std::to_string(maxTmp++);
-	AddrOpd * res = new AddrOpd(name, width);
+	OpdID res = addOpd(new AddrOpd(name, width));
 	addrOpds.push_back(res);
 
 	return res;
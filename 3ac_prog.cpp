@@ -1,3 +1,4 @@
+#include <sstream>
 #include "3ac.hpp"
 #include "vector"
 #include "type_analysis.hpp"
@@ -22,15 +23,11 @@ size_t IRProgram::opWidth(ASTNode * node){
 	return Opd::width(nodeType(node));
 }
 
-Label * IRProgram::makeLabel(){
-	Label * label = new Label("lbl_" + std::to_string(max_label++));
-	return label;
-}
-
 SymOpd * IRProgram::getGlobal(SemSymbol * sym){
-	if (globals.find(sym) != globals.end()){
-		return globals[sym];
-	} 
+	auto found = globals.find(sym);
+	if (found != globals.end()){
+		return found->second;
+	}
 	return nullptr;
 }
 
@@ -38,33 +35,36 @@ void IRProgram::gatherGlobal(SemSymbol * sym){
 	size_t width = Opd::width(sym->getDataType());
 	SymOpd * res = new SymOpd(sym, width);
 	globals[sym] = res;
+	globalsInOrder.push_back(res);
 }
 
-Opd * IRProgram::makeString(std::string val){
-	std::string name = "str_" + std::to_string(str_idx++);
-	StringOpd * opd = new StringOpd(name, 1);
-	strings[opd] = val;
-	return opd;
+void IRProgram::addString(StringOpd * opd, std::string val){
+	opd->setName("str_" + std::to_string(str_idx++));
+	strings.push_back(std::make_pair(opd, val));
 }
 
-std::string IRProgram::toString(bool verbose){
-	std::string res = "";
-	res += "[BEGIN GLOBALS]\n";
-	for (auto entry : globals){
-		res += entry.second->getName() + "\n"; 
+void IRProgram::write(std::ostream& out, bool verbose){
+	out << "[BEGIN GLOBALS]\n";
+	for (auto global : globalsInOrder){
+		out << global->getName() << "\n"; 
 	}
 	for (auto entry : strings){
-		res += entry.first->locString();
-		res += " " + entry.second; 
-		res += "\n";
+		out << entry.first->locString()
+			<< " " << entry.second
+			<< "\n";
 	}
 
-	res += "[END GLOBALS]\n";
+	out << "[END GLOBALS]\n";
 	
 	for (Procedure * proc : *procs){
-		res += proc->toString(verbose);
+		proc->write(out, verbose);
 	}
-	return res;
+}
+
+std::string IRProgram::toString(bool verbose){
+	std::ostringstream res;
+	write(res, verbose);
+	return res.str();
 }
 
 std::set<Opd *> IRProgram::globalSyms(){
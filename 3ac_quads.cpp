@@ -1,95 +1,120 @@
+#include <sstream>
 #include "3ac.hpp"
 
 namespace cminusminus{
 
+const uint8_t Quad::LOC_SRC;
+const uint8_t Quad::LOC_TGT;
 
-Quad::Quad() : myComment(""){
+void Procedure::addLabel(Quad& quad, Label * label){
+	if (label == nullptr){ return; }
+	if (quad.labels == 0){
+		quad.labels = static_cast<uint32_t>(labelLists.size());
+		labelLists.emplace_back();
+	}
+	labelLists[quad.labels].push_back(label);
 }
 
-void Quad::addLabel(Label * label){
-	if (label != nullptr){
-		labels.push_back(label);
+void Procedure::setComment(Quad& quad, std::string commentIn){
+	if (commentIn.empty()){
+		quad.comment = 0;
+	} else {
+		quad.comment = static_cast<uint32_t>(comments.size());
+		comments.push_back(commentIn);
 	}
 }
 
-void Quad::setComment(std::string commentIn){
-	this->myComment = commentIn;
+Quad Procedure::report(OpdID src, const DataType * type){
+	auto found = typeIDs.find(type);
+	if (found == typeIDs.end()){
+		found = typeIDs.emplace(type, static_cast<uint32_t>(types.size())).first;
+		types.push_back(type);
+	}
+	return Quad::make(REPORT_QUAD, 0, NO_OPD, src, NO_OPD, found->second);
 }
 
-std::string Quad::commentStr(){
-	if (myComment.length() > 0){
-		return "  #" + myComment;
-	}
-	return "";
+Quad Procedure::receive(OpdID dst, const DataType * type){
+	Quad res = report(NO_OPD, type);
+	res.kind = RECEIVE_QUAD;
+	res.dst = dst;
+	return res;
 }
 
-std::string Quad::toString(bool verbose){
-	auto res = std::string("");
+Quad Procedure::call(SemSymbol * callee){
+	auto found = calleeIDs.find(callee);
+	if (found == calleeIDs.end()){
+		found = calleeIDs.emplace(callee,
+			static_cast<uint32_t>(callees.size())).first;
+		callees.push_back(callee);
+	}
+	return Quad::make(CALL_QUAD, 0, NO_OPD, NO_OPD, NO_OPD, found->second);
+}
+
+Quad Procedure::phi(OpdID dst, size_t numPreds){
+	uint32_t start = static_cast<uint32_t>(phiSrcs.size());
+	phiSrcs.resize(phiSrcs.size() + numPreds, NO_OPD);
+	return Quad::make(PHI_QUAD, 0, dst,
+		static_cast<OpdID>(numPreds), NO_OPD, start);
+}
+
+UseSlots Procedure::useSlots(Quad& quad){
+	switch (quad.kind){
+	case BINOP_QUAD:
+		return UseSlots(&quad.src1, &quad.src2);
+	case ASSIGN_QUAD: case UNARYOP_QUAD: case IFZ_QUAD:
+	case REPORT_QUAD: case SETARG_QUAD: case SETRET_QUAD:
+		return UseSlots(&quad.src1);
+	case LOC_QUAD:
+		//Taking the location of src doesn't read its value
+		if (quad.srcIsLoc()){ return UseSlots(); }
+		return UseSlots(&quad.src1);
+	case PHI_QUAD:
+		return UseSlots(phiSrcs.data() + quad.aux, quad.src1);
+	default:
+		return UseSlots();
+	}
+}
 
+//Only the label column is built up as a string, so the
+// padding after it can be measured
+static void writeLabels(std::ostream& out, const std::vector<Label *>& labels){
+	std::string lbls = "";
 	auto first = true;
 
 	size_t labelSpace = 12;
 	for (auto label : labels){
 		if (first){ first = false; }
-		else { res += ","; }
+		else { lbls += ","; }
 
-		res += label->getName();
+		lbls += label->getName();
 	}
-	if (!first){ res += ": "; }
-	else { res += "  "; }
-	size_t spaces;
-	if (res.length() > labelSpace){ spaces = 0; }
-	else { spaces = labelSpace - res.length(); }
-	for (size_t i = 0; i < spaces; i++){
-		res += " ";
-	}
-
-	res += this->repr();
-	if (verbose){
-		res += commentStr();
+	if (!first){ lbls += ": "; }
+	else { lbls += "  "; }
+	out << lbls;
+	for (size_t i = lbls.length(); i < labelSpace; i++){
+		out << ' ';
 	}
-
-	return res;
-}
-
-CallQuad::CallQuad(SemSymbol * calleeIn) : callee(calleeIn){ }
-
-std::string CallQuad::repr(){
-	return "call " + callee->getName();
-}
-
-EnterQuad::EnterQuad(Procedure * procIn)
-: Quad(), myProc(procIn) { }
-
-std::string EnterQuad::repr(){
-	return "enter " + myProc->getName();
 }
 
-LeaveQuad::LeaveQuad(Procedure * procIn)
-: Quad(), myProc(procIn) { }
-
-std::string LeaveQuad::repr(){
-	return "leave " + myProc->getName();
-}
-
-std::string AssignQuad::repr(){
-	return dst->valString() + " := " + src->valString();
-	
+void Procedure::writeQuad(std::ostream& out, const Quad& quad, bool verbose){
+	writeLabels(out, labelsOf(quad));
+	out << repr(quad);
+	if (verbose && quad.comment != 0){
+		out << "  #" << commentOf(quad);
+	}
 }
 
-AssignQuad::AssignQuad(Opd * dstIn, Opd * srcIn): dst(dstIn), src(srcIn){
-	assert(dstIn != nullptr);
-	assert(srcIn != nullptr);
+void Procedure::writeEnter(std::ostream& out){
+	writeLabels(out, std::vector<Label *>(1, enterLabel));
+	out << "enter " << getName();
 }
 
-BinOpQuad::BinOpQuad(Opd * dstIn, BinOp oprIn, Opd * src1In, Opd * src2In)
-: dst(dstIn), opr(oprIn), src1(src1In), src2(src2In){
-	assert(dstIn != nullptr);
-	assert(src1In != nullptr);
-	assert(src2In != nullptr);
+void Procedure::writeLeave(std::ostream& out){
+	writeLabels(out, std::vector<Label *>(1, leaveLabel));
+	out << "leave " << getName();
 }
 
-std::string BinOpQuad::oprString(BinOp opr){
+std::string Quad::oprString(BinOp opr){
 	switch(opr){
 	case ADD64: return "ADD64";  
 	case SUB64: return "SUB64";  
@@ -108,124 +133,77 @@ std::string BinOpQuad::oprString(BinOp opr){
 
 }
 
-std::string BinOpQuad::repr(){
-	std::string opString;
-	return dst->valString()
-		+ " := " 
-		+ src1->valString()
-		+ " " + BinOpQuad::oprString(opr) + " "
-		+ src2->valString();
-}
-
-UnaryOpQuad::UnaryOpQuad(Opd * dstIn, UnaryOp opIn, Opd * srcIn)
-: dst(dstIn), op(opIn), src(srcIn) { 
-	assert(dstIn != nullptr);
-	assert(srcIn != nullptr);
-}
-
-std::string UnaryOpQuad::repr(){
-	std::string opString;
-	switch (op){
-	case NEG64:
-		opString = "NEG64 ";
-		break;
-	case NOT8:
-		opString = "NOT8 ";
+std::string Procedure::repr(const Quad& quad){
+	auto val = [&](OpdID id){ return opds[id]->valString(); };
+	switch (quad.kind){
+	case ASSIGN_QUAD:
+		return val(quad.dst) + " := " + val(quad.src1);
+	case BINOP_QUAD:
+		return val(quad.dst)
+			+ " := " 
+			+ val(quad.src1)
+			+ " " + Quad::oprString(quad.binOp()) + " "
+			+ val(quad.src2);
+	case UNARYOP_QUAD: {
+		std::string opString;
+		switch (quad.unaryOp()){
+		case NEG64:
+			opString = "NEG64 ";
+			break;
+		case NOT8:
+			opString = "NOT8 ";
+		}
+		return val(quad.dst) + " := " 
+			+ opString
+			+ val(quad.src1);
 	}
-	return dst->valString() + " := " 
-		+ opString
-		+ src->valString();
-}
+	case LOC_QUAD: {
+		std::string res = "";
+		if (quad.tgtIsLoc()){ res += opds[quad.dst]->locString(); } 
+		else { res += val(quad.dst); }
 
-ReportQuad::ReportQuad(Opd * opd, const DataType * type) 
-: myArg(opd), myType(type){ }
-
-std::string ReportQuad::repr(){
-	return "REPORT " + myArg->valString();
-}
-
-ReceiveQuad::ReceiveQuad(Opd * opd, const DataType * type)
-: myArg(opd), myType(type){ }
-
-std::string ReceiveQuad::repr(){
-	return "RECEIVE " + myArg->valString();
-}
-
-GotoQuad::GotoQuad(Label * tgtIn)
-: Quad(), tgt(tgtIn){ }
-
-std::string GotoQuad::repr(){
-	std::string res = "";
-	return "goto " + tgt->getName();
-}
+		res += " := ";
+		if (quad.srcIsLoc()){ res += opds[quad.src1]->locString(); }
+		else { res += val(quad.src1); }
 
-IfzQuad::IfzQuad(Opd * cndIn, Label * tgtIn) 
-: Quad(), cnd(cndIn), tgt(tgtIn){ }
-
-std::string IfzQuad::repr(){
-	std::string res = "IFZ ";
-	res += cnd->valString();
-	res += " GOTO ";
-	res += tgt->getName();
-	return res;
-}
-
-NopQuad::NopQuad()
-: Quad() { }
-
-std::string NopQuad::repr(){
-	return "nop";
-}
-
-GetRetQuad::GetRetQuad(Opd * opdIn)
-: Quad(), opd(opdIn) { }
-
-std::string GetRetQuad::repr(){
-	std::string res = "";
-	res += "getret " + opd->valString(); 
-	return res;
-}
-
-SetArgQuad::SetArgQuad(size_t indexIn, Opd * opdIn) 
-: index(indexIn), opd(opdIn){
-}
-
-std::string SetArgQuad::repr(){
-	std::string res = "";
-	res += "setarg " + std::to_string(index) + " " + opd->valString(); 
-	return res;
-}
-
-GetArgQuad::GetArgQuad(size_t indexIn, Opd * opdIn) 
-: index(indexIn), opd(opdIn){
-}
-
-std::string GetArgQuad::repr(){
-	std::string res = "";
-	res += "getarg " + std::to_string(index) + " " + opd->valString(); 
-	return res;
-}
-
-SetRetQuad::SetRetQuad(Opd * opdIn) 
-: opd(opdIn){
-}
-
-std::string SetRetQuad::repr(){
-	std::string res = "";
-	res += "setret " + opd->valString(); 
-	return res;
-}
-
-std::string LocQuad::repr(){
-	std::string res = "";
-	if (tgtIsLoc){ res += tgt->locString(); } 
-	else { res += tgt->valString(); }
-
-	res += " := ";
-	if (srcIsLoc){ res += src->locString(); }
-	else { res += src->valString(); }
-
-	return res;
+		return res;
+	}
+	case GOTO_QUAD:
+		return "goto " + labels[quad.target()]->getName();
+	case IFZ_QUAD: {
+		std::string res = "IFZ ";
+		res += val(quad.src1);
+		res += " GOTO ";
+		res += labels[quad.target()]->getName();
+		return res;
+	}
+	case NOP_QUAD:
+		return "nop";
+	case REPORT_QUAD:
+		return "REPORT " + val(quad.src1);
+	case RECEIVE_QUAD:
+		return "RECEIVE " + val(quad.dst);
+	case PHI_QUAD: {
+		std::string res = val(quad.dst) + " := PHI(";
+		for (size_t i = 0; i < quad.src1; i++){
+			if (i > 0){ res += ", "; }
+			OpdID src = phiSrc(quad, i);
+			res += src == NO_OPD ? "?" : val(src);
+		}
+		return res + ")";
+	}
+	case CALL_QUAD:
+		return "call " + getCallee(quad)->getName();
+	case SETARG_QUAD:
+		return "setarg " + std::to_string(quad.argIndex()) + " " + val(quad.src1);
+	case GETARG_QUAD:
+		return "getarg " + std::to_string(quad.argIndex()) + " " + val(quad.dst);
+	case SETRET_QUAD:
+		return "setret " + val(quad.src1);
+	case GETRET_QUAD:
+		return "getret " + val(quad.dst);
+	}
+	throw new InternalError("Unknown quad kind");
 }
 
 }
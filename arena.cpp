@@ -0,0 +1,115 @@
+#include <cstdint>
+#include <cstdlib>
+#include "arena.hpp"
+#include "errors.hpp"
+
+namespace cminusminus{
+
+static thread_local Arena * currentArena = nullptr;
+
+Arena::Arena(size_t chunkSizeIn) : chunkSize(chunkSizeIn){ }
+
+Arena::Arena(Arena * parentIn, size_t chunkSizeIn) 
+: chunkSize(chunkSizeIn), parent(parentIn){ }
+
+Arena::~Arena(){
+	reset();
+}
+
+void Arena::newChunk(size_t minSize){
+	size_t size = chunkSize;
+	if (minSize + sizeof(Chunk) > size){
+		size = minSize + sizeof(Chunk);
+	}
+	Chunk * chunk = static_cast<Chunk *>(std::malloc(size));
+	if (chunk == nullptr){ throw std::bad_alloc(); }
+	chunk->prev = chunks;
+	chunk->size = size;
+	chunks = chunk;
+	cur = reinterpret_cast<char *>(chunk + 1);
+	end = reinterpret_cast<char *>(chunk) + size;
+}
+
+void * Arena::allocate(size_t size, size_t align){
+	size_t pad = (align - reinterpret_cast<uintptr_t>(cur) % align) % align;
+	if (cur == nullptr || pad + size > static_cast<size_t>(end - cur)){
+		newChunk(size + align);
+		pad = (align - reinterpret_cast<uintptr_t>(cur) % align) % align;
+	}
+	char * res = cur + pad;
+	cur = res + size;
+	allocated += size;
+	return res;
+}
+
+void Arena::addFinalizer(void (*fn)(void *), void * obj){
+	void * mem = allocate(sizeof(Finalizer), alignof(Finalizer));
+	finalizers = new (mem) Finalizer{fn, obj, finalizers};
+}
+
+void Arena::dropFinalizer(void * obj){
+	for (Finalizer ** f = &finalizers; *f != nullptr; f = &(*f)->next){
+		if ((*f)->obj == obj){
+			*f = (*f)->next;
+			return;
+		}
+	}
+}
+
+void Arena::reset(){
+	//Finalizers run newest-first, while all the memory
+	// they might touch is still live
+	for (Finalizer * f = finalizers; f != nullptr; f = f->next){
+		f->fn(f->obj);
+	}
+	finalizers = nullptr;
+
+	while (chunks != nullptr){
+		Chunk * prev = chunks->prev;
+		std::free(chunks);
+		chunks = prev;
+	}
+	cur = nullptr;
+	end = nullptr;
+	allocated = 0;
+	indices = 0;
+}
+
+Arena * Arena::current(){
+	if (currentArena == nullptr){
+		throw new InternalError("Arena object built outside"
+			" of any arena scope");
+	}
+	return currentArena;
+}
+
+Arena::Scope::Scope(Arena * arena) : prev(currentArena){
+	currentArena = arena;
+}
+
+Arena::Scope::~Scope(){
+	currentArena = prev;
+}
+
+static void finalizeObject(void * obj){
+	static_cast<ArenaObject *>(obj)->~ArenaObject();
+}
+
+void * ArenaObject::operator new(size_t size){
+	Arena * arena = Arena::current();
+	void * mem = arena->allocate(size);
+	//The object isn't built yet. If its constructor throws,
+	// delete takes the finalizer back off (see below).
+	arena->addFinalizer(finalizeObject, mem);
+	return mem;
+}
+
+void ArenaObject::operator delete(void * mem){
+	//Either the constructor threw, in which case this is
+	// still the arena it was allocated from (and its
+	// finalizer is at or near the front), or the object
+	// has been destroyed already
+	if (currentArena != nullptr){ currentArena->dropFinalizer(mem); }
+}
+
+}
@@ -0,0 +1,147 @@
+#ifndef CMINUSMINUS_ARENA_HPP
+#define CMINUSMINUS_ARENA_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cminusminus{
+
+//A bump allocator that owns everything built for a single
+// compilation: AST nodes, tokens and the lists
+// that hold them. Allocation is a pointer bump inside a
+// large chunk, and all of it is released at once by
+// reset() (or when the arena is destroyed).
+//
+//The arena that "new" should draw from is chosen with an
+// Arena::Scope, so code that builds nodes (the parser
+// actions, the scanner, type analysis) doesn't have to
+// pass the arena around explicitly.
+class Arena{
+public:
+	Arena(size_t chunkSizeIn = 64 * 1024);
+	//An arena for work done on another thread while parent
+	// is in use (see Workers). It has memory of its own,
+	// but takes node indices from parent's counter, so they
+	// stay unique across the compilation.
+	explicit Arena(Arena * parentIn, size_t chunkSizeIn = 64 * 1024);
+	~Arena();
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	void * allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+	//Run the destructor for obj when the arena is reset
+	void addFinalizer(void (*fn)(void *), void * obj);
+	//Forget the newest finalizer added for obj, if there
+	// is one, so it won't be run
+	void dropFinalizer(void * obj);
+
+	//Build a T inside the arena. Its destructor is run at
+	// reset() if it has one that matters.
+	template <typename T, typename... Args>
+	T * make(Args&&... args){
+		void * mem = allocate(sizeof(T), alignof(T));
+		T * obj = new (mem) T(std::forward<Args>(args)...);
+		if (!std::is_trivially_destructible<T>::value){
+			addFinalizer(destroy<T>, obj);
+		}
+		return obj;
+	}
+
+	//Destroy everything in the arena and release its memory
+	void reset();
+
+	size_t bytesAllocated() const { return allocated; }
+
+	//Objects built in the arena can take a dense index
+	// from this counter, which restarts at zero with
+	// each compilation. AST nodes use it to key the
+	// per-node results of later passes.
+	uint32_t nextIndex(){
+		return parent != nullptr ? parent->nextIndex() : indices++;
+	}
+	uint32_t indicesIssued() const { return indices; }
+
+	//The arena that arena-backed objects are currently
+	// being built in (per thread)
+	static Arena * current();
+
+	//While a Scope is alive, current() returns its arena
+	class Scope{
+	public:
+		Scope(Arena * arena);
+		~Scope();
+	private:
+		Arena * prev;
+	};
+
+private:
+	template <typename T>
+	static void destroy(void * obj){ static_cast<T *>(obj)->~T(); }
+
+	struct Chunk{
+		Chunk * prev;
+		size_t size;
+	};
+	struct Finalizer{
+		void (*fn)(void *);
+		void * obj;
+		Finalizer * next;
+	};
+
+	void newChunk(size_t minSize);
+
+	size_t chunkSize;
+	Chunk * chunks = nullptr;
+	char * cur = nullptr;
+	char * end = nullptr;
+	Finalizer * finalizers = nullptr;
+	size_t allocated = 0;
+	Arena * parent = nullptr;
+	std::atomic<uint32_t> indices{0};
+};
+
+//Base class for objects that are always built in the
+// current arena. Plain "new" on a subclass takes its
+// memory from Arena::current(), and the (virtual)
+// destructor is called when the arena is reset.
+//"delete" frees nothing, but it does stop the arena from
+// destroying the object again. That's also what keeps a
+// half-built object from being destroyed: if a 
+// constructor throws, the new expression calls delete on
+// the memory before the exception leaves it.
+class ArenaObject{
+public:
+	virtual ~ArenaObject(){ }
+	static void * operator new(size_t size);
+	static void operator delete(void * mem);
+};
+
+//A stateless std allocator that draws from Arena::current(),
+// so that standard containers built during a compilation
+// live in the arena too
+template <typename T>
+class ArenaAllocator{
+public:
+	using value_type = T;
+	ArenaAllocator(){ }
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>&){ }
+	T * allocate(size_t n){
+		return static_cast<T *>(
+			Arena::current()->allocate(n * sizeof(T), alignof(T)));
+	}
+	void deallocate(T *, size_t){ }
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>&) const { return true; }
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>&) const { return false; }
+};
+
+}
+
+#endif
@@ -5,6 +5,7 @@
 #include <sstream>
 #include <string.h>
 #include <list>
+#include "arena.hpp"
 #include "tokens.hpp"
 #include "types.hpp"
 #include "3ac.hpp"
@@ -17,6 +18,7 @@ class Opd;
 
 class SymbolTable;
 class SemSymbol;
+class Workers;
 
 class DeclNode;
 class VarDeclNode;
@@ -28,62 +30,78 @@ class ExpNode;
 class LValNode;
 class IDNode;
 
-class ASTNode{
+//Lists of child nodes are allocated in the same arena
+// as the nodes themselves
+template <typename T>
+using ASTList = std::list<T, ArenaAllocator<T>>;
+
+class ASTNode : public ArenaObject{
 public:
-	ASTNode(Position * pos) : myPos(pos){ }
+	ASTNode(const Position& pos) 
+	: myPos(pos), myIndex(Arena::current()->nextIndex()){ }
 	virtual void unparse(std::ostream&, int) = 0;
-	Position * pos() { return myPos; };
-	std::string posStr(){ return pos()->span(); }
+	const Position& pos() const { return myPos; };
+	//A number unique to this node within its compilation,
+	// handed out densely from 0 in the order nodes are built
+	uint32_t index() const { return myIndex; }
+	std::string posStr(){ return pos().span(); }
 	virtual bool nameAnalysis(SymbolTable *) = 0;
 	//Note that there is no ASTNode::typeAnalysis. To allow
 	// for different type signatures, type analysis is 
 	// implemented as needed in various subclasses
 	virtual std::string nodeKind() = 0;
 protected:
-	Position * myPos = nullptr;
+	Position myPos;
+private:
+	uint32_t myIndex;
 };
 
 class ProgramNode : public ASTNode{
 public:
-	ProgramNode(std::list<DeclNode *> * globalsIn);
+	ProgramNode(ASTList<DeclNode *> * globalsIn);
 	virtual std::string nodeKind() override { return "Program"; }
 	void unparse(std::ostream&, int) override;
 	virtual bool nameAnalysis(SymbolTable *) override;
-	virtual void typeAnalysis(TypeAnalysis *);
-	IRProgram * to3AC(TypeAnalysis * ta);
+	//Each pass handles the declarations in order, and then
+	// the function bodies, which are independent of one
+	// another, on workers
+	bool nameAnalysis(SymbolTable * symTab, Workers& workers);
+	void typeAnalysis(TypeAnalysis * typing, Workers& workers);
+	IRProgram * to3AC(TypeAnalysis * ta, Workers& workers);
 	virtual ~ProgramNode(){ }
 private:
-	std::list<DeclNode *> * myGlobals;
+	ASTList<DeclNode *> * myGlobals;
 };
 
 class ExpNode : public ASTNode{
 protected:
-	ExpNode(Position * p) : ASTNode(p){ }
+	ExpNode(const Position& p) : ASTNode(p){ }
 public:
 	virtual void unparseNested(std::ostream& out);
 	//virtual void unparse(std::ostream& out, int indent) override = 0;
 	virtual bool nameAnalysis(SymbolTable * symTab) override = 0;
 	virtual void typeAnalysis(TypeAnalysis *) = 0;
-	virtual Opd * flatten(Procedure * proc) = 0;
+	virtual OpdID flatten(Procedure * proc) = 0;
 };
 
 class LValNode : public ExpNode{
 public:
-	LValNode(Position * p) : ExpNode(p){}
+	LValNode(const Position& p) : ExpNode(p){}
 	virtual std::string nodeKind() override { return "LVal"; }
 	void unparse(std::ostream& out, int indent) override = 0;
 	void unparseNested(std::ostream& out) override;
 	void attachSymbol(SemSymbol * symbolIn) { } 
 	bool nameAnalysis(SymbolTable * symTab) override { return false; }
 	virtual void typeAnalysis(TypeAnalysis *) override {; } 
-	virtual Opd * flatten(Procedure * proc) override;
+	virtual OpdID flatten(Procedure * proc) override;
 };
 
 class IDNode : public LValNode{
 public:
-	IDNode(Position * p, std::string nameIn)
+	IDNode(const Position& p, NameID nameIn)
 	: LValNode(p), name(nameIn), mySymbol(nullptr){}
-	std::string getName(){ return name; }
+	const std::string& getName(){ return Interner::spelling(name); }
+	NameID getNameID() const { return name; }
 	virtual std::string nodeKind() override { return "ID"; }
 	void unparse(std::ostream& out, int indent) override;
 	void attachSymbol(SemSymbol * symbolIn);
@@ -91,15 +109,15 @@ public:
 	const DataType * getType() { return mySymbol -> getDataType(); }
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * proc) override;
+	virtual OpdID flatten(Procedure * proc) override;
 private:
-	std::string name;
+	NameID name;
 	SemSymbol * mySymbol;
 };
 
 class TypeNode : public ASTNode{
 public:
-	TypeNode(Position * p) : ASTNode(p){ }
+	TypeNode(const Position& p) : ASTNode(p){ }
 	void unparse(std::ostream&, int) override = 0;
 	virtual std::string nodeKind() override = 0;
 	virtual const DataType * getType() = 0;
@@ -109,7 +127,7 @@ public:
 
 class StmtNode : public ASTNode{
 public:
-	StmtNode(Position * p) : ASTNode(p){ }
+	StmtNode(const Position& p) : ASTNode(p){ }
 	virtual void unparse(std::ostream& out, int indent) override = 0;
 	virtual std::string nodeKind() override = 0;
 	virtual void typeAnalysis(TypeAnalysis *) = 0;
@@ -118,17 +136,24 @@ public:
 
 class DeclNode : public StmtNode{
 public:
-	DeclNode(Position * p) : StmtNode(p){ }
+	DeclNode(const Position& p) : StmtNode(p){ }
 	void unparse(std::ostream& out, int indent) override =0;
 	virtual std::string nodeKind() override = 0;
 	virtual void typeAnalysis(TypeAnalysis *) override = 0;
 	virtual void to3AC(IRProgram * prog) = 0;
 	virtual void to3AC(Procedure * proc) override = 0;
+	//A function's body is analyzed and lowered apart from
+	// the rest of its declaration, which the other global
+	// declarations may depend on (see ProgramNode).
+	// Other declarations have no body.
+	virtual bool nameAnalysisBody(SymbolTable *){ return true; }
+	virtual void typeAnalysisBody(TypeAnalysis *){ }
+	virtual void to3ACBody(){ }
 };
 
 class VarDeclNode : public DeclNode{
 public:
-	VarDeclNode(Position * p, TypeNode * typeIn, IDNode * IDIn)
+	VarDeclNode(const Position& p, TypeNode * typeIn, IDNode * IDIn)
 	: DeclNode(p), myType(typeIn), myID(IDIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "VarDecl"; }
@@ -145,7 +170,7 @@ private:
 
 class FormalDeclNode : public VarDeclNode{
 public:
-	FormalDeclNode(Position * p, TypeNode * type, IDNode * id) 
+	FormalDeclNode(const Position& p, TypeNode * type, IDNode * id) 
 	: VarDeclNode(p, type, id){ }
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "FormalDecl"; }
@@ -155,36 +180,41 @@ public:
 
 class FnDeclNode : public DeclNode{
 public:
-	FnDeclNode(Position * p, 
+	FnDeclNode(const Position& p, 
 	  TypeNode * retTypeIn, IDNode * idIn,
-	  std::list<FormalDeclNode *> * formalsIn,
-	  std::list<StmtNode *> * bodyIn)
+	  ASTList<FormalDeclNode *> * formalsIn,
+	  ASTList<StmtNode *> * bodyIn)
 	: DeclNode(p), myRetType(retTypeIn), myID(idIn),
 	  myFormals(formalsIn), myBody(bodyIn){ 
 	}
 	IDNode * ID() const { return myID; }
-	std::list<FormalDeclNode *> * getFormals() const{
+	ASTList<FormalDeclNode *> * getFormals() const{
 		return myFormals;
 	}
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "FnDecl"; }
 	virtual bool nameAnalysis(SymbolTable * symTab) override;
+	virtual bool nameAnalysisBody(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void typeAnalysisBody(TypeAnalysis *) override;
 	void to3AC(IRProgram * prog) override;
 	void to3AC(Procedure * prog) override;
+	virtual void to3ACBody() override;
 	virtual TypeNode * getRetTypeNode() { 
 		return myRetType;
 	}
 private:
 	TypeNode * myRetType;
 	IDNode * myID;
-	std::list<FormalDeclNode *> * myFormals;
-	std::list<StmtNode *> * myBody;
+	ASTList<FormalDeclNode *> * myFormals;
+	ASTList<StmtNode *> * myBody;
+	//The procedure to3AC(IRProgram *) made for the body
+	Procedure * myProc = nullptr;
 };
 
 class AssignStmtNode : public StmtNode{
 public:
-	AssignStmtNode(Position * p, AssignExpNode * expIn)
+	AssignStmtNode(const Position& p, AssignExpNode * expIn)
 	: StmtNode(p), myExp(expIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "AssignStmt"; }
@@ -197,7 +227,7 @@ private:
 
 class ReadStmtNode : public StmtNode{
 public:
-	ReadStmtNode(Position * p, LValNode * dstIn)
+	ReadStmtNode(const Position& p, LValNode * dstIn)
 	: StmtNode(p), myDst(dstIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "ReceiveStmt"; }
@@ -210,7 +240,7 @@ private:
 
 class WriteStmtNode : public StmtNode{
 public:
-	WriteStmtNode(Position * p, ExpNode * srcIn)
+	WriteStmtNode(const Position& p, ExpNode * srcIn)
 	: StmtNode(p), mySrc(srcIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "ReportStmt"; }
@@ -223,7 +253,7 @@ private:
 
 class PostDecStmtNode : public StmtNode{
 public:
-	PostDecStmtNode(Position * p, LValNode * lvalIn)
+	PostDecStmtNode(const Position& p, LValNode * lvalIn)
 	: StmtNode(p), myLVal(lvalIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "PostDecStmt"; }
@@ -236,7 +266,7 @@ private:
 
 class PostIncStmtNode : public StmtNode{
 public:
-	PostIncStmtNode(Position * p, LValNode * lvalIn)
+	PostIncStmtNode(const Position& p, LValNode * lvalIn)
 	: StmtNode(p), myLVal(lvalIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "PostIncStmt"; }
@@ -249,8 +279,8 @@ private:
 
 class IfStmtNode : public StmtNode{
 public:
-	IfStmtNode(Position * p, ExpNode * condIn,
-	  std::list<StmtNode *> * bodyIn)
+	IfStmtNode(const Position& p, ExpNode * condIn,
+	  ASTList<StmtNode *> * bodyIn)
 	: StmtNode(p), myCond(condIn), myBody(bodyIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "IfStmt"; }
@@ -259,14 +289,14 @@ public:
 	virtual void to3AC(Procedure * prog) override;
 private:
 	ExpNode * myCond;
-	std::list<StmtNode *> * myBody;
+	ASTList<StmtNode *> * myBody;
 };
 
 class IfElseStmtNode : public StmtNode{
 public:
-	IfElseStmtNode(Position * p, ExpNode * condIn, 
-	  std::list<StmtNode *> * bodyTrueIn,
-	  std::list<StmtNode *> * bodyFalseIn)
+	IfElseStmtNode(const Position& p, ExpNode * condIn, 
+	  ASTList<StmtNode *> * bodyTrueIn,
+	  ASTList<StmtNode *> * bodyFalseIn)
 	: StmtNode(p), myCond(condIn),
 	  myBodyTrue(bodyTrueIn), myBodyFalse(bodyFalseIn) { }
 	void unparse(std::ostream& out, int indent) override;
@@ -276,14 +306,14 @@ public:
 	virtual void to3AC(Procedure * prog) override;
 private:
 	ExpNode * myCond;
-	std::list<StmtNode *> * myBodyTrue;
-	std::list<StmtNode *> * myBodyFalse;
+	ASTList<StmtNode *> * myBodyTrue;
+	ASTList<StmtNode *> * myBodyFalse;
 };
 
 class WhileStmtNode : public StmtNode{
 public:
-	WhileStmtNode(Position * p, ExpNode * condIn, 
-	  std::list<StmtNode *> * bodyIn)
+	WhileStmtNode(const Position& p, ExpNode * condIn, 
+	  ASTList<StmtNode *> * bodyIn)
 	: StmtNode(p), myCond(condIn), myBody(bodyIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "WhileStmt"; }
@@ -292,12 +322,12 @@ public:
 	virtual void to3AC(Procedure * prog) override;
 private:
 	ExpNode * myCond;
-	std::list<StmtNode *> * myBody;
+	ASTList<StmtNode *> * myBody;
 };
 
 class ReturnStmtNode : public StmtNode{
 public:
-	ReturnStmtNode(Position * p, ExpNode * exp)
+	ReturnStmtNode(const Position& p, ExpNode * exp)
 	: StmtNode(p), myExp(exp){ }
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "ReturnStmt"; }
@@ -310,8 +340,8 @@ private:
 
 class CallExpNode : public ExpNode{
 public:
-	CallExpNode(Position * p, IDNode * id,
-	  std::list<ExpNode *> * argsIn)
+	CallExpNode(const Position& p, IDNode * id,
+	  ASTList<ExpNode *> * argsIn)
 	: ExpNode(p), myID(id), myArgs(argsIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	void unparseNested(std::ostream& out) override;
@@ -320,20 +350,20 @@ public:
 	void typeAnalysis(TypeAnalysis *) override;
 	const DataType * getRetType() { return myID -> getType(); }
 
-	virtual Opd * flatten(Procedure * proc) override;
-	Opd* flattenAsStmt(Procedure * proc);
+	virtual OpdID flatten(Procedure * proc) override;
+	OpdID flattenAsStmt(Procedure * proc);
 private:
 	IDNode * myID;
-	std::list<ExpNode *> * myArgs;
+	ASTList<ExpNode *> * myArgs;
 };
 
 class BinaryExpNode : public ExpNode{
 public:
-	BinaryExpNode(Position * p, ExpNode * lhs, ExpNode * rhs)
+	BinaryExpNode(const Position& p, ExpNode * lhs, ExpNode * rhs)
 	: ExpNode(p), myExp1(lhs), myExp2(rhs) { }
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override = 0;
-	virtual Opd * flatten(Procedure * prog) override = 0;
+	virtual OpdID flatten(Procedure * prog) override = 0;
 protected:
 	ExpNode * myExp1;
 	ExpNode * myExp2;
@@ -345,143 +375,143 @@ protected:
 
 class PlusNode : public BinaryExpNode{
 public:
-	PlusNode(Position * p, ExpNode * e1, ExpNode * e2)
+	PlusNode(const Position& p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "Plus"; }
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 };
 
 class MinusNode : public BinaryExpNode{
 public:
-	MinusNode(Position * p, ExpNode * e1, ExpNode * e2)
+	MinusNode(const Position& p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "Minus"; }
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 };
 
 class TimesNode : public BinaryExpNode{
 public:
-	TimesNode(Position * p, ExpNode * e1In, ExpNode * e2In)
+	TimesNode(const Position& p, ExpNode * e1In, ExpNode * e2In)
 	: BinaryExpNode(p, e1In, e2In){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "Times"; }
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 };
 
 class DivideNode : public BinaryExpNode{
 public:
-	DivideNode(Position * p, ExpNode * e1, ExpNode * e2)
+	DivideNode(const Position& p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "Divide"; }
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 };
 
 class AndNode : public BinaryExpNode{
 public:
-	AndNode(Position * p, ExpNode * e1, ExpNode * e2)
+	AndNode(const Position& p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "And"; }
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 };
 
 class OrNode : public BinaryExpNode{
 public:
-	OrNode(Position * p, ExpNode * e1, ExpNode * e2)
+	OrNode(const Position& p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "Or"; }
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 };
 
 class EqualsNode : public BinaryExpNode{
 public:
-	EqualsNode(Position * p, ExpNode * e1, ExpNode * e2)
+	EqualsNode(const Position& p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "Eq"; }
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 	
 };
 
 class NotEqualsNode : public BinaryExpNode{
 public:
-	NotEqualsNode(Position * p, ExpNode * e1, ExpNode * e2)
+	NotEqualsNode(const Position& p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "NotEq"; }
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 	
 };
 
 class LessNode : public BinaryExpNode{
 public:
-	LessNode(Position * p, ExpNode * e1, ExpNode * e2)
+	LessNode(const Position& p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "Less"; }
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * proc) override;
+	virtual OpdID flatten(Procedure * proc) override;
 };
 
 class LessEqNode : public BinaryExpNode{
 public:
-	LessEqNode(Position * pos, ExpNode * e1, ExpNode * e2)
+	LessEqNode(const Position& pos, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(pos, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "LessEq"; }
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 };
 
 class GreaterNode : public BinaryExpNode{
 public:
-	GreaterNode(Position * p, ExpNode * e1, ExpNode * e2)
+	GreaterNode(const Position& p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "GreaterEq"; }
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * proc) override;
+	virtual OpdID flatten(Procedure * proc) override;
 };
 
 class GreaterEqNode : public BinaryExpNode{
 public:
-	GreaterEqNode(Position * p, ExpNode * e1, ExpNode * e2)
+	GreaterEqNode(const Position& p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "GreaterEq"; }
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 };
 
 class UnaryExpNode : public ExpNode {
 public:
-	UnaryExpNode(Position * p, ExpNode * expIn) 
+	UnaryExpNode(const Position& p, ExpNode * expIn) 
 	: ExpNode(p){
 		this->myExp = expIn;
 	}
 	virtual void unparse(std::ostream& out, int indent) override = 0;
 	virtual bool nameAnalysis(SymbolTable * symTab) override = 0;
 	virtual void typeAnalysis(TypeAnalysis *) override = 0;
-	virtual Opd * flatten(Procedure * prog) override = 0;
+	virtual OpdID flatten(Procedure * prog) override = 0;
 protected:
 	ExpNode * myExp;
 };
 
 class ShortToIntNode : public UnaryExpNode{
 public:
-	ShortToIntNode(Position * p, ExpNode * expIn): UnaryExpNode(p, expIn) { }
+	ShortToIntNode(const Position& p, ExpNode * expIn): UnaryExpNode(p, expIn) { }
 	void unparse(std::ostream& out, int indent) override {
 		myExp->unparse(out, indent);
 	}
@@ -494,63 +524,63 @@ public:
 	virtual void typeAnalysis(TypeAnalysis * ta) override {
 		return myExp->typeAnalysis(ta); 
 	}
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 };
 
 
 class RefNode : public UnaryExpNode{
 public:
-	RefNode(Position * p, IDNode * IDIn) 
+	RefNode(const Position& p, IDNode * IDIn) 
 	: UnaryExpNode(p, IDIn), myID(IDIn){
 	}
 	std::string nodeKind() override { return "&"; }
 	virtual void unparse(std::ostream& out, int indent) override;
 	virtual bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 protected:
 	IDNode * myID;
 };
 
 class DerefNode : public LValNode{
 public:
-	DerefNode(Position * p, IDNode * IDIn) 
+	DerefNode(const Position& p, IDNode * IDIn) 
 	: LValNode(p), myID(IDIn){
 	}
 	std::string nodeKind() override { return "Deref"; }
 	virtual void unparse(std::ostream& out, int indent) override;
 	virtual bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 protected:
 	IDNode * myID;
 };
 
 class NegNode : public UnaryExpNode{
 public:
-	NegNode(Position * p, ExpNode * exp)
+	NegNode(const Position& p, ExpNode * exp)
 	: UnaryExpNode(p, exp){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "Neg"; }
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 };
 
 class NotNode : public UnaryExpNode{
 public:
-	NotNode(Position * p, ExpNode * exp)
+	NotNode(const Position& p, ExpNode * exp)
 	: UnaryExpNode(p, exp){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "Not"; }
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 };
 
 class VoidTypeNode : public TypeNode{
 public:
-	VoidTypeNode(Position * p) : TypeNode(p){}
+	VoidTypeNode(const Position& p) : TypeNode(p){}
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "VoidType"; }
 	virtual const DataType * getType()override { 
@@ -560,7 +590,7 @@ public:
 
 class PtrTypeNode : public TypeNode{
 public:
-	PtrTypeNode(Position * p, TypeNode * baseTypeIn)
+	PtrTypeNode(const Position& p, TypeNode * baseTypeIn)
 	:TypeNode(p), myBaseType(baseTypeIn) { }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "PTR " + myBaseType->nodeKind(); }
@@ -572,7 +602,7 @@ private:
 
 class IntTypeNode : public TypeNode{
 public:
-	IntTypeNode(Position * p): TypeNode(p){}
+	IntTypeNode(const Position& p): TypeNode(p){}
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "IntType"; }
 	virtual const DataType * getType() override;
@@ -580,7 +610,7 @@ public:
 
 class ShortTypeNode : public TypeNode{
 public:
-	ShortTypeNode(Position * p): TypeNode(p){}
+	ShortTypeNode(const Position& p): TypeNode(p){}
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "ShortType"; }
 	virtual const DataType * getType() override { return BasicType::SHORT(); }
@@ -588,7 +618,7 @@ public:
 
 class BoolTypeNode : public TypeNode{
 public:
-	BoolTypeNode(Position * p): TypeNode(p) { }
+	BoolTypeNode(const Position& p): TypeNode(p) { }
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "BoolType"; }
 	virtual const DataType * getType() override;
@@ -596,7 +626,7 @@ public:
 
 class StringTypeNode : public TypeNode{
 public:
-	StringTypeNode(Position * p): TypeNode(p) { }
+	StringTypeNode(const Position& p): TypeNode(p) { }
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "StringType"; }
 	virtual const DataType * getType() override;
@@ -621,13 +651,13 @@ private:
 
 class AssignExpNode : public ExpNode{
 public:
-	AssignExpNode(Position * p, LValNode * dstIn, ExpNode * srcIn)
+	AssignExpNode(const Position& p, LValNode * dstIn, ExpNode * srcIn)
 	: ExpNode(p), myDst(dstIn), mySrc(srcIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	virtual std::string nodeKind() override { return "AssignExp"; }
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * proc) override;
+	virtual OpdID flatten(Procedure * proc) override;
 private:
 	LValNode * myDst;
 	ExpNode * mySrc;
@@ -635,7 +665,7 @@ private:
 
 class ShortLitNode : public ExpNode{
 public:
-	ShortLitNode(Position * p, const int numIn)
+	ShortLitNode(const Position& p, const int numIn)
 	: ExpNode(p), myNum(numIn){ }
 	virtual void unparseNested(std::ostream& out) override{
 		unparse(out, 0);
@@ -644,14 +674,14 @@ public:
 	virtual std::string nodeKind() override { return "ShortLit"; }
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 private:
 	const int myNum;
 };
 
 class IntLitNode : public ExpNode{
 public:
-	IntLitNode(Position * p, const int numIn)
+	IntLitNode(const Position& p, const int numIn)
 	: ExpNode(p), myNum(numIn){ }
 	virtual void unparseNested(std::ostream& out) override{
 		unparse(out, 0);
@@ -660,14 +690,14 @@ public:
 	virtual std::string nodeKind() override { return "IntLit"; }
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 private:
 	const int myNum;
 };
 
 class StrLitNode : public ExpNode{
 public:
-	StrLitNode(Position * p, const std::string strIn)
+	StrLitNode(const Position& p, StrRef strIn)
 	: ExpNode(p), myStr(strIn){ }
 	virtual void unparseNested(std::ostream& out) override{
 		unparse(out, 0);
@@ -676,16 +706,17 @@ public:
 	virtual std::string nodeKind() override { return "StrLit"; }
 	bool nameAnalysis(SymbolTable *) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * proc) override;
+	virtual OpdID flatten(Procedure * proc) override;
 private:
-	 const std::string myStr;
+	 //Refers into the source, like the token it came from
+	 const StrRef myStr;
 };
 
 
 
 class TrueNode : public ExpNode{
 public:
-	TrueNode(Position * p): ExpNode(p){ }
+	TrueNode(const Position& p): ExpNode(p){ }
 	virtual void unparseNested(std::ostream& out) override{
 		unparse(out, 0);
 	}
@@ -693,12 +724,12 @@ public:
 	virtual std::string nodeKind() override { return "True"; }
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 };
 
 class FalseNode : public ExpNode{
 public:
-	FalseNode(Position * p): ExpNode(p){ }
+	FalseNode(const Position& p): ExpNode(p){ }
 	virtual void unparseNested(std::ostream& out) override{
 		unparse(out, 0);
 	}
@@ -706,12 +737,12 @@ public:
 	virtual std::string nodeKind() override { return "False"; }
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
-	virtual Opd * flatten(Procedure * prog) override;
+	virtual OpdID flatten(Procedure * prog) override;
 };
 
 class CallStmtNode : public StmtNode{
 public:
-	CallStmtNode(Position * p, CallExpNode * expIn)
+	CallStmtNode(const Position& p, CallExpNode * expIn)
 	: StmtNode(p), myCallExp(expIn){ }
 	void unparse(std::ostream& out, int indent) override;
 	std::string nodeKind() override { return "CallStmt"; }
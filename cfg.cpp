@@ -0,0 +1,301 @@
+#include <algorithm>
+#include "cfg.hpp"
+
+namespace cminusminus{
+
+const size_t BasicBlock::NONE;
+
+CFG::CFG(Procedure * procIn) : proc(procIn){
+	split();
+	connect();
+	order();
+	dominators();
+}
+
+CFG::~CFG(){
+	for (auto block : myBlocks){ delete block; }
+	for (auto loop : myLoops){ delete loop; }
+}
+
+//A new block starts at the first quad, at every quad with
+// a label (something may jump there) and after every jump
+void CFG::split(){
+	std::vector<Quad>& quads = proc->getQuads();
+	labelBlocks.assign(proc->numLabels(), nullptr);
+	BasicBlock * cur = nullptr;
+	for (size_t i = 0; i < quads.size(); i++){
+		const Quad& quad = quads[i];
+		if (cur == nullptr || quad.hasLabels()){
+			if (cur != nullptr){ cur->last = i; }
+			cur = new BasicBlock(myBlocks.size());
+			cur->first = i;
+			myBlocks.push_back(cur);
+			for (auto lbl : proc->labelsOf(quad)){
+				labelBlocks[lbl->getSlot()] = cur;
+			}
+		}
+		if (quad.isJump()){
+			cur->last = i + 1;
+			cur = nullptr;
+		}
+	}
+	if (cur != nullptr){ cur->last = quads.size(); }
+
+	myExit = new BasicBlock(myBlocks.size());
+	myExit->first = quads.size();
+	myExit->last = quads.size();
+	myExit->exit = true;
+	myBlocks.push_back(myExit);
+	labelBlocks[proc->getLeaveLabel()->getSlot()] = myExit;
+	myEntry = myBlocks.front();
+}
+
+BasicBlock * CFG::blockOf(uint32_t lbl){
+	if (lbl >= labelBlocks.size() || labelBlocks[lbl] == nullptr){
+		throw new InternalError(("Jump to unplaced label "
+			+ proc->getLabel(lbl)->getName()).c_str());
+	}
+	return labelBlocks[lbl];
+}
+
+void CFG::connect(){
+	auto edge = [](BasicBlock * from, BasicBlock * to){
+		for (auto succ : from->mySuccs){
+			if (succ == to){ return; }
+		}
+		from->mySuccs.push_back(to);
+		to->myPreds.push_back(from);
+	};
+	for (size_t i = 0; i + 1 < myBlocks.size(); i++){
+		BasicBlock * block = myBlocks[i];
+		BasicBlock * next = myBlocks[i + 1];
+		const Quad& last = proc->getQuads()[block->last - 1];
+		if (last.kind == GOTO_QUAD){
+			edge(block, blockOf(last.target()));
+		} else if (last.kind == IFZ_QUAD){
+			edge(block, next);
+			edge(block, blockOf(last.target()));
+		} else {
+			edge(block, next);
+		}
+	}
+}
+
+void CFG::order(){
+	//An explicit stack of (block, next successor to visit)
+	std::vector<std::pair<BasicBlock *, size_t>> stack;
+	std::vector<bool> seen(myBlocks.size(), false);
+	std::vector<BasicBlock *> post;
+	stack.push_back(std::make_pair(myEntry, 0));
+	seen[myEntry->id] = true;
+	while (!stack.empty()){
+		BasicBlock * block = stack.back().first;
+		size_t& next = stack.back().second;
+		if (next < block->mySuccs.size()){
+			BasicBlock * succ = block->mySuccs[next++];
+			if (!seen[succ->id]){
+				seen[succ->id] = true;
+				stack.push_back(std::make_pair(succ, 0));
+			}
+		} else {
+			post.push_back(block);
+			stack.pop_back();
+		}
+	}
+	myRPO.assign(post.rbegin(), post.rend());
+	for (size_t i = 0; i < myRPO.size(); i++){
+		myRPO[i]->rpo = i;
+	}
+}
+
+//The iterative algorithm of Cooper, Harvey and Kennedy
+// ("A Simple, Fast Dominance Algorithm")
+void CFG::dominators(){
+	auto intersect = [](BasicBlock * a, BasicBlock * b){
+		while (a != b){
+			while (a->rpo > b->rpo){ a = a->myIdom; }
+			while (b->rpo > a->rpo){ b = b->myIdom; }
+		}
+		return a;
+	};
+
+	myEntry->myIdom = myEntry;
+	bool changed = true;
+	while (changed){
+		changed = false;
+		for (size_t i = 1; i < myRPO.size(); i++){
+			BasicBlock * block = myRPO[i];
+			BasicBlock * idom = nullptr;
+			for (auto pred : block->myPreds){
+				if (pred->myIdom == nullptr){ continue; }
+				idom = idom ? intersect(pred, idom) : pred;
+			}
+			if (idom != block->myIdom){
+				block->myIdom = idom;
+				changed = true;
+			}
+		}
+	}
+	myEntry->myIdom = nullptr;
+
+	for (size_t i = 1; i < myRPO.size(); i++){
+		myRPO[i]->myIdom->myDomChildren.push_back(myRPO[i]);
+	}
+
+	domPre.assign(myBlocks.size(), BasicBlock::NONE);
+	domSize.assign(myBlocks.size(), 0);
+	std::vector<std::pair<BasicBlock *, size_t>> stack;
+	size_t counter = 0;
+	stack.push_back(std::make_pair(myEntry, 0));
+	domPre[myEntry->id] = counter++;
+	while (!stack.empty()){
+		BasicBlock * block = stack.back().first;
+		size_t& next = stack.back().second;
+		if (next < block->myDomChildren.size()){
+			BasicBlock * child = block->myDomChildren[next++];
+			domPre[child->id] = counter++;
+			stack.push_back(std::make_pair(child, 0));
+		} else {
+			domSize[block->id] = counter - domPre[block->id];
+			stack.pop_back();
+		}
+	}
+}
+
+bool CFG::dominates(BasicBlock * a, BasicBlock * b){
+	if (!a->reachable() || !b->reachable()){ return false; }
+	size_t pa = domPre[a->id];
+	size_t pb = domPre[b->id];
+	return pa <= pb && pb < pa + domSize[a->id];
+}
+
+//From Cooper, Harvey and Kennedy again: walk up the
+// dominator tree from each predecessor of a join until
+// reaching the join's immediate dominator
+const std::vector<BasicBlock *>& CFG::frontier(BasicBlock * block){
+	if (frontiers.empty()){
+		frontiers.resize(myBlocks.size());
+		for (auto join : myRPO){
+			if (join->myPreds.size() < 2){ continue; }
+			for (auto pred : join->myPreds){
+				if (!pred->reachable()){ continue; }
+				for (BasicBlock * runner = pred; runner != join->myIdom;
+					runner = runner->myIdom){
+					std::vector<BasicBlock *>& df = frontiers[runner->id];
+					if (df.empty() || df.back() != join){
+						df.push_back(join);
+					}
+				}
+			}
+		}
+	}
+	return frontiers[block->id];
+}
+
+size_t CFG::predIndex(BasicBlock * block, BasicBlock * pred){
+	for (size_t i = 0; i < block->myPreds.size(); i++){
+		if (block->myPreds[i] == pred){ return i; }
+	}
+	throw new InternalError("Not a predecessor");
+}
+
+void CFG::findLoops(){
+	loopsFound = true;
+	//Each loop's index in myLoops, and its blocks as a set
+	HashMap<BasicBlock *, size_t> byHeader;
+	std::vector<std::vector<bool>> members;
+	for (auto block : myRPO){
+		for (auto header : block->mySuccs){
+			if (!dominates(header, block)){ continue; }
+			auto found = byHeader.find(header);
+			if (found == byHeader.end()){
+				Loop * loop = new Loop();
+				loop->header = header;
+				loop->blocks.push_back(header);
+				found = byHeader.emplace(header, myLoops.size()).first;
+				myLoops.push_back(loop);
+				members.push_back(std::vector<bool>(myBlocks.size(), false));
+				members.back()[header->id] = true;
+			}
+			Loop * loop = myLoops[found->second];
+			std::vector<bool>& in = members[found->second];
+			loop->latches.push_back(block);
+
+			//Walk back from the latch until the header
+			std::vector<BasicBlock *> work;
+			if (!in[block->id]){
+				in[block->id] = true;
+				loop->blocks.push_back(block);
+				work.push_back(block);
+			}
+			while (!work.empty()){
+				BasicBlock * cur = work.back();
+				work.pop_back();
+				for (auto pred : cur->myPreds){
+					if (in[pred->id] || !pred->reachable()){ continue; }
+					in[pred->id] = true;
+					loop->blocks.push_back(pred);
+					work.push_back(pred);
+				}
+			}
+		}
+	}
+
+	//Smaller loops are nested inside larger ones that hold
+	// their header, so going from the largest down lets
+	// each loop find its parent and overwrite the
+	// innermost loop of its blocks
+	std::vector<size_t> bySize(myLoops.size());
+	for (size_t i = 0; i < bySize.size(); i++){ bySize[i] = i; }
+	std::sort(bySize.begin(), bySize.end(), [&](size_t a, size_t b){
+		return myLoops[a]->blocks.size() > myLoops[b]->blocks.size();
+	});
+	innermost.assign(myBlocks.size(), nullptr);
+	for (size_t i : bySize){
+		Loop * loop = myLoops[i];
+		loop->parent = innermost[loop->header->id];
+		if (loop->parent != nullptr){
+			loop->depth = loop->parent->depth + 1;
+		}
+		for (auto block : loop->blocks){
+			innermost[block->id] = loop;
+		}
+	}
+}
+
+void CFG::print(std::ostream& out){
+	for (auto block : myBlocks){
+		out << "B" << block->id;
+		if (block->exit){ out << " (exit)"; }
+		if (!block->reachable()){ out << " (unreachable)"; }
+		out << " ->";
+		for (auto succ : block->mySuccs){ out << " B" << succ->id; }
+		if (block->myIdom != nullptr){
+			out << "  idom B" << block->myIdom->id;
+		}
+		if (block->reachable() && !frontier(block).empty()){
+			out << "  df";
+			for (auto join : frontier(block)){ out << " B" << join->id; }
+		}
+		if (Loop * loop = loopOf(block)){
+			out << "  loop B" << loop->header->id
+				<< " depth " << loop->depth;
+		}
+		out << "\n";
+		for (size_t i = block->first; i != block->last; i++){
+			proc->writeQuad(out, proc->getQuads()[i]);
+			out << "\n";
+		}
+	}
+}
+
+void IRProgram::writeCFGs(std::ostream& out){
+	for (Procedure * proc : *procs){
+		out << "[BEGIN " << proc->getName() << " CFG]\n";
+		CFG cfg(proc);
+		cfg.print(out);
+		out << "[END " << proc->getName() << " CFG]\n";
+	}
+}
+
+}
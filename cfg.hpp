@@ -0,0 +1,138 @@
+#ifndef CMINUSMINUS_CFG_HPP
+#define CMINUSMINUS_CFG_HPP
+
+#include <vector>
+#include "3ac.hpp"
+
+namespace cminusminus{
+
+//A maximal run of quads that is only entered at its first
+// quad and only left after its last. The quads themselves
+// stay in the procedure's body; a block just marks the
+// range [begin, end) of indices into it.
+class BasicBlock{
+public:
+	BasicBlock(size_t idIn) : id(idIn){ }
+	size_t getID() const { return id; }
+	size_t begin() const { return first; }
+	size_t end() const { return last; }
+	bool isExit() const { return exit; }
+
+	const std::vector<BasicBlock *>& succs() const { return mySuccs; }
+	const std::vector<BasicBlock *>& preds() const { return myPreds; }
+
+	//Position in the reverse post-order, or NONE if the
+	// block can't be reached from the entry
+	size_t rpoIndex() const { return rpo; }
+	//The immediate dominator (nullptr for the entry and for
+	// unreachable blocks), and the blocks it dominates
+	// immediately
+	BasicBlock * idom() const { return myIdom; }
+	const std::vector<BasicBlock *>& domChildren() const {
+		return myDomChildren;
+	}
+	bool reachable() const { return rpo != NONE; }
+
+	static const size_t NONE = static_cast<size_t>(-1);
+private:
+	size_t id;
+	size_t first;
+	size_t last;
+	bool exit = false;
+	std::vector<BasicBlock *> mySuccs;
+	std::vector<BasicBlock *> myPreds;
+	size_t rpo = NONE;
+	BasicBlock * myIdom = nullptr;
+	std::vector<BasicBlock *> myDomChildren;
+	friend class CFG;
+};
+
+//A natural loop: the header and every block that can reach
+// one of its back edges without passing through the header.
+// Back edges with the same header make up a single loop.
+class Loop{
+public:
+	BasicBlock * header;
+	std::vector<BasicBlock *> blocks;
+	std::vector<BasicBlock *> latches;
+	//The innermost loop this one is nested in, if any
+	Loop * parent = nullptr;
+	size_t depth = 1;
+};
+
+//The control-flow graph of one procedure's body. It is a
+// snapshot: any pass that changes the quads invalidates
+// it, and building a fresh one is linear in the size of
+// the body (plus the near-linear dominator computation),
+// so passes simply rebuild it.
+//Blocks are numbered in layout order. A final, empty exit
+// block stands for the procedure's leave quad, so a return
+// (a jump to the leave label) has somewhere to go.
+class CFG{
+public:
+	CFG(Procedure * proc);
+	~CFG();
+	CFG(const CFG&) = delete;
+	CFG& operator=(const CFG&) = delete;
+
+	Procedure * getProc(){ return proc; }
+	BasicBlock * entry(){ return myEntry; }
+	BasicBlock * exit(){ return myExit; }
+	const std::vector<BasicBlock *>& blocks(){ return myBlocks; }
+	//Reachable blocks in reverse post-order
+	const std::vector<BasicBlock *>& rpo(){ return myRPO; }
+	//The natural loops, found the first time they are asked
+	// for
+	const std::vector<Loop *>& loops(){
+		if (!loopsFound){ findLoops(); }
+		return myLoops;
+	}
+
+	//The block that starts with the quad the label with
+	// slot lbl is on
+	BasicBlock * blockOf(uint32_t lbl);
+	//The innermost loop containing block, if any
+	Loop * loopOf(BasicBlock * block){
+		if (!loopsFound){ findLoops(); }
+		return innermost[block->getID()];
+	}
+	//Whether a dominates b (every block dominates itself)
+	bool dominates(BasicBlock * a, BasicBlock * b);
+	//The blocks where block's dominance ends: those it
+	// doesn't strictly dominate but has a predecessor of
+	const std::vector<BasicBlock *>& frontier(BasicBlock * block);
+	//Which of block's predecessors pred is
+	size_t predIndex(BasicBlock * block, BasicBlock * pred);
+
+	//Each block with its successors, immediate dominator,
+	// dominance frontier and innermost loop, then its quads
+	void print(std::ostream& out);
+private:
+	void split();
+	void connect();
+	void order();
+	void dominators();
+	void findLoops();
+
+	Procedure * proc;
+	std::vector<BasicBlock *> myBlocks;
+	std::vector<BasicBlock *> myRPO;
+	std::vector<Loop *> myLoops;
+	std::vector<Loop *> innermost;
+	bool loopsFound = false;
+	//The block each label starts, by the label's slot
+	std::vector<BasicBlock *> labelBlocks;
+	BasicBlock * myEntry;
+	BasicBlock * myExit;
+	//Each block's position in a pre-order walk of the
+	// dominator tree, and the number of blocks below it,
+	// so dominance queries don't have to climb the tree
+	std::vector<size_t> domPre;
+	std::vector<size_t> domSize;
+	//Built the first time a frontier is asked for
+	std::vector<std::vector<BasicBlock *>> frontiers;
+};
+
+}
+
+#endif
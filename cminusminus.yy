@@ -13,7 +13,7 @@
 	#include "tokens.hpp"
 	#include "ast.hpp"
 	namespace cminusminus {
-		class Scanner;
+		class TokenReader;
 	}
 
 //The following definition is required when 
@@ -29,7 +29,7 @@
 //End "requires" code
 }
 
-%parse-param { cminusminus::Scanner &scanner }
+%parse-param { cminusminus::TokenReader &lexer }
 %parse-param { cminusminus::ProgramNode** root }
 %code{
    // C std code for utility functions
@@ -38,42 +38,37 @@
    #include <fstream>
 
    // Our code for interoperation between scanner/parser
-   #include "scanner.hpp"
+   #include "token_array.hpp"
    #include "ast.hpp"
    #include "tokens.hpp"
 
-  //Request tokens from our scanner member, not 
+  //Request tokens from our lexer member, not 
   // from a global function
   #undef yylex
-  #define yylex scanner.yylex
+  #define yylex lexer.yylex
 }
 
 %union {
    bool                                  transBool;
-   cminusminus::Token*                         transToken;
-   cminusminus::Token*                         lexeme;
-   cminusminus::IDToken*                       transIDToken;
-   cminusminus::IntLitToken*                   transIntToken;
-   cminusminus::IntLitToken*                   transShortToken;
-   cminusminus::StrToken*                      transStrToken;
+   const cminusminus::Token*                   transToken;
    cminusminus::ProgramNode*                   transProgram;
    cminusminus::DeclNode *                     transDecl;
-   std::list<cminusminus::DeclNode *> *        transDeclList;
+   cminusminus::ASTList<cminusminus::DeclNode *> *   transDeclList;
    cminusminus::VarDeclNode *                  transVarDecl;
-   std::list<cminusminus::VarDeclNode *> *     transVarDeclList;
+   cminusminus::ASTList<cminusminus::VarDeclNode *> * transVarDeclList;
    cminusminus::FormalDeclNode *               transFormal;
-   std::list<cminusminus::FormalDeclNode *> *  transFormalList;
+   cminusminus::ASTList<cminusminus::FormalDeclNode *> * transFormalList;
    cminusminus::TypeNode *                     transType;
    cminusminus::LValNode *                     transLVal;
    cminusminus::IDNode *                       transID;
    cminusminus::FnDeclNode *                   transFn;
-   std::list<cminusminus::VarDeclNode *> *     transVarDecls;
-   std::list<cminusminus::StmtNode *> *        transStmts;
+   cminusminus::ASTList<cminusminus::VarDeclNode *> * transVarDecls;
+   cminusminus::ASTList<cminusminus::StmtNode *> *   transStmts;
    cminusminus::StmtNode *                     transStmt;
    cminusminus::ExpNode *                      transExp;
    cminusminus::AssignExpNode *                transAssignExp;
    cminusminus::CallExpNode *                  transCallExp;
-   std::list<cminusminus::ExpNode *> *         transActuals;
+   cminusminus::ASTList<cminusminus::ExpNode *> *    transActuals;
 }
 
 %define parse.assert
@@ -92,11 +87,11 @@
 %token	<transToken>     FALSE
 %token	<transToken>     GREATER
 %token	<transToken>     GREATEREQ
-%token	<transIDToken>   ID
+%token	<transToken>     ID
 %token	<transToken>     IF
 %token	<transToken>     INC
 %token	<transToken>     INT
-%token	<transIntToken>  INTLITERAL
+%token	<transToken>     INTLITERAL
 %token	<transToken>     LCURLY
 %token	<transToken>     LESS
 %token	<transToken>     LESSEQ
@@ -113,9 +108,9 @@
 %token	<transToken>     RPAREN
 %token	<transToken>     SEMICOL
 %token	<transToken>     SHORT
-%token	<transShortToken> SHORTLITERAL
+%token	<transToken>     SHORTLITERAL
 %token	<transToken>     STRING
-%token	<transStrToken>  STRLITERAL
+%token	<transToken>     STRLITERAL
 %token	<transToken>     TIMES
 %token	<transToken>     TRUE
 %token	<transToken>     VOID
@@ -168,7 +163,7 @@ globals 	: globals decl
 	  	  }
 		| /* epsilon */
 		  {
-		  $$ = new std::list<DeclNode * >();
+		  $$ = Arena::current()->make<ASTList<DeclNode *>>();
 		  }
 
 decl 		: varDecl
@@ -178,7 +173,7 @@ decl 		: varDecl
 
 varDecl 	: type id SEMICOL
 		  {
-		  Position * p = new Position($1->pos(), $2->pos());
+		  Position p($1->pos(), $2->pos());
 		  $$ = new VarDeclNode(p, $1, $2);
 		  }
 
@@ -188,7 +183,7 @@ type		: primType
 		  }
 		| PTR primType
 		  {
-		  Position * p = new Position($1->pos(), $2->pos());
+		  Position p($1->pos(), $2->pos());
 		  $$ = new PtrTypeNode(p, $2);
 		  }
 primType 	: INT
@@ -214,19 +209,20 @@ primType 	: INT
 
 fnDecl 		: type id LPAREN RPAREN LCURLY stmtList RCURLY
 		  {
-		  Position * pos = new Position($1->pos(), $7->pos());
-		  std::list<FormalDeclNode *> * f = new std::list<FormalDeclNode *>();
+		  Position pos($1->pos(), $7->pos());
+		  ASTList<FormalDeclNode *> * f =
+		    Arena::current()->make<ASTList<FormalDeclNode *>>();
 		  $$ = new FnDeclNode(pos, $1, $2, f, $6);
 		  }
 		| type id LPAREN formals RPAREN LCURLY stmtList RCURLY
 		  {
-		  Position * pos = new Position($1->pos(), $8->pos());
+		  Position pos($1->pos(), $8->pos());
 		  $$ = new FnDeclNode(pos, $1, $2, $4, $7);
 		  }
 
 formals 	: formalDecl
 		  {
-		  $$ = new std::list<FormalDeclNode *>();
+		  $$ = Arena::current()->make<ASTList<FormalDeclNode *>>();
 		  $$->push_back($1);
 		  }
 		| formals COMMA formalDecl
@@ -237,13 +233,13 @@ formals 	: formalDecl
 
 formalDecl 	: type id
 		  {
-		  Position * pos = new Position($1->pos(), $2->pos());
+		  Position pos($1->pos(), $2->pos());
 		  $$ = new FormalDeclNode(pos, $1, $2);
 		  }
 
 stmtList 	: /* epsilon */
 	   	  {
-		  $$ = new std::list<StmtNode *>();
+		  $$ = Arena::current()->make<ASTList<StmtNode *>>();
 	   	  }
 		| stmtList stmt
 	  	  {
@@ -253,62 +249,61 @@ stmtList 	: /* epsilon */
 
 stmt		: varDecl
 		  {
-		  Position * p = $1->pos();
-		  $$ = new VarDeclNode(p, $1->getTypeNode(), $1->ID());
+		  $$ = new VarDeclNode($1->pos(), $1->getTypeNode(), $1->ID());
 		  }
 		| assignExp SEMICOL
 		  {
-		  Position * p = new Position($1->pos(), $2->pos());
+		  Position p($1->pos(), $2->pos());
 		  $$ = new AssignStmtNode(p, $1); 
 		  }
 		| lval DEC SEMICOL
 		  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new PostDecStmtNode(p, $1);
 		  }
 		| lval INC SEMICOL
 		  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new PostIncStmtNode(p, $1);
 		  }
 		| READ lval SEMICOL
 		  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new ReadStmtNode(p, $2);
 		  }
 		| WRITE exp SEMICOL
 		  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new WriteStmtNode(p, $2);
 		  }
 		| WHILE LPAREN exp RPAREN LCURLY stmtList RCURLY
 		  {
-		  Position * p = new Position($1->pos(), $7->pos());
+		  Position p($1->pos(), $7->pos());
 		  $$ = new WhileStmtNode(p, $3, $6);
 		  }
 		| IF LPAREN exp RPAREN LCURLY stmtList RCURLY
 		  {
-		  Position * p = new Position($1->pos(), $7->pos());
+		  Position p($1->pos(), $7->pos());
 		  $$ = new IfStmtNode(p, $3, $6);
 		  }
 		| IF LPAREN exp RPAREN LCURLY stmtList RCURLY ELSE LCURLY stmtList RCURLY
 		  {
-		  Position * p = new Position($1->pos(), $11->pos());
+		  Position p($1->pos(), $11->pos());
 		  $$ = new IfElseStmtNode(p, $3, $6, $10);
 		  }
 		| RETURN exp SEMICOL
 		  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new ReturnStmtNode(p, $2);
 		  }
 		| RETURN SEMICOL
 		  {
-		  Position * p = new Position($1->pos(), $2->pos());
+		  Position p($1->pos(), $2->pos());
 		  $$ = new ReturnStmtNode(p, nullptr);
 		  }
 		| callExp SEMICOL
 		  { 
-		  Position * p = new Position($1->pos(), $2->pos());
+		  Position p($1->pos(), $2->pos());
 		  $$ = new CallStmtNode(p, $1); 
 		  }
 
@@ -316,72 +311,72 @@ exp		: assignExp
 		  { $$ = $1; } 
 		| exp MINUS exp
 	  	  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new MinusNode(p, $1, $3);
 		  }
 		| exp PLUS exp
 	  	  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new PlusNode(p, $1, $3);
 		  }
 		| exp TIMES exp
 	  	  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new TimesNode(p, $1, $3);
 		  }
 		| exp DIVIDE exp
 	  	  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new DivideNode(p, $1, $3);
 		  }
 		| exp AND exp
 	  	  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new AndNode(p, $1, $3);
 		  }
 		| exp OR exp
 	  	  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new OrNode(p, $1, $3);
 		  }
 		| exp EQUALS exp
 	  	  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new EqualsNode(p, $1, $3);
 		  }
 		| exp NOTEQUALS exp
 	  	  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new NotEqualsNode(p, $1, $3);
 		  }
 		| exp GREATER exp
 	  	  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new GreaterNode(p, $1, $3);
 		  }
 		| exp GREATEREQ exp
 	  	  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new GreaterEqNode(p, $1, $3);
 		  }
 		| exp LESS exp
 	  	  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new LessNode(p, $1, $3);
 		  }
 		| exp LESSEQ exp
 	  	  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new LessEqNode(p, $1, $3);
 		  }
 		| NOT exp
 	  	  {
-		  Position * p = new Position($1->pos(), $2->pos());
+		  Position p($1->pos(), $2->pos());
 		  $$ = new NotNode(p, $2);
 		  }
 		| MINUS term
 	  	  {
-		  Position * p = new Position($1->pos(), $2->pos());
+		  Position p($1->pos(), $2->pos());
 		  $$ = new NegNode(p, $2);
 		  }
 		| term
@@ -389,27 +384,27 @@ exp		: assignExp
 
 assignExp	: lval ASSIGN exp
 		  {
-		  Position * p = new Position($1->pos(), $3->pos());
+		  Position p($1->pos(), $3->pos());
 		  $$ = new AssignExpNode(p, $1, $3);
 		  }
 
 callExp		: id LPAREN RPAREN
 		  {
-		  Position * p = new Position($1->pos(), $3->pos());
-		  std::list<ExpNode *> * noargs =
-		    new std::list<ExpNode *>();
+		  Position p($1->pos(), $3->pos());
+		  ASTList<ExpNode *> * noargs =
+		    Arena::current()->make<ASTList<ExpNode *>>();
 		  $$ = new CallExpNode(p, $1, noargs);
 		  }
 		| id LPAREN actualsList RPAREN
 		  {
-		  Position * p = new Position($1->pos(), $4->pos());
+		  Position p($1->pos(), $4->pos());
 		  $$ = new CallExpNode(p, $1, $3);
 		  }
 
 actualsList	: exp
 		  {
-		  std::list<ExpNode *> * list =
-		    new std::list<ExpNode *>();
+		  ASTList<ExpNode *> * list =
+		    Arena::current()->make<ASTList<ExpNode *>>();
 		  list->push_back($1);
 		  $$ = list;
 		  }
@@ -426,7 +421,7 @@ term 		: lval
 		| SHORTLITERAL 
 		  { $$ = new ShortLitNode($1->pos(), $1->num()); }
 		| STRLITERAL 
-		  { $$ = new StrLitNode($1->pos(), $1->str()); }
+		  { $$ = new StrLitNode($1->pos(), lexer.text($1)); }
 		| AMP id
 		  { $$ = new RefNode($1->pos(), $2); }
 		| TRUE
@@ -446,19 +441,18 @@ lval		: id
 		  }
 		| AT id
 		  {
-		  Position * pos = new Position($1->pos(), $2->pos());
+		  Position pos($1->pos(), $2->pos());
 		  $$ = new DerefNode(pos, $2);
 		  }
 
 id		: ID
 		  {
-		  Position * pos = $1->pos();
-		  $$ = new IDNode(pos, $1->value()); 
+		  $$ = new IDNode($1->pos(), $1->id()); 
 		  }
 	
 %%
 
 void cminusminus::Parser::error(const std::string& msg){
-	std::cout << msg << std::endl;
-	std::cerr << "syntax error" << std::endl;
+	Report::out() << msg << std::endl;
+	Report::err() << "syntax error" << std::endl;
 }
@@ -7,15 +7,15 @@ namespace cminusminus{
 
 class NameErr{
 public:
-static bool undeclID(Position * pos){
+static bool undeclID(const Position& pos){
 	Report::fatal(pos, "Undeclared identifier");
 	return false;
 }
-static bool badVarType(Position * pos){
+static bool badVarType(const Position& pos){
 	Report::fatal(pos, "Invalid type in declaration");
 	return false;
 }
-static bool multiDecl(Position * pos){
+static bool multiDecl(const Position& pos){
 	Report::fatal(pos, "Multiply declared identifier");
 	return false;
 }
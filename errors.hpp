@@ -50,22 +50,48 @@ private:
    a specific output format. */
 class Report{
 public:
+	//Where messages for the user go on this thread:
+	// std::cout and std::cerr, unless a Redirect is in
+	// place (as while a batch compiles one of its files,
+	// so that each file's messages are kept apart)
+	static std::ostream& out(){
+		return sink() == nullptr ? std::cout : *sink();
+	}
+	static std::ostream& err(){
+		return sink() == nullptr ? std::cerr : *sink();
+	}
+
+	//While a Redirect is alive, out() and err() on its
+	// thread both go to the stream it was given
+	class Redirect{
+	public:
+		Redirect(std::ostream * to) : prev(sink()){ sink() = to; }
+		~Redirect(){ sink() = prev; }
+	private:
+		std::ostream * prev;
+	};
+
 	static void fatal(
-		Position * pos,
+		const Position& pos,
 		const char * msg
 	){
-		std::cerr << "FATAL " 
-		<< pos->span()
+		err() << "FATAL " 
+		<< pos.span()
 		<< ": " 
 		<< msg  << std::endl;
 	}
 
 	static void fatal(
-		Position * pos,
+		const Position& pos,
 		const std::string msg
 	){
 		fatal(pos,msg.c_str());
 	}
+private:
+	static std::ostream *& sink(){
+		static thread_local std::ostream * to = nullptr;
+		return to;
+	}
 };
 
 }
@@ -0,0 +1,441 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <vector>
+#include "fast_scanner.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cminusminus{
+
+//The byte classes the scanner measures runs of, both a
+// byte at a time and (below) a block at a time
+static bool isBlank(unsigned char c){ return c == ' ' || c == '\t'; }
+static bool isDigit(unsigned char c){ return c >= '0' && c <= '9'; }
+static bool isLetter(unsigned char c){ 
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+static bool isWordChar(unsigned char c){
+	return isLetter(c) || isDigit(c) || c == '_';
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#if defined(__AVX2__)
+using Block = __m256i;
+static Block load(const char * at){ 
+	return _mm256_loadu_si256(reinterpret_cast<const Block *>(at)); 
+}
+static Block splat(char c){ return _mm256_set1_epi8(c); }
+static Block eq(Block a, Block b){ return _mm256_cmpeq_epi8(a, b); }
+static Block either(Block a, Block b){ return _mm256_or_si256(a, b); }
+static Block minus(Block a, Block b){ return _mm256_sub_epi8(a, b); }
+static Block least(Block a, Block b){ return _mm256_min_epu8(a, b); }
+static uint32_t bits(Block a){ 
+	return static_cast<uint32_t>(_mm256_movemask_epi8(a)); 
+}
+static const uint32_t ALL = 0xffffffff;
+#else
+using Block = __m128i;
+static Block load(const char * at){ 
+	return _mm_loadu_si128(reinterpret_cast<const Block *>(at)); 
+}
+static Block splat(char c){ return _mm_set1_epi8(c); }
+static Block eq(Block a, Block b){ return _mm_cmpeq_epi8(a, b); }
+static Block either(Block a, Block b){ return _mm_or_si128(a, b); }
+static Block minus(Block a, Block b){ return _mm_sub_epi8(a, b); }
+static Block least(Block a, Block b){ return _mm_min_epu8(a, b); }
+static uint32_t bits(Block a){ 
+	return static_cast<uint32_t>(_mm_movemask_epi8(a)); 
+}
+static const uint32_t ALL = 0xffff;
+#endif
+
+//Every byte of a block, with each lane set to all ones if
+// its byte is in the class and to zero if not
+static Block inRange(Block v, char lo, char hi){
+	Block off = minus(v, splat(lo));
+	return eq(least(off, splat(static_cast<char>(hi - lo))), off);
+}
+static Block blanks(Block v){
+	return either(eq(v, splat(' ')), eq(v, splat('\t')));
+}
+static Block digits(Block v){ return inRange(v, '0', '9'); }
+static Block wordChars(Block v){
+	Block letters = inRange(either(v, splat(0x20)), 'a', 'z');
+	return either(either(letters, digits(v)), eq(v, splat('_')));
+}
+#endif
+
+//How many bytes from from on (stopping at end) are in the 
+// class: whole blocks while there's a block left, then a
+// byte at a time
+#if defined(__AVX2__) || defined(__SSE2__)
+template <Block (*inBlock)(Block), bool (*inClass)(unsigned char)>
+#else
+template <bool (*inClass)(unsigned char)>
+#endif
+static size_t run(const char * from, const char * end){
+	const char * at = from;
+#if defined(__AVX2__) || defined(__SSE2__)
+	while (static_cast<size_t>(end - at) >= sizeof(Block)){
+		uint32_t out = ~bits(inBlock(load(at))) & ALL;
+		if (out != 0){
+			return static_cast<size_t>(at - from) 
+				+ static_cast<size_t>(__builtin_ctz(out));
+		}
+		at += sizeof(Block);
+	}
+#endif
+	while (at < end && inClass(static_cast<unsigned char>(*at))){ at++; }
+	return static_cast<size_t>(at - from);
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+static size_t blankRun(const char * from, const char * end){
+	return run<blanks, isBlank>(from, end);
+}
+static size_t digitRun(const char * from, const char * end){
+	return run<digits, isDigit>(from, end);
+}
+static size_t wordRun(const char * from, const char * end){
+	return run<wordChars, isWordChar>(from, end);
+}
+#else
+static size_t blankRun(const char * from, const char * end){
+	return run<isBlank>(from, end);
+}
+static size_t digitRun(const char * from, const char * end){
+	return run<isDigit>(from, end);
+}
+static size_t wordRun(const char * from, const char * end){
+	return run<isWordChar>(from, end);
+}
+#endif
+
+//The keywords, found by a hash of their first two bytes
+// and length that is perfect over this set (every keyword
+// is at least 2 bytes long), so one probe and one compare
+// tells a keyword from an identifier
+class Keyword{
+public:
+	const char * spelling = nullptr;
+	size_t len = 0;
+	int kind = 0;
+};
+static const size_t KEYWORD_SLOTS = 32;
+
+static size_t keywordSlot(const char * word, size_t len){
+	unsigned char first = static_cast<unsigned char>(word[0]);
+	unsigned char second = static_cast<unsigned char>(word[1]);
+	return (first + 2u * second + 19u * len) & (KEYWORD_SLOTS - 1);
+}
+
+static const Keyword * keywordTable(){
+	static const std::vector<Keyword> table = [](){
+		std::vector<Keyword> slots(KEYWORD_SLOTS);
+		const Keyword all[] = {
+			{"int", 3, TokenKind::INT},
+			{"bool", 4, TokenKind::BOOL},
+			{"short", 5, TokenKind::SHORT},
+			{"ptr", 3, TokenKind::PTR},
+			{"string", 6, TokenKind::STRING},
+			{"void", 4, TokenKind::VOID},
+			{"if", 2, TokenKind::IF},
+			{"else", 4, TokenKind::ELSE},
+			{"while", 5, TokenKind::WHILE},
+			{"return", 6, TokenKind::RETURN},
+			{"write", 5, TokenKind::WRITE},
+			{"read", 4, TokenKind::READ},
+			{"false", 5, TokenKind::FALSE},
+			{"true", 4, TokenKind::TRUE},
+			{"and", 3, TokenKind::AND},
+			{"or", 2, TokenKind::OR},
+			{"gets", 4, TokenKind::ASSIGN},
+		};
+		for (const Keyword& keyword : all){
+			Keyword& slot = slots[keywordSlot(keyword.spelling, keyword.len)];
+			if (slot.spelling != nullptr){
+				throw new InternalError("Keyword hash isn't perfect");
+			}
+			slot = keyword;
+		}
+		return slots;
+	}();
+	return table.data();
+}
+
+static const size_t KEYWORD_MIN = 2;
+static const size_t KEYWORD_MAX = 6;
+
+//Whether c may follow a backslash in a string literal
+static bool isEscapee(char c){
+	return c == 'n' || c == 't' || c == '"' || c == '\\';
+}
+
+FastScanner::FastScanner(const SourceFile& src, size_t begin, size_t end, 
+	size_t firstLine)
+: Lexer(firstLine), base(src.data()), p(src.data() + begin), 
+  limit(src.data() + end){
+	keywordTable();
+}
+
+int FastScanner::bare(int kind, size_t len){
+	makeToken(kind, len);
+	p += len;
+	return kind;
+}
+
+void FastScanner::illegal(){
+	Position pos(lineNum, colNum, lineNum, colNum + 1);
+	//As flex's yytext, a NUL byte reads as nothing
+	errIllegal(pos, *p == '\0' ? std::string() : std::string(1, *p));
+	colNum++;
+	p++;
+}
+
+int FastScanner::word(){
+	size_t len = wordRun(p, limit);
+	if (len >= KEYWORD_MIN && len <= KEYWORD_MAX){
+		const Keyword& slot = keywordTable()[keywordSlot(p, len)];
+		if (slot.len == len && memcmp(slot.spelling, p, len) == 0){
+			return bare(slot.kind, len);
+		}
+	}
+	makeIDToken(len, StrRef(p, len));
+	p += len;
+	return TokenKind::ID;
+}
+
+//The literal's checks are the ones the flex rules make,
+// down to how atoi and strtol treat values that are too
+// big, so that the same messages come out for the same
+// text
+int FastScanner::number(){
+	size_t numLen = digitRun(p, limit);
+	bool isShort = numLen < static_cast<size_t>(limit - p) && p[numLen] == 'S';
+	size_t len = numLen + (isShort ? 1 : 0);
+	size_t zeros = 0;
+	while (zeros < numLen && p[zeros] == '0'){ zeros++; }
+	bool tooLong = numLen - zeros > 10;
+
+	//The value, as strtol would give it (stopping at 
+	// LONG_MAX)
+	const unsigned long long most = static_cast<unsigned long long>(LONG_MAX);
+	unsigned long long val = 0;
+	for (size_t i = zeros; i < numLen; i++){
+		unsigned digit = static_cast<unsigned>(p[i] - '0');
+		if (val > (most - digit) / 10){
+			val = most;
+			break;
+		}
+		val = val * 10 + digit;
+	}
+
+	Position pos(lineNum, colNum, lineNum, colNum + len);
+	if (isShort){
+		int intVal = static_cast<int>(static_cast<long>(val));
+		bool overflow = intVal > 32767 || tooLong;
+		bool underflow = intVal < -32768;
+		if (overflow){
+			errShortOverflow(pos);
+			intVal = 0;
+		}
+		if (underflow){
+			errShortUnderflow(pos);
+			intVal = 0;
+		}
+		makeNumToken(TokenKind::SHORTLITERAL, len, intVal);
+		p += len;
+		return TokenKind::SHORTLITERAL;
+	}
+
+	int intVal = static_cast<int>(val);
+	if (tooLong || val > INT_MAX){
+		errIntOverflow(pos);
+		intVal = 0;
+	}
+	makeNumToken(TokenKind::INTLITERAL, len, intVal);
+	p += len;
+	return TokenKind::INTLITERAL;
+}
+
+//cminusminus.l has four rules for string literals: 
+// (1) "{STRELT}*"  a good literal
+// (2) "{STRELT}*   unterminated
+// (3) "({STRELT}*{BADESC}{STRELT}*)+(\\")?  unterminated,
+//     with a bad escape
+// (4) "({STRELT}*{BADESC}{STRELT}*)+"  with a bad escape
+//As flex does, take the longest match, and of those the
+// first rule. (1) and (2) only ever have one way through
+// the text. (3) and (4) can split a backslash several ways
+// (a bad escape may be the backslash alone), so every way
+// is followed at once, keeping for each byte whether it
+// can be reached, and whether a bad escape has been seen
+// on the way. A way only ever moves on by one or two
+// bytes, so only the next three bytes' states are kept,
+// and the walk stops once none can be reached: at the
+// line's end or an unescaped quote.
+bool FastScanner::string(){
+	const char * body = p + 1;
+	const char * q = body;
+	bool sawBackslash = false;
+	while (q < limit && *q != '\n' && *q != '"'){
+		if (*q == '\\'){
+			sawBackslash = true;
+			if (q + 1 < limit && isEscapee(q[1])){
+				q += 2;
+				continue;
+			}
+			break;
+		}
+		q++;
+	}
+	size_t matched[4] = {0, 0, 0, 0};
+	if (q < limit && *q == '"'){ matched[0] = static_cast<size_t>(q - p) + 1; }
+	matched[1] = static_cast<size_t>(q - p);
+
+	if (sawBackslash){
+		//Bit 0: reachable with no bad escape, bit 1: with one.
+		// reach[k] is for the byte k past the current one.
+		unsigned char reach[3] = {1, 0, 0};
+		for (size_t i = 0; (reach[0] | reach[1] | reach[2]) != 0; i++){
+			unsigned char st = reach[0];
+			reach[0] = reach[1];
+			reach[1] = reach[2];
+			reach[2] = 0;
+			if (st == 0){ continue; }
+			const char * at = body + i;
+			//Whether this byte, and the one after, are still
+			// on the line
+			bool here = at < limit && at[0] != '\n';
+			bool next = here && at + 1 < limit && at[1] != '\n';
+			if (st & 2){
+				matched[2] = std::max(matched[2], i + 1);
+				if (next && at[0] == '\\' && at[1] == '"'){
+					matched[2] = std::max(matched[2], i + 3);
+				}
+				if (here && at[0] == '"'){
+					matched[3] = std::max(matched[3], i + 2);
+				}
+			}
+			if (!here || at[0] == '"'){ continue; }
+			if (at[0] != '\\'){
+				reach[0] |= st;
+				continue;
+			}
+			reach[0] |= 2;
+			if (next){
+				if (isEscapee(at[1])){
+					reach[1] |= st;
+				} else {
+					reach[1] |= 2;
+				}
+			}
+		}
+	}
+
+	size_t rule = 0;
+	for (size_t i = 1; i < 4; i++){
+		if (matched[i] > matched[rule]){ rule = i; }
+	}
+	size_t len = matched[rule];
+	if (rule == 0){
+		makeStrToken(len, static_cast<size_t>(p - base));
+		p += len;
+		return true;
+	}
+	Position pos(lineNum, colNum, lineNum, colNum + len);
+	if (rule == 1){
+		errStrUnterm(pos);
+	} else if (rule == 2){
+		errStrEscAndUnterm(pos);
+	} else {
+		errStrEsc(pos);
+	}
+	colNum += len;
+	p += len;
+	return false;
+}
+
+int FastScanner::yylex(Token * const tok){
+	yylval = tok;
+	while (p < limit){
+		bool hasNext = limit - p > 1;
+		char next = hasNext ? p[1] : '\0';
+		switch (*p){
+		case ' ': case '\t': {
+			size_t len = blankRun(p, limit);
+			colNum += len;
+			p += len;
+			continue;
+		}
+		case '\n':
+			lineNum++;
+			colNum = 1;
+			p++;
+			continue;
+		case '\r':
+			if (hasNext && next == '\n'){
+				lineNum++;
+				colNum = 1;
+				p += 2;
+			} else {
+				illegal();
+			}
+			continue;
+		case '#': {
+			const void * lineEnd = memchr(p, '\n', static_cast<size_t>(limit - p));
+			const char * stop = lineEnd == nullptr ? limit 
+				: static_cast<const char *>(lineEnd);
+			colNum += static_cast<size_t>(stop - p);
+			p = stop;
+			continue;
+		}
+		case '"':
+			if (string()){ return TokenKind::STRLITERAL; }
+			continue;
+		case '@': return bare(TokenKind::AT, 1);
+		case '&': return bare(TokenKind::AMP, 1);
+		case '{': return bare(TokenKind::LCURLY, 1);
+		case '}': return bare(TokenKind::RCURLY, 1);
+		case '(': return bare(TokenKind::LPAREN, 1);
+		case ')': return bare(TokenKind::RPAREN, 1);
+		case ';': return bare(TokenKind::SEMICOL, 1);
+		case ',': return bare(TokenKind::COMMA, 1);
+		case '*': return bare(TokenKind::TIMES, 1);
+		case '/': return bare(TokenKind::DIVIDE, 1);
+		case '+':
+			if (next == '+'){ return bare(TokenKind::INC, 2); }
+			return bare(TokenKind::PLUS, 1);
+		case '-':
+			if (next == '-'){ return bare(TokenKind::DEC, 2); }
+			return bare(TokenKind::MINUS, 1);
+		case '!':
+			if (next == '='){ return bare(TokenKind::NOTEQUALS, 2); }
+			return bare(TokenKind::NOT, 1);
+		case '=':
+			if (next == '='){ return bare(TokenKind::EQUALS, 2); }
+			return bare(TokenKind::ASSIGN, 1);
+		case '<':
+			if (next == '='){ return bare(TokenKind::LESSEQ, 2); }
+			return bare(TokenKind::LESS, 1);
+		case '>':
+			if (next == '='){ return bare(TokenKind::GREATEREQ, 2); }
+			return bare(TokenKind::GREATER, 1);
+		default: {
+			unsigned char c = static_cast<unsigned char>(*p);
+			if (isLetter(c) || c == '_'){ return word(); }
+			if (isDigit(c)){ return number(); }
+			illegal();
+			continue;
+		}
+		}
+	}
+	return TokenKind::END;
+}
+
+}
@@ -0,0 +1,41 @@
+#include "interner.hpp"
+#include "errors.hpp"
+
+namespace cminusminus{
+
+Interner& Interner::instance(){
+	static Interner interner;
+	return interner;
+}
+
+NameID Interner::intern(StrRef spelling){
+	Interner& self = instance();
+	{
+		std::shared_lock<std::shared_timed_mutex> hold(self.lock);
+		auto found = self.ids.find(spelling);
+		if (found != self.ids.end()){
+			return found->second;
+		}
+	}
+	std::unique_lock<std::shared_timed_mutex> hold(self.lock);
+	//Someone else may have added it in the meantime
+	auto found = self.ids.find(spelling);
+	if (found != self.ids.end()){
+		return found->second;
+	}
+	NameID id = static_cast<NameID>(self.spellings.size());
+	self.spellings.push_back(spelling.str());
+	self.ids.insert(std::make_pair(StrRef(self.spellings.back()), id));
+	return id;
+}
+
+const std::string& Interner::spelling(NameID id){
+	Interner& self = instance();
+	std::shared_lock<std::shared_timed_mutex> hold(self.lock);
+	if (id >= self.spellings.size()){
+		throw new InternalError("Unknown interned name");
+	}
+	return self.spellings[id];
+}
+
+}
@@ -0,0 +1,47 @@
+#ifndef CMINUSMINUS_INTERNER_HPP
+#define CMINUSMINUS_INTERNER_HPP
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include "source.hpp"
+
+namespace cminusminus{
+
+//A stable small integer standing for one identifier
+// spelling. Two identifiers are the same name exactly
+// when their NameIDs are equal.
+using NameID = uint32_t;
+
+//The global identifier interner. Each distinct spelling
+// is stored once, when the scanner first sees it, and is
+// referred to by its NameID from then on (by the AST, the
+// symbol table, and the 3AC operands). The spelling is
+// only looked up again when something is printed.
+//It is shared by every file being compiled, so it is
+// locked; lookups of names already seen only take the
+// lock shared.
+//Spellings are looked up by reference (usually straight
+// into the mapped source) and only copied the first time
+// they are seen.
+class Interner{
+public:
+	static NameID intern(StrRef spelling);
+	static const std::string& spelling(NameID id);
+private:
+	static Interner& instance();
+	std::shared_timed_mutex lock;
+	//The keys refer to the strings in spellings
+	std::unordered_map<StrRef, NameID, StrRef::Hash> ids;
+	//A deque never moves its elements, so references 
+	// returned by spelling() (and the keys of ids) stay
+	// valid
+	std::deque<std::string> spellings;
+};
+
+}
+
+#endif
@@ -0,0 +1,635 @@
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "3ac.hpp"
+
+//An interpreter for the 3AC (cmmc --run).
+//
+//Each procedure is first translated into a compact
+// bytecode of three-operand instructions, where every
+// operand is a 32-bit index: the top two bits pick the
+// current frame, the globals or the procedure's constant
+// pool, and the rest is the slot. Labels become instruction
+// indices, and a quad that reads or writes through an
+// AddrOpd is split into a load or store plus a plain
+// instruction on a scratch slot.
+//A frame holds the incoming arguments first, then the two
+// scratch slots, then the procedure's locals, formals and
+// temps. Frames are stacked in one fixed block, so the
+// address of a local stays valid while it is in scope, and
+// a caller writes arguments straight into the slots just
+// past its own frame, where the callee's frame will start.
+//With GCC or Clang the loop is direct-threaded: each
+// instruction holds the address of its handler, and
+// handlers jump straight to the next one (computed goto).
+// Elsewhere it falls back to a switch.
+
+#if defined(__GNUC__)
+#define CMM_THREADED_DISPATCH 1
+#endif
+
+namespace cminusminus{
+
+enum VMOp : uint32_t {
+	VM_ADD, VM_SUB, VM_MUL, VM_DIV, VM_EQ, VM_NE, VM_LT, VM_GT,
+	VM_LE, VM_GE, VM_AND, VM_OR, VM_NEG, VM_NOT, VM_MOV, VM_ADDR,
+	VM_LOAD, VM_STORE, VM_JMP, VM_JZ, VM_CALL, VM_RET,
+	VM_SETRET, VM_GETRET, VM_WRITE_INT, VM_WRITE_STR, VM_READ_INT,
+	VM_READ_STR
+};
+
+static const uint32_t OPD_FRAME = 0;
+static const uint32_t OPD_GLOBAL = 1;
+static const uint32_t OPD_CONST = 2;
+static const uint32_t OPD_INDEX_BITS = 30;
+static const uint32_t OPD_INDEX_MASK = (1u << OPD_INDEX_BITS) - 1;
+
+static uint32_t operand(uint32_t kind, size_t index){
+	if (index > OPD_INDEX_MASK){
+		throw new InternalError("Too many slots for the interpreter");
+	}
+	return (kind << OPD_INDEX_BITS) | static_cast<uint32_t>(index);
+}
+
+//The two slots after the arguments, for values loaded
+// through an AddrOpd or about to be stored through one
+static const uint32_t SCRATCH_SLOTS = 2;
+
+//A frame block of 64 MiB; it is only touched as deep as
+// the program recurses
+static const size_t STACK_SLOTS = size_t(1) << 23;
+
+static const size_t NO_INSTR = static_cast<size_t>(-1);
+//No operand of the VM has this encoding
+static const uint32_t NO_SLOT = UINT32_MAX;
+
+class VMInstr{
+public:
+	const void * handler;
+	uint32_t op;
+	uint32_t a;
+	uint32_t b;
+	uint32_t c;
+};
+
+class VMProc{
+public:
+	std::string name;
+	std::vector<VMInstr> code;
+	std::vector<int64_t> consts;
+	size_t frameSize;
+	//Whether any path sets a return value
+	bool setsRet = false;
+};
+
+class VMProgram{
+public:
+	std::vector<VMProc> procs;
+	std::vector<int64_t> globals;
+	HashMap<Opd *, size_t> globalIndex;
+	HashMap<std::string, size_t> procIndex;
+	//The text of each string literal, with the quotes and
+	// escapes gone, and of each string read; constants and
+	// string variables point into these
+	std::vector<std::unique_ptr<std::string>> strings;
+	HashMap<Opd *, int64_t> stringAddrs;
+
+	int64_t execute(size_t entry);
+};
+
+class VMTranslator{
+public:
+	VMTranslator(VMProgram& progIn, VMProc& outIn)
+	: prog(progIn), vmProc(outIn){ }
+	void translate(Procedure * proc);
+private:
+	void emit(VMOp op, uint32_t a, uint32_t b = 0, uint32_t c = 0){
+		VMInstr instr;
+		instr.handler = nullptr;
+		instr.op = op;
+		instr.a = a;
+		instr.b = b;
+		instr.c = c;
+		vmProc.code.push_back(instr);
+	}
+	uint32_t constant(int64_t val);
+	uint32_t slot(OpdID opd);
+	uint32_t value(OpdID opd, uint32_t scratch);
+	uint32_t target(OpdID dst);
+	void finish(OpdID dst, uint32_t tgt);
+	void translateQuad(const Quad& quad);
+
+	VMProgram& prog;
+	VMProc& vmProc;
+	Procedure * proc = nullptr;
+	//Each operand's frame slot, by its index in the
+	// procedure's operand table
+	std::vector<uint32_t> slots;
+	HashMap<int64_t, uint32_t> constIndex;
+	size_t numArgs = 0;
+	size_t numSlots = 0;
+	//Each label's instruction, by slot
+	std::vector<size_t> labelAt;
+	//Jumps whose target isn't placed yet, with their
+	// target's label slot
+	std::vector<std::pair<size_t, uint32_t>> jumps;
+};
+
+uint32_t VMTranslator::constant(int64_t val){
+	auto found = constIndex.find(val);
+	if (found != constIndex.end()){ return found->second; }
+	uint32_t res = operand(OPD_CONST, vmProc.consts.size());
+	vmProc.consts.push_back(val);
+	constIndex[val] = res;
+	return res;
+}
+
+//Where opd itself is kept (for an AddrOpd, the address it
+// holds)
+uint32_t VMTranslator::slot(OpdID opd){
+	if (slots[opd] != NO_SLOT){ return slots[opd]; }
+	auto global = prog.globalIndex.find(proc->opd(opd));
+	if (global != prog.globalIndex.end()){
+		slots[opd] = operand(OPD_GLOBAL, global->second);
+	} else {
+		slots[opd] = operand(OPD_FRAME, numSlots++);
+	}
+	return slots[opd];
+}
+
+//An operand that reads opd's value, loading it through an
+// AddrOpd into scratch first
+uint32_t VMTranslator::value(OpdID opd, uint32_t scratch){
+	OpdKind kind = proc->kindOf(opd);
+	if (kind == LIT_OPD){
+		return constant(proc->litVal(opd));
+	}
+	if (kind == STRING_OPD){
+		auto str = prog.stringAddrs.find(proc->opd(opd));
+		if (str != prog.stringAddrs.end()){
+			return constant(str->second);
+		}
+	}
+	if (kind == ADDR_OPD){
+		emit(VM_LOAD, scratch, slot(opd));
+		return scratch;
+	}
+	return slot(opd);
+}
+
+//Where an instruction should put dst's new value; finish()
+// then stores it if dst is an AddrOpd
+uint32_t VMTranslator::target(OpdID dst){
+	if (proc->kindOf(dst) == ADDR_OPD){
+		return operand(OPD_FRAME, numArgs);
+	}
+	return slot(dst);
+}
+
+void VMTranslator::finish(OpdID dst, uint32_t tgt){
+	if (proc->kindOf(dst) == ADDR_OPD){
+		emit(VM_STORE, slot(dst), tgt);
+	}
+}
+
+static VMOp binOpCode(BinOp op){
+	switch (op){
+	case ADD64: return VM_ADD;
+	case SUB64: return VM_SUB;
+	case MULT64: return VM_MUL;
+	case DIV64: return VM_DIV;
+	case EQ64: return VM_EQ;
+	case NEQ64: return VM_NE;
+	case LT64: return VM_LT;
+	case GT64: return VM_GT;
+	case LTE64: return VM_LE;
+	case GTE64: return VM_GE;
+	case AND64: return VM_AND;
+	case OR64: return VM_OR;
+	}
+	throw new InternalError("Unknown BinOp");
+}
+
+void VMTranslator::translateQuad(const Quad& quad){
+	uint32_t scratch0 = operand(OPD_FRAME, numArgs);
+	uint32_t scratch1 = operand(OPD_FRAME, numArgs + 1);
+	switch (quad.kind){
+	case BINOP_QUAD: {
+		uint32_t src1 = value(quad.src1, scratch0);
+		uint32_t src2 = value(quad.src2, scratch1);
+		uint32_t tgt = target(quad.dst);
+		emit(binOpCode(quad.binOp()), tgt, src1, src2);
+		finish(quad.dst, tgt);
+		break;
+	}
+	case UNARYOP_QUAD: {
+		uint32_t src = value(quad.src1, scratch0);
+		uint32_t tgt = target(quad.dst);
+		emit(quad.unaryOp() == NEG64 ? VM_NEG : VM_NOT, tgt, src);
+		finish(quad.dst, tgt);
+		break;
+	}
+	case ASSIGN_QUAD: {
+		uint32_t src = value(quad.src1, scratch0);
+		if (proc->kindOf(quad.dst) == ADDR_OPD){
+			emit(VM_STORE, slot(quad.dst), src);
+		} else {
+			emit(VM_MOV, slot(quad.dst), src);
+		}
+		break;
+	}
+	case LOC_QUAD: {
+		uint32_t src;
+		if (quad.srcIsLoc()){
+			src = scratch0;
+			emit(VM_ADDR, src, slot(quad.src1));
+		} else {
+			src = value(quad.src1, scratch0);
+		}
+		if (quad.tgtIsLoc() || proc->kindOf(quad.dst) != ADDR_OPD){
+			emit(VM_MOV, slot(quad.dst), src);
+		} else {
+			emit(VM_STORE, slot(quad.dst), src);
+		}
+		break;
+	}
+	case GOTO_QUAD:
+		jumps.push_back(std::make_pair(vmProc.code.size(), quad.target()));
+		emit(VM_JMP, 0);
+		break;
+	case IFZ_QUAD: {
+		uint32_t cnd = value(quad.src1, scratch0);
+		jumps.push_back(std::make_pair(vmProc.code.size(), quad.target()));
+		emit(VM_JZ, cnd);
+		break;
+	}
+	case NOP_QUAD:
+		break;
+	case REPORT_QUAD: {
+		uint32_t src = value(quad.src1, scratch0);
+		const DataType * type = proc->getType(quad);
+		bool isString = type != nullptr && type->isString();
+		emit(isString ? VM_WRITE_STR : VM_WRITE_INT, src);
+		break;
+	}
+	case RECEIVE_QUAD: {
+		uint32_t tgt = target(quad.dst);
+		const DataType * type = proc->getType(quad);
+		bool isString = type != nullptr && type->isString();
+		emit(isString ? VM_READ_STR : VM_READ_INT, tgt);
+		finish(quad.dst, tgt);
+		break;
+	}
+	case CALL_QUAD: {
+		std::string callee = proc->getCallee(quad)->getName();
+		auto found = prog.procIndex.find(callee);
+		if (found == prog.procIndex.end()){
+			throw new InternalError(("Call to unknown procedure " + callee).c_str());
+		}
+		emit(VM_CALL, static_cast<uint32_t>(found->second));
+		break;
+	}
+	case SETARG_QUAD: {
+		//The frame size isn't known yet; the slot is fixed
+		// up once the whole procedure has been translated
+		uint32_t src = value(quad.src1, scratch0);
+		emit(VM_MOV, static_cast<uint32_t>(quad.argIndex() - 1), src);
+		break;
+	}
+	case GETARG_QUAD: {
+		uint32_t tgt = target(quad.dst);
+		emit(VM_MOV, tgt, operand(OPD_FRAME, quad.argIndex() - 1));
+		finish(quad.dst, tgt);
+		break;
+	}
+	case SETRET_QUAD:
+		emit(VM_SETRET, value(quad.src1, scratch0));
+		vmProc.setsRet = true;
+		break;
+	case GETRET_QUAD: {
+		uint32_t tgt = target(quad.dst);
+		emit(VM_GETRET, tgt);
+		finish(quad.dst, tgt);
+		break;
+	}
+	default:
+		throw new InternalError(("Can't interpret " + proc->repr(quad)).c_str());
+	}
+}
+
+void VMTranslator::translate(Procedure * procIn){
+	proc = procIn;
+	vmProc.name = proc->getName();
+	numArgs = proc->getFormals().size();
+	for (auto& quad : proc->getQuads()){
+		if (quad.kind == GETARG_QUAD){
+			numArgs = std::max(numArgs, quad.argIndex());
+		}
+	}
+	numSlots = numArgs + SCRATCH_SLOTS;
+	slots.assign(proc->numOpds(), NO_SLOT);
+	labelAt.assign(proc->numLabels(), NO_INSTR);
+
+	std::vector<size_t> setArgs;
+	for (auto& quad : proc->getQuads()){
+		for (auto lbl : proc->labelsOf(quad)){
+			labelAt[lbl->getSlot()] = vmProc.code.size();
+		}
+		translateQuad(quad);
+		if (quad.kind == SETARG_QUAD){
+			//The move is last, after any load of the argument
+			setArgs.push_back(vmProc.code.size() - 1);
+		}
+	}
+	labelAt[proc->getLeaveLabel()->getSlot()] = vmProc.code.size();
+	emit(VM_RET, 0);
+
+	vmProc.frameSize = numSlots;
+	for (size_t idx : setArgs){
+		VMInstr& instr = vmProc.code[idx];
+		instr.a = operand(OPD_FRAME, numSlots + instr.a);
+	}
+	for (auto& jump : jumps){
+		uint32_t slot = jump.second;
+		if (slot >= labelAt.size() || labelAt[slot] == NO_INSTR){
+			throw new InternalError(("Jump to unplaced label "
+				+ proc->getLabel(slot)->getName()).c_str());
+		}
+		vmProc.code[jump.first].b = static_cast<uint32_t>(labelAt[slot]);
+	}
+}
+
+//Turn the text of a string literal, quotes and escapes
+// and all, into the characters it stands for
+static std::string unquote(const std::string& lit){
+	std::string res;
+	size_t end = lit.size() > 0 && lit.back() == '"' ? lit.size() - 1 : lit.size();
+	size_t start = lit.size() > 0 && lit.front() == '"' ? 1 : 0;
+	for (size_t i = start; i < end; i++){
+		if (lit[i] != '\\' || i + 1 >= end){
+			res += lit[i];
+			continue;
+		}
+		char esc = lit[++i];
+		switch (esc){
+		case 'n': res += '\n'; break;
+		case 't': res += '\t'; break;
+		case '0': res += '\0'; break;
+		default: res += esc; break;
+		}
+	}
+	return res;
+}
+
+static void writeInt(int64_t val){
+	char buf[24];
+	char * end = buf + sizeof(buf);
+	char * pos = end;
+	uint64_t mag = val < 0 ? 0 - static_cast<uint64_t>(val)
+		: static_cast<uint64_t>(val);
+	do {
+		*--pos = static_cast<char>('0' + mag % 10);
+		mag /= 10;
+	} while (mag != 0);
+	if (val < 0){ *--pos = '-'; }
+	fwrite(pos, 1, static_cast<size_t>(end - pos), stdout);
+}
+
+#if defined(CMM_THREADED_DISPATCH)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+int64_t VMProgram::execute(size_t entry){
+	class CallRecord{
+	public:
+		const VMInstr * ret;
+		int64_t * frame;
+		VMProc * proc;
+	};
+	std::unique_ptr<int64_t[]> stack(new int64_t[STACK_SLOTS]);
+	int64_t * const stackEnd = stack.get() + STACK_SLOTS;
+	std::vector<CallRecord> calls;
+	int64_t retVal = 0;
+
+	VMProc * proc = &procs[entry];
+	int64_t * frame = stack.get();
+	if (proc->frameSize > STACK_SLOTS){
+		throw new UserError("Stack overflow");
+	}
+	int64_t * bases[3];
+	bases[OPD_FRAME] = frame;
+	bases[OPD_GLOBAL] = globals.data();
+	bases[OPD_CONST] = proc->consts.data();
+	const VMInstr * code = proc->code.data();
+	const VMInstr * pc = code;
+
+#define OPD(x) bases[(x) >> OPD_INDEX_BITS][(x) & OPD_INDEX_MASK]
+#define ARITH(expr) \
+	{ uint64_t l = static_cast<uint64_t>(OPD(pc->b)); \
+	  uint64_t r = static_cast<uint64_t>(OPD(pc->c)); \
+	  OPD(pc->a) = static_cast<int64_t>(expr); } \
+	pc++; NEXT;
+#define COMPARE(op) \
+	OPD(pc->a) = OPD(pc->b) op OPD(pc->c); pc++; NEXT;
+
+#if defined(CMM_THREADED_DISPATCH)
+#define CASE(op) L_##op:
+#define NEXT goto *pc->handler
+	static const void * const handlers[] = {
+		&&L_VM_ADD, &&L_VM_SUB, &&L_VM_MUL, &&L_VM_DIV, &&L_VM_EQ,
+		&&L_VM_NE, &&L_VM_LT, &&L_VM_GT, &&L_VM_LE, &&L_VM_GE,
+		&&L_VM_AND, &&L_VM_OR, &&L_VM_NEG, &&L_VM_NOT, &&L_VM_MOV,
+		&&L_VM_ADDR, &&L_VM_LOAD, &&L_VM_STORE, &&L_VM_JMP, &&L_VM_JZ,
+		&&L_VM_CALL, &&L_VM_RET, &&L_VM_SETRET, &&L_VM_GETRET,
+		&&L_VM_WRITE_INT, &&L_VM_WRITE_STR, &&L_VM_READ_INT,
+		&&L_VM_READ_STR
+	};
+	for (auto& each : procs){
+		for (auto& instr : each.code){ instr.handler = handlers[instr.op]; }
+	}
+	NEXT;
+#else
+#define CASE(op) case op:
+#define NEXT continue
+	for (;;){
+	switch (pc->op){
+#endif
+
+	CASE(VM_ADD) ARITH(l + r)
+	CASE(VM_SUB) ARITH(l - r)
+	CASE(VM_MUL) ARITH(l * r)
+	CASE(VM_DIV) {
+		int64_t l = OPD(pc->b);
+		int64_t r = OPD(pc->c);
+		if (r == 0){ throw new UserError("Division by zero"); }
+		if (r == -1 && l == INT64_MIN){
+			throw new UserError("Division overflow");
+		}
+		OPD(pc->a) = l / r;
+		pc++;
+		NEXT;
+	}
+	CASE(VM_EQ) COMPARE(==)
+	CASE(VM_NE) COMPARE(!=)
+	CASE(VM_LT) COMPARE(<)
+	CASE(VM_GT) COMPARE(>)
+	CASE(VM_LE) COMPARE(<=)
+	CASE(VM_GE) COMPARE(>=)
+	CASE(VM_AND) COMPARE(&)
+	CASE(VM_OR) COMPARE(|)
+	CASE(VM_NEG)
+		OPD(pc->a) = static_cast<int64_t>(0 - static_cast<uint64_t>(OPD(pc->b)));
+		pc++;
+		NEXT;
+	CASE(VM_NOT)
+		OPD(pc->a) = OPD(pc->b) == 0;
+		pc++;
+		NEXT;
+	CASE(VM_MOV)
+		OPD(pc->a) = OPD(pc->b);
+		pc++;
+		NEXT;
+	CASE(VM_ADDR)
+		OPD(pc->a) = reinterpret_cast<intptr_t>(&OPD(pc->b));
+		pc++;
+		NEXT;
+	CASE(VM_LOAD)
+		OPD(pc->a) = *reinterpret_cast<int64_t *>(OPD(pc->b));
+		pc++;
+		NEXT;
+	CASE(VM_STORE)
+		*reinterpret_cast<int64_t *>(OPD(pc->a)) = OPD(pc->b);
+		pc++;
+		NEXT;
+	CASE(VM_JMP)
+		pc = code + pc->b;
+		NEXT;
+	CASE(VM_JZ)
+		pc = OPD(pc->a) == 0 ? code + pc->b : pc + 1;
+		NEXT;
+	CASE(VM_CALL) {
+		CallRecord record;
+		record.ret = pc + 1;
+		record.frame = frame;
+		record.proc = proc;
+		calls.push_back(record);
+		frame += proc->frameSize;
+		proc = &procs[pc->a];
+		if (proc->frameSize > static_cast<size_t>(stackEnd - frame)){
+			throw new UserError("Stack overflow");
+		}
+		bases[OPD_FRAME] = frame;
+		bases[OPD_CONST] = proc->consts.data();
+		code = proc->code.data();
+		pc = code;
+		NEXT;
+	}
+	CASE(VM_RET) {
+		if (calls.empty()){ goto done; }
+		CallRecord& record = calls.back();
+		pc = record.ret;
+		frame = record.frame;
+		proc = record.proc;
+		calls.pop_back();
+		bases[OPD_FRAME] = frame;
+		bases[OPD_CONST] = proc->consts.data();
+		code = proc->code.data();
+		NEXT;
+	}
+	CASE(VM_SETRET)
+		retVal = OPD(pc->a);
+		pc++;
+		NEXT;
+	CASE(VM_GETRET)
+		OPD(pc->a) = retVal;
+		pc++;
+		NEXT;
+	CASE(VM_WRITE_INT)
+		writeInt(OPD(pc->a));
+		pc++;
+		NEXT;
+	CASE(VM_WRITE_STR)
+		fputs(reinterpret_cast<const char *>(OPD(pc->a)), stdout);
+		pc++;
+		NEXT;
+	CASE(VM_READ_INT) {
+		//Show any prompt before waiting for input
+		fflush(stdout);
+		int64_t val = 0;
+		if (scanf("%" SCNd64, &val) != 1){ val = 0; }
+		OPD(pc->a) = val;
+		pc++;
+		NEXT;
+	}
+	CASE(VM_READ_STR) {
+		//One word, as the executable from -o reads it
+		fflush(stdout);
+		int c = getchar();
+		while (c == ' ' || (c >= '\t' && c <= '\r')){ c = getchar(); }
+		std::string * word = new std::string();
+		while (c != EOF && c != ' ' && !(c >= '\t' && c <= '\r')){
+			*word += static_cast<char>(c);
+			c = getchar();
+		}
+		if (c != EOF){ ungetc(c, stdin); }
+		strings.emplace_back(word);
+		OPD(pc->a) = reinterpret_cast<intptr_t>(word->c_str());
+		pc++;
+		NEXT;
+	}
+
+#if !defined(CMM_THREADED_DISPATCH)
+	}
+	}
+#endif
+done:
+	fflush(stdout);
+	return retVal;
+
+#undef OPD
+#undef ARITH
+#undef COMPARE
+#undef CASE
+#undef NEXT
+}
+
+#if defined(CMM_THREADED_DISPATCH)
+#pragma GCC diagnostic pop
+#endif
+
+int64_t IRProgram::run(){
+	VMProgram vm;
+	for (auto global : globalsInOrder){
+		vm.globalIndex[global] = vm.globals.size();
+		vm.globals.push_back(0);
+	}
+	for (auto& entry : strings){
+		vm.strings.emplace_back(new std::string(unquote(entry.second)));
+		vm.stringAddrs[entry.first] = reinterpret_cast<intptr_t>(
+			vm.strings.back()->c_str());
+	}
+	for (auto proc : *procs){
+		vm.procIndex[proc->getName()] = vm.procs.size();
+		vm.procs.emplace_back();
+	}
+	size_t idx = 0;
+	for (auto proc : *procs){
+		VMTranslator translator(vm, vm.procs[idx++]);
+		translator.translate(proc);
+	}
+
+	auto main = vm.procIndex.find("main");
+	if (main == vm.procIndex.end()){
+		throw new UserError("No main procedure to run");
+	}
+	static char outBuf[1 << 16];
+	setvbuf(stdout, outBuf, _IOFBF, sizeof(outBuf));
+	int64_t res = vm.execute(main->second);
+	//Like the executable from -o, a main that never sets a
+	// return value exits with 0
+	return vm.procs[main->second].setsRet ? res : 0;
+}
+
+}
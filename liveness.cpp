@@ -0,0 +1,81 @@
+#include "liveness.hpp"
+
+namespace cminusminus{
+
+const size_t Liveness::NONE;
+
+static bool isStore(Procedure * proc, Quad& quad){
+	OpdID * slot = quad.defSlot();
+	return slot != nullptr && proc->kindOf(*slot) == ADDR_OPD
+		&& quad.kind != LOC_QUAD;
+}
+
+void Liveness::uses(Procedure * proc, Quad& quad, std::vector<OpdID>& res){
+	res.clear();
+	for (OpdID * slot : proc->useSlots(quad)){
+		res.push_back(*slot);
+	}
+	if (isStore(proc, quad)){ res.push_back(*quad.defSlot()); }
+}
+
+OpdID Liveness::def(Procedure * proc, Quad& quad){
+	OpdID * slot = quad.defSlot();
+	if (slot == nullptr || isStore(proc, quad)){ return NO_OPD; }
+	return *slot;
+}
+
+//The usual backward dataflow problem: a block's live-in is
+// what it reads before writing, plus whatever is live out
+// of it and it doesn't write. Visiting blocks in post-order
+// means most of a block's successors are done before it.
+Liveness::Liveness(CFG * cfg, const std::vector<OpdID>& tracked)
+: opds(tracked){
+	Procedure * proc = cfg->getProc();
+	indices.assign(proc->numOpds(), NONE);
+	for (size_t i = 0; i < opds.size(); i++){
+		indices[opds[i]] = i;
+	}
+	size_t numBlocks = cfg->blocks().size();
+	std::vector<BitSet> gen(numBlocks, BitSet(opds.size()));
+	std::vector<BitSet> kill(numBlocks, BitSet(opds.size()));
+	ins.assign(numBlocks, BitSet(opds.size()));
+	outs.assign(numBlocks, BitSet(opds.size()));
+
+	std::vector<Quad>& quads = proc->getQuads();
+	std::vector<OpdID> read;
+	for (auto block : cfg->blocks()){
+		BitSet& g = gen[block->getID()];
+		BitSet& k = kill[block->getID()];
+		for (size_t i = block->begin(); i != block->end(); ++i){
+			uses(proc, quads[i], read);
+			for (OpdID opd : read){
+				size_t idx = indexOf(opd);
+				if (idx != NONE && !k.has(idx)){ g.add(idx); }
+			}
+			size_t idx = indexOf(def(proc, quads[i]));
+			if (idx != NONE){ k.add(idx); }
+		}
+	}
+
+	const std::vector<BasicBlock *>& rpo = cfg->rpo();
+	bool changed = true;
+	while (changed){
+		changed = false;
+		for (auto itr = rpo.rbegin(); itr != rpo.rend(); ++itr){
+			BasicBlock * block = *itr;
+			size_t id = block->getID();
+			BitSet& out = outs[id];
+			for (auto succ : block->succs()){
+				out.unite(ins[succ->getID()]);
+			}
+			//in = gen | (out - kill)
+			BitSet in = gen[id];
+			out.each([&](size_t i){
+				if (!kill[id].has(i)){ in.add(i); }
+			});
+			if (ins[id].unite(in)){ changed = true; }
+		}
+	}
+}
+
+}
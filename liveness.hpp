@@ -0,0 +1,80 @@
+#ifndef CMINUSMINUS_LIVENESS_HPP
+#define CMINUSMINUS_LIVENESS_HPP
+
+#include <cstdint>
+#include <vector>
+#include "cfg.hpp"
+
+namespace cminusminus{
+
+//A fixed-size set of small integers
+class BitSet{
+public:
+	BitSet(size_t size = 0) : words((size + 63) / 64, 0){ }
+	bool has(size_t i) const {
+		return (words[i / 64] >> (i % 64)) & 1;
+	}
+	void add(size_t i){ words[i / 64] |= uint64_t(1) << (i % 64); }
+	void remove(size_t i){ words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+	//Add everything in other, and say whether that changed
+	// anything
+	bool unite(const BitSet& other){
+		bool changed = false;
+		for (size_t i = 0; i < words.size(); i++){
+			uint64_t merged = words[i] | other.words[i];
+			changed = changed || merged != words[i];
+			words[i] = merged;
+		}
+		return changed;
+	}
+	//Call fn on each member, in increasing order
+	template <typename Fn>
+	void each(Fn fn) const {
+		for (size_t w = 0; w < words.size(); w++){
+			for (uint64_t bits = words[w]; bits != 0; bits &= bits - 1){
+				fn(w * 64 + static_cast<size_t>(__builtin_ctzll(bits)));
+			}
+		}
+	}
+private:
+	std::vector<uint64_t> words;
+};
+
+//Which of a chosen set of operands (usually the temps) hold
+// a value that may still be read, at the start and end of
+// each block of a CFG. Any other operand is ignored.
+class Liveness{
+public:
+	Liveness(CFG * cfg, const std::vector<OpdID>& tracked);
+
+	static const size_t NONE = static_cast<size_t>(-1);
+	//The dense index of a tracked operand, or NONE
+	size_t indexOf(OpdID opd) const {
+		return opd < indices.size() ? indices[opd] : NONE;
+	}
+	OpdID operand(size_t idx) const { return opds[idx]; }
+	size_t size() const { return opds.size(); }
+
+	const BitSet& liveIn(BasicBlock * block) const {
+		return ins[block->getID()];
+	}
+	const BitSet& liveOut(BasicBlock * block) const {
+		return outs[block->getID()];
+	}
+
+	//The operands quad reads, and the one it writes (or
+	// NO_OPD). A store through an AddrOpd reads the address
+	// it holds rather than writing it.
+	static void uses(Procedure * proc, Quad& quad, std::vector<OpdID>& res);
+	static OpdID def(Procedure * proc, Quad& quad);
+private:
+	std::vector<OpdID> opds;
+	//The index of each operand in the procedure's table
+	std::vector<size_t> indices;
+	std::vector<BitSet> ins;
+	std::vector<BitSet> outs;
+};
+
+}
+
+#endif
@@ -1,42 +1,67 @@
+#include <chrono>
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
 #include <string.h>
+#include <unistd.h>
 #include "errors.hpp"
 #include "scanner.hpp"
 #include "name_analysis.hpp"
 #include "type_analysis.hpp"
+#include "pipeline.hpp"
+#include "pool.hpp"
 
 using namespace cminusminus;
 
 static void usageAndDie(){
 	std::cerr << "Usage: cmmc <infile>\n"
+	<< "       cmmc --batch [-j<threads>] <infile|@manifest>...\n"
 	<< " [-t <tokensFile>]: Output tokens to <tokensFile>\n"
 	<< " [-p]: Parse the input to check syntax\n"
 	<< " [-u <unparseFile>]: Output canonical program form\n"
 	<< " [-n <nameFile>]: Output program with IDs annotated with symbols\n"
 	<< " [-c]: Perform type analysis / typecheck the program\n"
 	<< " [-a <3ACFile>]: Output program as 3-address code\n"
+	<< " [-b <3ACBinFile>]: Output program as binary 3-address code\n"
+	<< " [-o <asmFile>]: Output program as x86-64 assembly\n"
+	<< " [--run]: Run the program on the bytecode interpreter\n"
+	<< " [--cfg <cfgFile>]: Output each function's control-flow\n"
+	<< "       graph, with dominators, dominance frontiers and\n"
+	<< "       loops, after any optimization\n"
+	<< " [-O<level>]: Optimize the 3AC (0: none, the default,\n"
+	<< "       1: fold and propagate constants, clean up jumps,\n"
+	<< "       2: also put locals in SSA form and share temp\n"
+	<< "       slots)\n"
+	<< " [-i]: The input is a binary 3AC file (from -b), only\n"
+	<< "       -a, -b, -o, --cfg and --run can be used with it\n"
+	<< " [--batch]: Compile every input, several at once. Each\n"
+	<< "       output file name needs a %, which stands for the\n"
+	<< "       input's path without its extension. @<manifest>\n"
+	<< "       names a file listing inputs, one per line.\n"
+	<< "       Messages are printed per input, in input order\n"
+	<< " [-j<threads>]: Threads to compile with, for the\n"
+	<< "       function bodies in a file and, with --batch,\n"
+	<< "       the files themselves (default: one per core)\n"
+	<< " [--fast-scan]: Scan with the hand-written scanner\n"
+	<< "       rather than flex's (the tokens are the same)\n"
+	<< " [--scan-bench]: Time both scanners on the input and\n"
+	<< "       print the tokens per second each manages\n"
 	;
 	exit(1);
 }
 
-static void writeTokenStream(const char * inPath, const char * outPath){
-	std::ifstream inStream(inPath);
-	if (!inStream.good()){
-		std::string msg = "Bad input stream";
-		msg += inPath;
-		throw new InternalError(msg.c_str());
-	}
+static void writeTokenStream(Pipeline& pipeline, const char * outPath){
 	if (outPath == nullptr){
 		std::string msg = "No tokens output file given";
 		throw new InternalError(msg.c_str());
 	}
 
-	Scanner scanner(&inStream);
 	if (strcmp(outPath, "--") == 0){
-		scanner.outputTokens(std::cout);
+		pipeline.writeTokens(std::cout);
 	} else {
 		std::ofstream outStream(outPath);
 		if (!outStream.good()){
@@ -44,32 +69,11 @@ static void writeTokenStream(const char * inPath, const char * outPath){
 			msg += outPath;
 			throw new InternalError(msg.c_str());
 		}
-		scanner.outputTokens(outStream);
+		pipeline.writeTokens(outStream);
 		outStream.close();
 	}
 }
 
-static cminusminus::ProgramNode * parse(const char * inFile){
-	std::ifstream inStream(inFile);
-	if (!inStream.good()){
-		std::string msg = "Bad input stream ";
-		msg += inFile;
-		throw new UserError(msg.c_str());
-	}
-
-	//This pointer will be set to the root of the
-	// AST after parsing
-	cminusminus::ProgramNode * root = nullptr;
-
-	cminusminus::Scanner scanner(&inStream);
-	cminusminus::Parser parser(scanner, &root);
-
-	int errCode = parser.parse();
-	if (errCode != 0){ return nullptr; }
-
-	return root;
-}
-
 static void outputAST(ASTNode * ast, const char * outPath){
 	if (strcmp(outPath, "--") == 0){
 		ast->unparse(std::cout, 0);
@@ -84,172 +88,452 @@ static void outputAST(ASTNode * ast, const char * outPath){
 	}
 }
 
-static cminusminus::NameAnalysis * doNameAnalysis(const char * inputPath){
-	cminusminus::ProgramNode * ast = parse(inputPath);
-	if (ast == nullptr){ return nullptr; }
-	
-	return cminusminus::NameAnalysis::build(ast);
+static void write3AC(cminusminus::IRProgram * prog, const char * outPath){
+	if (outPath == nullptr){
+		throw new InternalError("Null 3AC flat file given");
+	}
+	if (strcmp(outPath, "--") == 0){
+		prog->write(std::cout);
+		std::cout << std::endl;
+	} else {
+		std::ofstream outStream(outPath);
+		if (!outStream.good()){
+			std::string msg = "Bad output file ";
+			msg += outPath;
+			throw new InternalError(msg.c_str());
+		}
+		prog->write(outStream);
+		outStream << std::endl;
+		outStream.close();
+	}
 }
 
-static bool doUnparsing(const char * inputPath, const char * outPath){
-	cminusminus::ProgramNode * ast = parse(inputPath);
-	if (ast == nullptr){ 
-		std::cerr << "No AST built\n";
-		return false;
+static void write3ACBinary(cminusminus::IRProgram * prog, const char * outPath){
+	if (outPath == nullptr){
+		throw new InternalError("Null 3AC binary file given");
 	}
-
-	outputAST(ast, outPath);
-	return true;
+	std::ofstream outStream(outPath, std::ios::binary);
+	if (!outStream.good()){
+		std::string msg = "Bad output file ";
+		msg += outPath;
+		throw new InternalError(msg.c_str());
+	}
+	prog->writeBinary(outStream);
+	outStream.close();
 }
 
-static cminusminus::TypeAnalysis * doTypeAnalysis(const char * inputPath){
-	cminusminus::NameAnalysis * nameAnalysis = doNameAnalysis(inputPath);
-	if (nameAnalysis == nullptr){ return nullptr; }
-	return TypeAnalysis::build(nameAnalysis);
+static void writeCFGs(cminusminus::IRProgram * prog, const char * outPath){
+	if (strcmp(outPath, "--") == 0){
+		prog->writeCFGs(std::cout);
+	} else {
+		std::ofstream outStream(outPath);
+		if (!outStream.good()){
+			std::string msg = "Bad output file ";
+			msg += outPath;
+			throw new InternalError(msg.c_str());
+		}
+		prog->writeCFGs(outStream);
+		outStream.close();
+	}
 }
 
-static void write3AC(cminusminus::IRProgram * prog, const char * outPath){
+static void writeX64(cminusminus::IRProgram * prog, const char * outPath){
 	if (outPath == nullptr){
-		throw new InternalError("Null 3AC flat file given");
+		throw new InternalError("Null assembly file given");
 	}
-	std::string flatProg = prog->toString();
 	if (strcmp(outPath, "--") == 0){
-		std::cout << flatProg << std::endl;
+		prog->toX64(std::cout);
 	} else {
 		std::ofstream outStream(outPath);
-		outStream << flatProg << std::endl;
+		if (!outStream.good()){
+			std::string msg = "Bad output file ";
+			msg += outPath;
+			throw new InternalError(msg.c_str());
+		}
+		prog->toX64(outStream);
 		outStream.close();
 	}
 }
 
+//What cmmc was asked to do with each input. An empty path
+// means that output wasn't asked for.
+class Options{
+public:
+	std::string tokensFile;
+	bool checkParse = false;
+	std::string unparseFile;
+	std::string namesFile;
+	bool checkTypes = false;
+	std::string threeACFile;
+	std::string threeACBinFile;
+	std::string asmFile;
+	std::string cfgFile;
+	bool inputIsIR = false;
+	bool runProg = false;
+	unsigned int optLevel = 0;
+	Lexer::Kind scanner = Lexer::Kind::FLEX;
+
+	//The output paths, each with % replaced by stem
+	Options forStem(const std::string& stem) const {
+		Options res = *this;
+		for (std::string * path : {&res.tokensFile, &res.unparseFile,
+			&res.namesFile, &res.threeACFile, &res.threeACBinFile,
+			&res.asmFile, &res.cfgFile}){
+			std::string expanded;
+			for (char c : *path){
+				if (c == '%'){ expanded += stem; }
+				else { expanded += c; }
+			}
+			*path = expanded;
+		}
+		return res;
+	}
+	//Whether every output path has a % in it
+	bool pathsPerInput() const {
+		for (const std::string * path : {&tokensFile, &unparseFile,
+			&namesFile, &threeACFile, &threeACBinFile, &asmFile,
+			&cfgFile}){
+			if (!path->empty() && path->find('%') == std::string::npos){
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+//Everything asked for on one input file, with the function
+// bodies spread over pool. Messages for the user go through
+// Report, so a batch can collect them per file. Returns the
+// exit status.
+static int compile(const Options& opts, const char * inFile, WorkPool * pool){
+	try {
+		//Every stage below shares a single parse of inFile
+		cminusminus::Pipeline pipeline(inFile, opts.inputIsIR);
+		pipeline.setOptLevel(opts.optLevel);
+		pipeline.setPool(pool);
+		pipeline.setScanner(opts.scanner);
+		if (!opts.tokensFile.empty()){
+			writeTokenStream(pipeline, opts.tokensFile.c_str());
+		}
+		if (opts.checkParse){
+			if (!pipeline.parse()){
+				Report::err() << "Parse failed" << std::endl;
+			}
+		}
+		if (!opts.unparseFile.empty()){
+			ProgramNode * ast = pipeline.parse();
+			if (ast == nullptr){ 
+				Report::err() << "No AST built\n";
+			} else {
+				outputAST(ast, opts.unparseFile.c_str());
+			}
+		}
+		if (!opts.namesFile.empty()){
+			cminusminus::NameAnalysis * na;
+			na = pipeline.nameAnalysis();
+			if (na == nullptr){
+				Report::err() << "Name Analysis Failed\n";
+				return 1;
+			}
+			outputAST(na->ast, opts.namesFile.c_str());
+		}
+		if (opts.checkTypes){
+			cminusminus::TypeAnalysis * ta;
+			ta = pipeline.typeAnalysis();
+			if (ta == nullptr){
+				Report::err() << "Type Analysis Failed\n";
+				return 1;
+			} else {
+				Report::out() << "Great job! Type analysis succeeded\n";
+			}
+		}
+		if (!opts.threeACFile.empty()){
+			auto prog = pipeline.to3AC(); //what is prog -> does typeAnalysis and recursive walk to conv to 3AC
+									   //calls to3AC
+			if (prog == nullptr){ return 1; }
+			write3AC(prog, opts.threeACFile.c_str()); //writes 3AC to output file
+		}
+		if (!opts.threeACBinFile.empty()){
+			auto prog = pipeline.to3AC();
+			if (prog == nullptr){ return 1; }
+			write3ACBinary(prog, opts.threeACBinFile.c_str());
+		}
+		if (!opts.asmFile.empty()){
+			auto prog = pipeline.to3AC();
+			if (prog == nullptr){ return 1; }
+			writeX64(prog, opts.asmFile.c_str());
+		}
+		if (!opts.cfgFile.empty()){
+			auto prog = pipeline.to3AC();
+			if (prog == nullptr){ return 1; }
+			writeCFGs(prog, opts.cfgFile.c_str());
+		}
+		if (opts.runProg){
+			auto prog = pipeline.to3AC();
+			if (prog == nullptr){ return 1; }
+			//The exit status is what main returned, as for an
+			// executable built from -o
+			return static_cast<int>(prog->run() & 0xff);
+		}
+	} catch (cminusminus::ToDoError * e){
+		Report::err() << "ToDoError: " << e->msg() << "\n";
+		return 1;
+	} catch (cminusminus::InternalError * e){
+		std::string msg = "Something in the compiler is broken: ";
+		Report::err() << msg << e->msg() << std::endl;
+		return 1;
+	} catch (UserError * e){
+		std::string msg = "The user made a mistake: ";
+		Report::err() << msg << e->msg() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+//The path an input's outputs are named after: the input
+// without its extension
+static std::string stemOf(const std::string& path){
+	size_t dot = path.rfind('.');
+	size_t slash = path.rfind('/');
+	if (dot == std::string::npos 
+		|| (slash != std::string::npos && dot < slash)){
+		return path;
+	}
+	return path.substr(0, dot);
+}
+
+//Add the inputs listed in a manifest, one per line (blank
+// lines and lines starting with # are skipped)
+static void readManifest(const char * path, std::vector<std::string>& inputs){
+	std::ifstream manifest(path);
+	if (!manifest.good()){
+		std::cerr << "Bad manifest " << path << std::endl;
+		usageAndDie();
+	}
+	std::string line;
+	while (std::getline(manifest, line)){
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == std::string::npos || line[start] == '#'){ continue; }
+		size_t end = line.find_last_not_of(" \t\r");
+		inputs.push_back(line.substr(start, end - start + 1));
+	}
+}
+
+//Compile every input on a pool of threads. Each file's
+// messages are held back and printed after the others',
+// in the order the inputs were given.
+static int compileBatch(const Options& opts, 
+	const std::vector<std::string>& inputs, size_t numThreads){
+	std::vector<std::string> logs(inputs.size());
+	std::vector<int> status(inputs.size(), 0);
+	WorkPool pool(numThreads);
+	pool.forEach(inputs.size(), [&](size_t i){
+		std::ostringstream log;
+		Report::Redirect redirect(&log);
+		const char * inFile = inputs[i].c_str();
+		if (access(inFile, R_OK) != 0){
+			log << "Bad path " << inFile << std::endl;
+			status[i] = 1;
+		} else {
+			status[i] = compile(opts.forStem(stemOf(inputs[i])), inFile, &pool);
+		}
+		logs[i] = log.str();
+	});
+
+	int res = 0;
+	for (size_t i = 0; i < inputs.size(); i++){
+		if (!logs[i].empty()){
+			std::cerr << "== " << inputs[i] << " ==\n" << logs[i];
+		}
+		if (status[i] != 0){ res = 1; }
+	}
+	return res;
+}
 
-static IRProgram * do3AC(const char * inputPath){
-	cminusminus::TypeAnalysis * typeAnalysis = doTypeAnalysis(inputPath);
-	if (typeAnalysis == nullptr){ return nullptr; }
-	
-	IRProgram * prog = typeAnalysis->ast->to3AC(typeAnalysis);
-	return prog;
+//Scan inFile over and over with each kind of scanner, for
+// a second or so each, and print how many tokens a second
+// each gets through. Messages from the scanners are 
+// dropped.
+static int benchScanners(const char * inFile){
+	using Clock = std::chrono::steady_clock;
+	try {
+		SourceFile src(inFile);
+		const Lexer::Kind kinds[] = {Lexer::Kind::FLEX, Lexer::Kind::FAST};
+		const char * names[] = {"flex", "fast"};
+		double rates[2];
+		for (size_t k = 0; k < 2; k++){
+			//The first pass is not timed: it interns the
+			// file's names, which the later passes only look up
+			size_t tokens = 0;
+			size_t passes = 0;
+			double secs = 0;
+			Clock::time_point start;
+			while (passes <= 3 || secs < 1.0){
+				if (passes == 1){ start = Clock::now(); }
+				std::ostringstream dropped;
+				Report::Redirect quiet(&dropped);
+				std::unique_ptr<Lexer> scanner = Lexer::make(kinds[k], src);
+				Token tok;
+				size_t count = 0;
+				while (scanner->yylex(&tok) != TokenKind::END){ count++; }
+				if (passes > 0){
+					tokens += count;
+					secs = std::chrono::duration<double>(
+						Clock::now() - start).count();
+				}
+				passes++;
+			}
+			rates[k] = static_cast<double>(tokens) / secs;
+			Report::out() << names[k] << ": " 
+				<< tokens / (passes - 1) << " tokens, "
+				<< passes - 1 << " passes in " << secs << "s, "
+				<< static_cast<uint64_t>(rates[k]) << " tokens/s\n";
+		}
+		Report::out() << "fast/flex: " << rates[1] / rates[0] << "x\n";
+	} catch (UserError * e){
+		Report::err() << "The user made a mistake: " 
+			<< e->msg() << std::endl;
+		return 1;
+	}
+	return 0;
 }
 
 int 
 main( const int argc, const char **argv )
 {
 	if (argc <= 1){ usageAndDie(); }
-	std::ifstream * input = new std::ifstream(argv[1]);
-	if (input == nullptr){ usageAndDie(); }
-	if (!input->good()){
-		std::cerr << "Bad path " << argv[1] << std::endl;
-		usageAndDie();
-	}
 
-	const char * inFile = NULL;
-	const char * tokensFile = NULL;
-	bool checkParse = false;
-	const char * unparseFile = NULL;
-	const char * namesFile = NULL;
-	bool checkTypes = false;
-	const char * threeACFile = NULL;
+	std::vector<std::string> inputs;
+	Options opts;
+	bool batch = false;
+	bool scanBench = false;
+	size_t numThreads = WorkPool::defaultThreads();
 
 	bool useful = false;
-	int i = 1;
 	for (int i = 1 ; i < argc ; i++){
 		if (argv[i][0] == '-'){
-			if (argv[i][1] == 't'){
+			if (strcmp(argv[i], "--run") == 0){
+				opts.runProg = true;
+				useful = true;
+			} else if (strcmp(argv[i], "--batch") == 0){
+				batch = true;
+			} else if (strcmp(argv[i], "--cfg") == 0){
 				i++;
-				tokensFile = argv[i];
+				if (i >= argc){ usageAndDie(); }
+				opts.cfgFile = argv[i];
+				useful = true;
+			} else if (strcmp(argv[i], "--fast-scan") == 0){
+				opts.scanner = Lexer::Kind::FAST;
+			} else if (strcmp(argv[i], "--scan-bench") == 0){
+				scanBench = true;
+				useful = true;
+			} else if (argv[i][1] == 't'){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				opts.tokensFile = argv[i];
 				useful = true;
 			} else if (argv[i][1] == 'p'){
-				checkParse = true;
+				opts.checkParse = true;
 				useful = true;
 			} else if (argv[i][1] == 'u'){
 				i++;
 				if (i >= argc){ usageAndDie(); }
-				unparseFile = argv[i];
+				opts.unparseFile = argv[i];
 				useful = true;
 			} else if (argv[i][1] == 'n'){
 				i++;
 				if (i >= argc){ usageAndDie(); }
-				namesFile = argv[i];
+				opts.namesFile = argv[i];
 				useful = true;
 			} else if (argv[i][1] == 'c'){
-				checkTypes = true;
+				opts.checkTypes = true;
 				useful = true;
 			} else if (argv[i][1] == 'a'){ //3ac
 				i++;
 				if (i >= argc){ usageAndDie(); }
-				threeACFile = argv[i];
+				opts.threeACFile = argv[i];
 				useful = true;
+			} else if (argv[i][1] == 'b'){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				opts.threeACBinFile = argv[i];
+				useful = true;
+			} else if (argv[i][1] == 'o'){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				opts.asmFile = argv[i];
+				useful = true;
+			} else if (argv[i][1] == 'i'){
+				opts.inputIsIR = true;
+			} else if (argv[i][1] == 'O' || argv[i][1] == 'j'){
+				char * end;
+				long val = strtol(argv[i] + 2, &end, 10);
+				if (*end != '\0' || end == argv[i] + 2 || val < 0){
+					usageAndDie();
+				}
+				if (argv[i][1] == 'O'){
+					opts.optLevel = static_cast<unsigned int>(val);
+				} else if (val == 0){
+					usageAndDie();
+				} else {
+					numThreads = static_cast<size_t>(val);
+				}
 			} else {
 				std::cerr << "Unrecognized argument: ";
 				std::cerr << argv[i] << std::endl;
 				usageAndDie();
 			}
+		} else if (argv[i][0] == '@'){
+			readManifest(argv[i] + 1, inputs);
 		} else {
-			if (inFile == NULL){
-				inFile = argv[i];
-			} else {
-				std::cerr << "Only 1 input file allowed";
-				std::cerr << argv[i] << std::endl;
-				usageAndDie();
-			}
+			inputs.push_back(argv[i]);
 		}
 	}
-	if (inFile == NULL){
+	if (inputs.empty()){
 		usageAndDie();
 	}
 	if (!useful){
 		std::cerr << "Hey, you didn't tell cmmc to do anything!\n";
 		usageAndDie();
 	}
+	if (opts.inputIsIR && (!opts.tokensFile.empty() || opts.checkParse
+		|| !opts.unparseFile.empty() || !opts.namesFile.empty()
+		|| opts.checkTypes)){
+		std::cerr << "Only -a, -b, -o, --cfg and --run can be used"
+			<< " with -i\n";
+		usageAndDie();
+	}
 
-	try {
-		if (tokensFile != nullptr){
-			writeTokenStream(inFile, tokensFile);
-		}
-		if (checkParse){
-			if (!parse(inFile)){
-				std::cerr << "Parse failed" << std::endl;
-			}
-		}
-		if (unparseFile != nullptr){
-			doUnparsing(inFile, unparseFile);
-		}
-		if (namesFile){
-			cminusminus::NameAnalysis * na;
-			na = doNameAnalysis(inFile);
-			if (na == nullptr){
-				std::cerr << "Name Analysis Failed\n";
-				return 1;
-			}
-			outputAST(na->ast, namesFile);
+	if (scanBench){
+		if (batch || inputs.size() > 1 || opts.inputIsIR){
+			std::cerr << "--scan-bench takes one source file\n";
+			usageAndDie();
 		}
-		if (checkTypes){
-			cminusminus::TypeAnalysis * ta;
-			ta = doTypeAnalysis(inFile);
-			if (ta == nullptr){
-				std::cerr << "Type Analysis Failed\n";
-				return 1;
-			} else {
-				std::cout << "Great job! Type analysis succeeded\n";
-			}
+		return benchScanners(inputs[0].c_str());
+	}
+
+	if (batch){
+		if (opts.runProg){
+			std::cerr << "--run can't be used with --batch\n";
+			usageAndDie();
 		}
-		if (threeACFile != nullptr){
-			auto prog = do3AC(inFile); //what is prog -> does typeAnalysis and recursive walk to conv to 3AC
-									   //calls to3AC
-			if (prog == nullptr){ return 1; }
-			write3AC(prog, threeACFile); //writes 3AC to output file
+		if (!opts.pathsPerInput()){
+			std::cerr << "With --batch, every output file name"
+				<< " needs a % for the input's name\n";
+			usageAndDie();
 		}
-	} catch (cminusminus::ToDoError * e){
-		std::cerr << "ToDoError: " << e->msg() << "\n";
-		return 1;
-	} catch (cminusminus::InternalError * e){
-		std::string msg = "Something in the compiler is broken: ";
-		std::cerr << msg << e->msg() << std::endl;
-		exit(1);
-	} catch (UserError * e){
-		std::string msg = "The user made a mistake: ";
-		std::cerr << msg << e->msg() << std::endl;
-		exit(1);
+		return compileBatch(opts, inputs, numThreads);
 	}
-	return 0;
+
+	if (inputs.size() > 1){
+		std::cerr << "Only 1 input file allowed";
+		std::cerr << inputs[1] << std::endl;
+		usageAndDie();
+	}
+	if (access(inputs[0].c_str(), R_OK) != 0){
+		std::cerr << "Bad path " << inputs[0] << std::endl;
+		usageAndDie();
+	}
+	WorkPool pool(numThreads);
+	return compile(opts, inputs[0].c_str(), &pool);
 }
@@ -1,19 +1,48 @@
+#include <vector>
 #include "ast.hpp"
 #include "symbol_table.hpp"
 #include "errName.hpp"
 #include "types.hpp"
+#include "workers.hpp"
 
 namespace cminusminus{
 
 bool ProgramNode::nameAnalysis(SymbolTable * symTab){
+	//This never needs to be implemented, the
+	// program is analyzed with the Workers that
+	// run its function bodies (see below)
+	throw new InternalError("Program analyzed without workers");
+}
+
+//The declarations go into the global scope one at a time,
+// as they appear. Then each function body is analyzed in a
+// table of its own, which sees the globals declared up to
+// and including that function, so that the bodies can be
+// done concurrently.
+bool ProgramNode::nameAnalysis(SymbolTable * symTab, Workers& workers){
+	std::vector<DeclNode *> decls(myGlobals->begin(), myGlobals->end());
+	std::vector<size_t> visible(decls.size());
+	//Each is only written by its own declaration's step
+	std::vector<char> valid(decls.size(), true);
+
 	//Enter the global scope
 	symTab->enterScope();
-	bool res = true;
-	for (auto decl : *myGlobals){
-		res = decl->nameAnalysis(symTab) && res;
-	}
+	workers.inOrder(decls.size(), [&](size_t i){
+		valid[i] = decls[i]->nameAnalysis(symTab);
+		visible[i] = symTab->numDecls();
+	});
+	workers.concurrently(decls.size(), [&](size_t i){
+		SymbolTable bodyTab(symTab, visible[i]);
+		valid[i] = decls[i]->nameAnalysisBody(&bodyTab) && valid[i];
+	});
+	workers.flush();
 	//Leave the global scope
 	symTab->leaveScope();
+
+	bool res = true;
+	for (char declValid : valid){
+		res = declValid && res;
+	}
 	return res;
 }
 
@@ -79,7 +108,7 @@ bool VarDeclNode::nameAnalysis(SymbolTable * symTab){
 	bool checkType = myType->nameAnalysis(symTab);
 
 	const DataType * dataType = getTypeNode()->getType();
-	std::string varName = ID()->getName();
+	NameID varName = ID()->getNameID();
 
 	bool validType = true;
 	if (dataType == nullptr){
@@ -106,45 +135,50 @@ bool VarDeclNode::nameAnalysis(SymbolTable * symTab){
 }
 
 bool FnDeclNode::nameAnalysis(SymbolTable * symTab){
-	std::string fnName = this->ID()->getName();
+	NameID fnName = this->ID()->getNameID();
 
 	bool validRet = myRetType->nameAnalysis(symTab);
 
-	// hold onto the scope of the function.
-	ScopeTable * atFnScope = symTab->getCurrentScope();
-	//Enter a new scope for "within" this function.
-	ScopeTable * inFnScope = symTab->enterScope();
-
 	/*Note that we check for a clash of the function 
 	  name in it's declared scope (e.g. a global
-	  scope for a global function)
+	  scope for a global function), so this happens
+	  before entering the function's own scope
 	*/
 	bool validName = true;
-	if (atFnScope->clash(fnName)){
+	if (symTab->clash(fnName)){
 		NameErr::multiDecl(ID()->pos()); 
 		validName = false;
 	}
 
-	bool validFormals = true;
-	std::list<const DataType *> * formalTypes = 
-		new std::list<const DataType *>();
+	//The function's type depends only on the type nodes of
+	// its formals, not on their names
+	std::list<const DataType *> formalTypes;
 	for (auto formal : *(this->myFormals)){
-		validFormals = formal->nameAnalysis(symTab) && validFormals;
 		TypeNode * typeNode = formal->getTypeNode();
 		const DataType * formalType = typeNode->getType();
-		formalTypes->push_back(formalType);
+		formalTypes.push_back(formalType);
 	}
 
-
 	const DataType * retType = this->getRetTypeNode()->getType();
-	FnType * dataType = new FnType(formalTypes, retType);
+	FnType * dataType = FnType::produce(formalTypes, retType);
 	//Make sure the fnSymbol is in the symbol table before 
 	// analyzing the body, to allow for recursive calls
 	if (validName){
-		atFnScope->addFn(fnName, dataType);
-		SemSymbol * sym = atFnScope->lookup(fnName);
+		symTab->addFn(fnName, dataType);
+		SemSymbol * sym = symTab->find(fnName);
 		this->myID->attachSymbol(sym);
 	}
+	return validRet && validName;
+}
+
+bool FnDeclNode::nameAnalysisBody(SymbolTable * symTab){
+	//Enter a new scope for "within" this function.
+	symTab->enterScope();
+
+	bool validFormals = true;
+	for (auto formal : *(this->myFormals)){
+		validFormals = formal->nameAnalysis(symTab) && validFormals;
+	}
 
 	bool validBody = true;
 	for (auto stmt : *myBody){
@@ -152,7 +186,7 @@ bool FnDeclNode::nameAnalysis(SymbolTable * symTab){
 	}
 
 	symTab->leaveScope();
-	return (validRet && validFormals && validName && validBody);
+	return validFormals && validBody;
 }
 
 bool BinaryExpNode::nameAnalysis(SymbolTable * symTab){
@@ -230,8 +264,7 @@ bool FalseNode::nameAnalysis(SymbolTable * symTab){
 }
 
 bool IDNode::nameAnalysis(SymbolTable* symTab){
-	std::string myName = this->getName();
-	SemSymbol * sym = symTab->find(myName);
+	SemSymbol * sym = symTab->find(this->getNameID());
 	if (sym == nullptr){
 		return NameErr::undeclID(pos());
 	}
@@ -7,10 +7,10 @@ namespace cminusminus{
 
 class NameAnalysis{
 public:
-	static NameAnalysis * build(ProgramNode * astIn){
+	static NameAnalysis * build(ProgramNode * astIn, Workers& workers){
 		NameAnalysis * nameAnalysis = new NameAnalysis;
 		SymbolTable * symTab = new SymbolTable();
-		bool res = astIn->nameAnalysis(symTab);
+		bool res = astIn->nameAnalysis(symTab, workers);
 		delete symTab;
 		if (!res){ return nullptr; }
 
@@ -0,0 +1,76 @@
+#include "pipeline.hpp"
+#include "scanner.hpp"
+
+namespace cminusminus{
+
+const SourceFile& Pipeline::source(){
+	if (!src){ src.reset(new SourceFile(inPath)); }
+	return *src;
+}
+
+const TokenArray& Pipeline::tokens(){
+	if (!lexed){
+		lexed.reset(new TokenArray(source(), workers, scannerKind));
+	}
+	return *lexed;
+}
+
+void Pipeline::writeTokens(std::ostream& out){
+	tokens().write(out);
+}
+
+ProgramNode * Pipeline::parse(){
+	if (parsed){ return ast; }
+	parsed = true;
+	if (inputIsIR){
+		throw new UserError("A binary 3AC input can't be parsed");
+	}
+	Arena::Scope scope(&arena);
+
+	TokenReader reader(tokens());
+	Parser parser(reader, &ast);
+	int errCode = parser.parse();
+	if (errCode != 0){ ast = nullptr; }
+	return ast;
+}
+
+NameAnalysis * Pipeline::nameAnalysis(){
+	if (named){ return names; }
+	named = true;
+
+	ProgramNode * root = parse();
+	if (root == nullptr){ return nullptr; }
+	names = NameAnalysis::build(root, workers);
+	return names;
+}
+
+TypeAnalysis * Pipeline::typeAnalysis(){
+	if (typed){ return types; }
+	typed = true;
+	Arena::Scope scope(&arena);
+
+	NameAnalysis * nameRes = nameAnalysis();
+	if (nameRes == nullptr){ return nullptr; }
+	types = TypeAnalysis::build(nameRes, workers);
+	return types;
+}
+
+IRProgram * Pipeline::to3AC(){
+	if (lowered){ return prog; }
+	lowered = true;
+	Arena::Scope scope(&arena);
+
+	if (inputIsIR){
+		prog = IRProgram::readBinary(source().data(), source().size());
+		prog->optimize(optLevel, workers);
+		return prog;
+	}
+
+	TypeAnalysis * typeRes = typeAnalysis();
+	if (typeRes == nullptr){ return nullptr; }
+	prog = typeRes->ast->to3AC(typeRes, workers);
+	prog->optimize(optLevel, workers);
+	return prog;
+}
+
+}
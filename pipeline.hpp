@@ -0,0 +1,89 @@
+#ifndef CMINUSMINUS_PIPELINE_HPP
+#define CMINUSMINUS_PIPELINE_HPP
+
+#include <memory>
+#include "ast.hpp"
+#include "name_analysis.hpp"
+#include "type_analysis.hpp"
+#include "token_array.hpp"
+#include "workers.hpp"
+
+namespace cminusminus{
+
+//A single compilation of one input file. Each stage of the
+// front end is run at most once, the first time it (or a
+// later stage) is asked for, and the result is cached so
+// that every output requested on the command line is
+// produced from the same AST.
+//Note that name analysis annotates the AST in place, so
+// an unparse of the bare tree must be written before the
+// names (or anything after them) are requested.
+//All AST nodes built by the pipeline live in its arena
+// and are freed along with it.
+//The whole input is scanned into a TokenArray before the
+// parse starts, and the parser reads its tokens from
+// there.
+//The input is mapped into memory once (see SourceFile),
+// and tokens and nodes refer to its text in place, so it
+// stays mapped as long as the pipeline lives.
+//If the input is a binary 3AC file (see IRProgram::writeBinary)
+// there is no front end to run: to3AC() loads the program
+// directly, and the earlier stages aren't available.
+//With a pool, function bodies are analyzed, lowered and
+// optimized on it side by side (see Workers); the results,
+// messages included, are the same as without one. A big
+// enough input is scanned on it too (see TokenArray).
+class Pipeline{
+public:
+	Pipeline(const char * inPathIn, bool inputIsIRIn = false)
+	: inPath(inPathIn), inputIsIR(inputIsIRIn), workers(&arena){ }
+
+	//The input's tokens, scanned on first use
+	const TokenArray& tokens();
+	//Print the input's tokens, as for -t
+	void writeTokens(std::ostream& out);
+	//Each of these returns nullptr if the stage (or one
+	// of the stages it depends on) failed
+	ProgramNode * parse();
+	NameAnalysis * nameAnalysis();
+	TypeAnalysis * typeAnalysis();
+	IRProgram * to3AC();
+
+	//The optimization level the 3AC is run through once it
+	// has been built (see IRProgram::optimize)
+	void setOptLevel(unsigned int level){ optLevel = level; }
+	void setPool(WorkPool * pool){ workers.setPool(pool); }
+	//Which scanner reads the input (flex's, by default)
+	void setScanner(Lexer::Kind kind){ scannerKind = kind; }
+
+	//The input file, mapped on first use. Throws a
+	// UserError if it can't be read.
+	const SourceFile& source();
+private:
+	const char * inPath;
+	bool inputIsIR;
+	unsigned int optLevel = 0;
+	Lexer::Kind scannerKind = Lexer::Kind::FLEX;
+	//Declared before the arena, since what's in the arena
+	// refers into it
+	std::unique_ptr<SourceFile> src;
+	Arena arena;
+	//Declared after the arena, since the workers' arenas
+	// take node indices from it
+	Workers workers;
+
+	bool parsed = false;
+	bool named = false;
+	bool typed = false;
+	bool lowered = false;
+
+	std::unique_ptr<TokenArray> lexed;
+	ProgramNode * ast = nullptr;
+	NameAnalysis * names = nullptr;
+	TypeAnalysis * types = nullptr;
+	IRProgram * prog = nullptr;
+};
+
+}
+
+#endif
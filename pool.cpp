@@ -0,0 +1,123 @@
+#include "pool.hpp"
+
+namespace cminusminus{
+
+//The pool a thread is a worker of, and its queue there
+static thread_local WorkPool * workerOf = nullptr;
+static thread_local size_t workerQueue = 0;
+
+WorkPool::WorkPool(size_t numThreads) : pending(0){
+	if (numThreads == 0){ numThreads = 1; }
+	for (size_t i = 0; i < numThreads; i++){
+		queues.emplace_back(new Queue());
+	}
+	for (size_t i = 1; i < numThreads; i++){
+		threads.emplace_back([this, i](){ work(i); });
+	}
+}
+
+WorkPool::~WorkPool(){
+	{
+		std::lock_guard<std::mutex> hold(sleepLock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& thread : threads){ thread.join(); }
+}
+
+size_t WorkPool::defaultThreads(){
+	size_t cores = std::thread::hardware_concurrency();
+	return cores == 0 ? 1 : cores;
+}
+
+bool WorkPool::take(size_t self, Task& task){
+	{
+		Queue& own = *queues[self];
+		std::lock_guard<std::mutex> hold(own.lock);
+		if (!own.tasks.empty()){
+			task = own.tasks.back();
+			own.tasks.pop_back();
+			pending--;
+			return true;
+		}
+	}
+	for (size_t i = 1; i < queues.size(); i++){
+		Queue& victim = *queues[(self + i) % queues.size()];
+		std::lock_guard<std::mutex> hold(victim.lock);
+		if (!victim.tasks.empty()){
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			pending--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkPool::run(Task& task){
+	Batch * batch = task.batch;
+	try {
+		batch->fn(task.index);
+	} catch (...){
+		std::lock_guard<std::mutex> hold(batch->errorLock);
+		if (!batch->error){ batch->error = std::current_exception(); }
+	}
+	//The batch may be gone as soon as the count hits zero
+	if (--batch->remaining == 0){
+		std::lock_guard<std::mutex> hold(sleepLock);
+		wake.notify_all();
+	}
+}
+
+void WorkPool::work(size_t self){
+	workerOf = this;
+	workerQueue = self;
+	while (true){
+		Task task;
+		if (take(self, task)){
+			run(task);
+			continue;
+		}
+		std::unique_lock<std::mutex> hold(sleepLock);
+		wake.wait(hold, [this](){ return stopping || pending > 0; });
+		if (stopping){ return; }
+	}
+}
+
+void WorkPool::forEach(size_t count, const std::function<void(size_t)>& fn){
+	if (count == 0){ return; }
+	Batch batch(fn, count);
+	size_t self = workerOf == this ? workerQueue : 0;
+	{
+		//Queued in reverse, so the caller works from the
+		// first task while thieves start from the last
+		Queue& own = *queues[self];
+		std::lock_guard<std::mutex> hold(own.lock);
+		for (size_t i = count; i > 0; i--){
+			Task task;
+			task.batch = &batch;
+			task.index = i - 1;
+			own.tasks.push_back(task);
+		}
+		pending += count;
+	}
+	{
+		std::lock_guard<std::mutex> hold(sleepLock);
+		wake.notify_all();
+	}
+
+	while (batch.remaining > 0){
+		Task task;
+		if (take(self, task)){
+			run(task);
+			continue;
+		}
+		std::unique_lock<std::mutex> hold(sleepLock);
+		wake.wait(hold, [&](){
+			return batch.remaining == 0 || pending > 0;
+		});
+	}
+	if (batch.error){ std::rethrow_exception(batch.error); }
+}
+
+}
@@ -0,0 +1,84 @@
+#ifndef CMINUSMINUS_POOL_HPP
+#define CMINUSMINUS_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cminusminus{
+
+//A fixed set of threads that run batches of independent
+// tasks (see forEach) by work stealing. Every thread has
+// its own deque of tasks: it takes work from the back of
+// its own deque and, once that is empty, steals from the
+// front of another's, so a few long tasks don't leave the
+// other threads idle.
+//A task may start a batch of its own; the thread running
+// it then works on that batch (or anything else queued)
+// until the batch is done, rather than blocking.
+class WorkPool{
+public:
+	//numThreads counts the thread that calls forEach, so a
+	// pool of 1 runs everything on the caller
+	explicit WorkPool(size_t numThreads);
+	~WorkPool();
+	WorkPool(const WorkPool&) = delete;
+	WorkPool& operator=(const WorkPool&) = delete;
+
+	size_t size() const { return queues.size(); }
+
+	//Call fn(i) for each i below count, spread over the
+	// pool, and return once every call has finished. If
+	// any call throws, the first exception is rethrown
+	// here after the rest are done.
+	void forEach(size_t count, const std::function<void(size_t)>& fn);
+
+	//One thread per core, as far as the library can tell
+	static size_t defaultThreads();
+private:
+	class Batch{
+	public:
+		Batch(const std::function<void(size_t)>& fnIn, size_t count)
+		: fn(fnIn), remaining(count){ }
+		const std::function<void(size_t)>& fn;
+		std::atomic<size_t> remaining;
+		std::mutex errorLock;
+		std::exception_ptr error;
+	};
+	class Task{
+	public:
+		Batch * batch;
+		size_t index;
+	};
+	class Queue{
+	public:
+		std::mutex lock;
+		std::deque<Task> tasks;
+	};
+
+	bool take(size_t self, Task& task);
+	void run(Task& task);
+	void work(size_t self);
+
+	//Queue 0 belongs to threads outside the pool; each
+	// worker has one of the rest
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> threads;
+	//Tasks queued but not yet taken
+	std::atomic<size_t> pending;
+	bool stopping = false;
+	//Idle threads wait on wake for more tasks or for their
+	// batch to finish
+	std::mutex sleepLock;
+	std::condition_variable wake;
+};
+
+}
+
+#endif
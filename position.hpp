@@ -1,26 +1,38 @@
 #ifndef CMINUSMINUS_POSITION_H
 #define CMINUSMINUS_POSITION_H
 
+#include <cstdint>
 #include <string>
 
 namespace cminusminus{
 
+//A span of source text, from the start of its first 
+// character to the end of its last. Positions are small
+// values that live directly inside the tokens and nodes 
+// that use them; the "[l,c]-[l,c]" text is only built
+// when a diagnostic or dump asks for it.
 class Position{
 public: 
+	Position()
+	: myLineI(0), myColI(0), myLineE(0), myColE(0){
+	}
 	Position(size_t lineI, size_t colI, size_t lineE, size_t colE)
-	: myLineI(lineI), myColI(colI), myLineE(lineE), myColE(colE){
+	: myLineI(static_cast<uint32_t>(lineI)), 
+	  myColI(static_cast<uint32_t>(colI)),
+	  myLineE(static_cast<uint32_t>(lineE)), 
+	  myColE(static_cast<uint32_t>(colE)){
 	}
-	Position(Position * start, Position * end)
-	: myLineI(start->myLineI), myColI(start->myColI),
-	  myLineE(end->myLineE),myColE(end->myColE){
+	Position(const Position& start, const Position& end)
+	: myLineI(start.myLineI), myColI(start.myColI),
+	  myLineE(end.myLineE),myColE(end.myColE){
 	}
-	virtual void expand(Position * start, Position * end){
-	  myLineI = start->myLineI;
-	  myColI = start->myColI;
-	  myLineE = end->myLineE;
-	  myColE = end->myColE;
+	void expand(const Position& start, const Position& end){
+	  myLineI = start.myLineI;
+	  myColI = start.myColI;
+	  myLineE = end.myLineE;
+	  myColE = end.myColE;
 	}
-	virtual std::string begin() const{
+	std::string begin() const{
 		std::string result = "[" 
 		+ std::to_string(myLineI)
 		+ "," 
@@ -28,7 +40,7 @@ public:
 		+ "]";
 		return result;
 	}
-	virtual std::string span() const{
+	std::string span() const{
 		std::string result = begin()
 		+ "-[" 
 		+ std::to_string(myLineE)
@@ -38,13 +50,14 @@ public:
 		return result;
 	}
 private:
-	size_t myLineI;
-	size_t myColI;
-	size_t myLineE;
-	size_t myColE;
-
+	uint32_t myLineI;
+	uint32_t myColI;
+	uint32_t myLineE;
+	uint32_t myColE;
 };
 
+static_assert(sizeof(Position) == 16, "Position should stay packed");
+
 }
 
 #endif
@@ -1,25 +1,27 @@
-#include <fstream>
+#include <cstring>
 #include "scanner.hpp"
+#include "fast_scanner.hpp"
 
 using namespace cminusminus;
 
 using TokenKind = cminusminus::Parser::token;
-using Lexeme = cminusminus::Parser::semantic_type;
 
-void Scanner::outputTokens(std::ostream& outstream){
-	Lexeme lex;
-	int tokenKind;
-	while(true){
-		tokenKind = this->yylex(&lex);
-		if (tokenKind == TokenKind::END){
-			outstream << "EOF" 
-			  << " [" << this->lineNum 
-			  << "," << this->colNum << "]"
-			  << std::endl;
-			return;
-		} else {
-			outstream << lex.lexeme->toString()
-			  << std::endl;
-		}
+int Scanner::LexerInput(char * buf, int maxSize){
+	size_t len = end - fed;
+	if (len > static_cast<size_t>(maxSize)){
+		len = static_cast<size_t>(maxSize);
 	}
+	memcpy(buf, src.data() + fed, len);
+	fed += len;
+	return static_cast<int>(len);
+}
+
+std::unique_ptr<Lexer> Lexer::make(Kind kind, const SourceFile& src,
+	size_t begin, size_t end, size_t firstLine){
+	if (kind == Kind::FAST){
+		return std::unique_ptr<Lexer>(
+			new FastScanner(src, begin, end, firstLine));
+	}
+	return std::unique_ptr<Lexer>(
+		new Scanner(src, begin, end, firstLine));
 }
@@ -5,73 +5,105 @@
 #include <FlexLexer.h>
 #endif
 
+#include <memory>
 #include "grammar.hh"
 #include "errors.hpp"
+#include "source.hpp"
+#include "tokens.hpp"
 
 using TokenKind = cminusminus::Parser::token;
 
 namespace cminusminus{
 
-class Scanner : public yyFlexLexer{
+//What every scanner of a SourceFile has in common. There
+// are two, which find exactly the same tokens and report 
+// exactly the same messages: Scanner, which flex builds
+// from cminusminus.l, and FastScanner (see fast_scanner.hpp),
+// written by hand to get through the text faster.
+//A scanner fills in a Token for each token it finds (see
+// tokens.hpp), rather than allocating one. The SourceFile 
+// has to outlive the scanner and its tokens: identifiers
+// are interned straight from the source, and string 
+// literals refer into it.
+class Lexer{
 public:
-   
-   Scanner(std::istream *in) : yyFlexLexer(in)
-   {
-	lineNum = 1;
-	colNum = 1;
-   };
-   virtual ~Scanner() {
-   };
+   enum class Kind { FLEX, FAST };
+   virtual ~Lexer(){ }
+
+   //A scanner of the given kind for the bytes of src from
+   // begin up to end, where begin is the start of line 
+   // firstLine
+   static std::unique_ptr<Lexer> make(Kind kind, const SourceFile& src,
+     size_t begin, size_t end, size_t firstLine);
+   //...or for the whole of src
+   static std::unique_ptr<Lexer> make(Kind kind, const SourceFile& src){
+	return make(kind, src, 0, src.size(), 1);
+   }
 
-   //get rid of override virtual function warning
-   using FlexLexer::yylex;
+   //The kind of the next token, which is put in tok (or
+   // END, with tok left alone, once the input runs out)
+   virtual int yylex(cminusminus::Token * const tok) = 0;
 
-   // YY_DECL defined in the flex cminusminus.l
-   virtual int yylex( cminusminus::Parser::semantic_type * const lval);
+   //Where the scanner has got to (after the last token,
+   // once it has returned END)
+   size_t line() const { return lineNum; }
+   size_t col() const { return colNum; }
 
-   int makeBareToken(int tagIn){
-	size_t len = static_cast<size_t>(yyleng);
-	Position * pos = new Position(
-	  this->lineNum, this->colNum,
-	  this->lineNum, this->colNum+len);
-        this->yylval->lexeme = new Token(pos, tagIn);
-        colNum += len;
-        return tagIn;
+protected:
+   explicit Lexer(size_t firstLine) : lineNum(firstLine), colNum(1){ }
+
+   //Put the next len bytes in yylval, as a token of the
+   // given kind and value, and step over them
+   int makeToken(int kind, size_t len, uint64_t value = 0){
+	*yylval = Token(kind, lineNum, colNum, len, value);
+	colNum += len;
+	return kind;
+   }
+   int makeIDToken(size_t len, StrRef name){
+	return makeToken(TokenKind::ID, len, Interner::intern(name));
+   }
+   int makeNumToken(int kind, size_t len, int num){
+	return makeToken(kind, len, 
+	  static_cast<uint64_t>(static_cast<int64_t>(num)));
+   }
+   //offset is where the literal starts in the source
+   int makeStrToken(size_t len, size_t offset){
+	return makeToken(TokenKind::STRLITERAL, len, offset);
    }
 
-   void errIllegal(Position * pos, std::string match){
+   void errIllegal(const Position& pos, std::string match){
 	cminusminus::Report::fatal(pos, "Illegal character "
 		+ match);
    }
 
-   void errStrEsc(Position * pos){
+   void errStrEsc(const Position& pos){
 	cminusminus::Report::fatal(pos, "String literal with bad"
 	" escape sequence ignored");
    }
 
-   void errStrUnterm(Position * pos){
+   void errStrUnterm(const Position& pos){
 	cminusminus::Report::fatal(pos, "Unterminated string"
 	" literal ignored");
    }
 
-   void errStrEscAndUnterm(Position * pos){
+   void errStrEscAndUnterm(const Position& pos){
 	cminusminus::Report::fatal(pos, "Unterminated string literal"
 	" with bad escape sequence ignored");
    }
 
-   void errIntOverflow(Position * pos){
+   void errIntOverflow(const Position& pos){
 	cminusminus::Report::fatal(pos, "Integer literal overflow");
    }
 
-   void errIntUnderflow(Position * pos){
+   void errIntUnderflow(const Position& pos){
 	cminusminus::Report::fatal(pos, "Integer literal underflow");
    }
 
-   void errShortOverflow(Position * pos){
+   void errShortOverflow(const Position& pos){
 	cminusminus::Report::fatal(pos, "Short literal overflow");
    }
 
-   void errShortUnderflow(Position * pos){
+   void errShortUnderflow(const Position& pos){
 	cminusminus::Report::fatal(pos, "Short literal underflow");
    }
 
@@ -87,14 +119,59 @@ public:
    }
 */
 
+   cminusminus::Token *yylval = nullptr;
+   size_t lineNum;
+   size_t colNum;
+};
+
+class Scanner : public yyFlexLexer, public Lexer{
+public:
+   
+   Scanner(const SourceFile& srcIn) : Scanner(srcIn, 0, srcIn.size(), 1){ }
+
+   //Scan just the bytes of srcIn from begin up to endIn,
+   // where begin is the start of line firstLine
+   Scanner(const SourceFile& srcIn, size_t begin, size_t endIn, 
+     size_t firstLine)
+   : yyFlexLexer(nullptr), Lexer(firstLine), src(srcIn), 
+     end(endIn), fed(begin), tokenStart(begin), tokenEnd(begin)
+   { }
+   virtual ~Scanner() {
+   };
+
+   //get rid of override virtual function warning
+   using FlexLexer::yylex;
+
+   // YY_DECL defined in the flex cminusminus.l
+   virtual int yylex( cminusminus::Token * const lval) override;
+
+   int makeBareToken(int tagIn){
+	return makeToken(tagIn, static_cast<size_t>(yyleng));
+   }
+
    static std::string tokenKindString(int tokenKind);
 
-   void outputTokens(std::ostream& outstream);
+   //The text of the current match, and where it starts, in
+   // the source itself (yytext is flex's copy of it)
+   size_t lexemeOffset() const { return tokenStart; }
+   StrRef lexeme() const {
+	return StrRef(src.data() + tokenStart, static_cast<size_t>(yyleng));
+   }
+
+protected:
+   //Flex fills its buffer from here, rather than from yyin
+   virtual int LexerInput(char * buf, int maxSize) override;
 
 private:
-   cminusminus::Parser::semantic_type *yylval = nullptr;
-   size_t lineNum;
-   size_t colNum;
+   const SourceFile& src;
+   //Where in src to stop
+   size_t end;
+   //How much of src has been handed to flex
+   size_t fed;
+   //Where the current match starts in src, and where the
+   // next one will (see YY_USER_ACTION)
+   size_t tokenStart;
+   size_t tokenEnd;
 };
 
 } /* end namespace */
@@ -0,0 +1,47 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <iterator>
+#include "source.hpp"
+#include "errors.hpp"
+
+namespace cminusminus{
+
+SourceFile::SourceFile(const char * path){
+	int fd = open(path, O_RDONLY);
+	if (fd < 0){
+		std::string msg = "Bad input stream ";
+		msg += path;
+		throw new UserError(msg.c_str());
+	}
+	struct stat info;
+	if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0){
+		size_t len = static_cast<size_t>(info.st_size);
+		void * addr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr != MAP_FAILED){
+			//The scanner reads straight through from the front
+			madvise(addr, len, MADV_SEQUENTIAL);
+			myData = static_cast<const char *>(addr);
+			mySize = len;
+			mapped = true;
+		}
+	}
+	close(fd);
+	if (mapped){ return; }
+
+	std::ifstream in(path, std::ios::binary);
+	copy.assign(std::istreambuf_iterator<char>(in), 
+		std::istreambuf_iterator<char>());
+	myData = copy.data();
+	mySize = copy.size();
+}
+
+SourceFile::~SourceFile(){
+	if (mapped){
+		munmap(const_cast<char *>(myData), mySize);
+	}
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef CMINUSMINUS_SOURCE_HPP
+#define CMINUSMINUS_SOURCE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace cminusminus{
+
+//Characters that belong to something else (usually a
+// mapped SourceFile): just a pointer and a length, like
+// C++17's std::string_view. Nothing is copied until str()
+// asks for it.
+class StrRef{
+public:
+	StrRef() : ptr(nullptr), len(0){ }
+	StrRef(const char * ptrIn, size_t lenIn) : ptr(ptrIn), len(lenIn){ }
+	StrRef(const std::string& str) : ptr(str.data()), len(str.size()){ }
+	const char * data() const { return ptr; }
+	size_t size() const { return len; }
+	std::string str() const { return std::string(ptr, len); }
+	bool operator==(const StrRef& other) const {
+		return len == other.len && memcmp(ptr, other.ptr, len) == 0;
+	}
+
+	//For hash tables keyed by StrRef (FNV-1a)
+	class Hash{
+	public:
+		size_t operator()(const StrRef& ref) const {
+			uint64_t h = 0xcbf29ce484222325ull;
+			for (size_t i = 0; i < ref.len; i++){
+				h = (h ^ static_cast<unsigned char>(ref.ptr[i])) 
+					* 0x100000001b3ull;
+			}
+			return static_cast<size_t>(h);
+		}
+	};
+private:
+	const char * ptr;
+	size_t len;
+};
+
+inline std::ostream& operator<<(std::ostream& out, const StrRef& ref){
+	return out.write(ref.data(), static_cast<std::streamsize>(ref.size()));
+}
+
+//An input file, mapped read-only into memory once and
+// kept there for as long as the object lives, so that
+// the scanner and the tokens it builds can refer to the
+// text in place. Something that can't be mapped (a pipe,
+// say) is read into memory instead.
+class SourceFile{
+public:
+	//Throws a UserError if path can't be read
+	explicit SourceFile(const char * path);
+	~SourceFile();
+	SourceFile(const SourceFile&) = delete;
+	SourceFile& operator=(const SourceFile&) = delete;
+
+	const char * data() const { return myData; }
+	size_t size() const { return mySize; }
+	StrRef text() const { return StrRef(myData, mySize); }
+private:
+	const char * myData = nullptr;
+	size_t mySize = 0;
+	//Whether myData is a mapping, rather than copy.data()
+	bool mapped = false;
+	std::string copy;
+};
+
+}
+
+#endif
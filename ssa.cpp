@@ -0,0 +1,286 @@
+#include <algorithm>
+#include "3ac.hpp"
+#include "cfg.hpp"
+#include "liveness.hpp"
+
+namespace cminusminus{
+
+//Build pruned SSA form in the usual way (Cytron et al.):
+// a variable gets a phi in the iterated dominance
+// frontier of the blocks that write it, wherever it is
+// live on entry, and then every write makes a new version
+// (a temp named after the variable) while walking the
+// dominator tree. A read that no write reaches sees an
+// undefined version, "x.0", which is never written.
+//A formal's getarg keeps the formal itself as the first
+// version, so the argument doesn't need a second slot.
+//Only locals and formals whose address is never taken are
+// renamed, since nothing else can touch them. The locals
+// that end up with no uses are dropped from the frame.
+void Procedure::toSSA(){
+	std::vector<bool> addrTaken(opds.size(), false);
+	for (auto& quad : body){
+		if (quad.kind != LOC_QUAD){ continue; }
+		if (quad.srcIsLoc()){ addrTaken[quad.src1] = true; }
+		if (quad.tgtIsLoc()){ addrTaken[quad.dst] = true; }
+	}
+	std::vector<OpdID> vars;
+	for (auto formal : formals){
+		if (!addrTaken[formal]){ vars.push_back(formal); }
+	}
+	for (auto local : localsInOrder){
+		if (!addrTaken[local]){ vars.push_back(local); }
+	}
+	if (vars.empty()){ return; }
+
+	CFG cfg(this);
+	Liveness live(&cfg, vars);
+	size_t numBlocks = cfg.blocks().size();
+
+	std::vector<std::vector<BasicBlock *>> defBlocks(vars.size());
+	for (auto block : cfg.rpo()){
+		for (size_t i = block->begin(); i != block->end(); i++){
+			size_t var = live.indexOf(Liveness::def(this, body[i]));
+			if (var == Liveness::NONE){ continue; }
+			if (defBlocks[var].empty() || defBlocks[var].back() != block){
+				defBlocks[var].push_back(block);
+			}
+		}
+	}
+
+	//Each block's phis, with the variable each is for
+	std::vector<std::vector<std::pair<Quad, size_t>>> phis(numBlocks);
+	std::vector<size_t> hasPhi(numBlocks, Liveness::NONE);
+	std::vector<size_t> queued(numBlocks, Liveness::NONE);
+	for (size_t var = 0; var < vars.size(); var++){
+		std::vector<BasicBlock *> work = defBlocks[var];
+		for (auto block : work){ queued[block->getID()] = var; }
+		while (!work.empty()){
+			BasicBlock * block = work.back();
+			work.pop_back();
+			for (auto join : cfg.frontier(block)){
+				size_t id = join->getID();
+				if (hasPhi[id] == var || join->isExit()
+					|| !live.liveIn(join).has(var)){
+					continue;
+				}
+				hasPhi[id] = var;
+				Quad res = phi(vars[var], join->preds().size());
+				phis[id].push_back(std::make_pair(res, var));
+				if (queued[id] != var){
+					queued[id] = var;
+					work.push_back(join);
+				}
+			}
+		}
+	}
+
+	std::vector<std::vector<OpdID>> stacks(vars.size());
+	std::vector<size_t> versions(vars.size(), 0);
+	std::vector<OpdID> undef(vars.size(), NO_OPD);
+	auto version = [&](size_t var, size_t num){
+		SymOpd * sym = static_cast<SymOpd *>(opds[vars[var]]);
+		OpdID val = addOpd(new AuxOpd(sym->getName() + "." + std::to_string(num),
+			sym->getWidth()));
+		temps.push_back(val);
+		return val;
+	};
+	auto fresh = [&](size_t var){
+		OpdID val = version(var, ++versions[var]);
+		stacks[var].push_back(val);
+		return val;
+	};
+	auto current = [&](size_t var){
+		if (!stacks[var].empty()){ return stacks[var].back(); }
+		if (undef[var] == NO_OPD){ undef[var] = version(var, 0); }
+		return undef[var];
+	};
+
+	//Walk the dominator tree, remembering which versions
+	// each block pushed so they can be popped on the way out
+	std::vector<size_t> pushed;
+	std::vector<std::pair<BasicBlock *, size_t>> path;
+	std::vector<size_t> marks;
+	path.push_back(std::make_pair(cfg.entry(), 0));
+	while (!path.empty()){
+		BasicBlock * block = path.back().first;
+		size_t& next = path.back().second;
+		if (next == 0){
+			marks.push_back(pushed.size());
+			for (auto& phi : phis[block->getID()]){
+				phi.first.dst = fresh(phi.second);
+				pushed.push_back(phi.second);
+			}
+			for (size_t i = block->begin(); i != block->end(); i++){
+				Quad& quad = body[i];
+				for (OpdID * use : useSlots(quad)){
+					size_t var = live.indexOf(*use);
+					if (var != Liveness::NONE){ *use = current(var); }
+				}
+				size_t var = live.indexOf(Liveness::def(this, quad));
+				if (var == Liveness::NONE){ continue; }
+				if (quad.kind == GETARG_QUAD && versions[var] == 0
+					&& stacks[var].empty()){
+					stacks[var].push_back(vars[var]);
+				} else {
+					*quad.defSlot() = fresh(var);
+				}
+				pushed.push_back(var);
+			}
+			for (auto succ : block->succs()){
+				size_t pred = cfg.predIndex(succ, block);
+				for (auto& phi : phis[succ->getID()]){
+					OpdID src = current(phi.second);
+					phiSrc(phi.first, pred) = src;
+				}
+			}
+		}
+		if (next < block->domChildren().size()){
+			BasicBlock * child = block->domChildren()[next++];
+			path.push_back(std::make_pair(child, 0));
+		} else {
+			for (size_t i = marks.back(); i < pushed.size(); i++){
+				stacks[pushed[i]].pop_back();
+			}
+			pushed.resize(marks.back());
+			marks.pop_back();
+			path.pop_back();
+		}
+	}
+
+	//Put the phis at the head of their blocks, taking over
+	// the labels of the quad that used to be first
+	std::vector<Quad> withPhis;
+	withPhis.reserve(body.size());
+	for (auto block : cfg.blocks()){
+		auto& blockPhis = phis[block->getID()];
+		if (!blockPhis.empty()){
+			Quad& first = body[block->begin()];
+			blockPhis.front().first.labels = first.labels;
+			clearLabels(first);
+			for (auto& phi : blockPhis){ withPhis.push_back(phi.first); }
+		}
+		for (size_t i = block->begin(); i < block->end(); i++){
+			withPhis.push_back(body[i]);
+		}
+	}
+	body.swap(withPhis);
+
+	//A phi source is NO_OPD on an edge from an unreachable
+	// block
+	std::vector<bool> referenced(opds.size(), false);
+	for (auto& quad : body){
+		for (OpdID * use : useSlots(quad)){
+			if (*use != NO_OPD){ referenced[*use] = true; }
+		}
+		if (quad.defSlot() != nullptr){ referenced[*quad.defSlot()] = true; }
+	}
+	localsInOrder.erase(std::remove_if(localsInOrder.begin(),
+		localsInOrder.end(), [&](OpdID local){
+			if (referenced[local]){ return false; }
+			symOpds[static_cast<SymOpd *>(opds[local])->getSym()->getSlot()] = NO_OPD;
+			return true;
+		}), localsInOrder.end());
+}
+
+//Replace the phis at the head of each block with copies
+// on the edges into it. Since every version belongs to a
+// single variable and nothing has been coalesced since
+// toSSA, a block's phis never read each other's results,
+// and their copies can be made one after another.
+//A copy on an IFZ's jump can't go in the block the jump
+// is in, so the edge is split: the jump goes to a new
+// block of copies at the end of the body, which then goes
+// to the block.
+void Procedure::fromSSA(){
+	CFG cfg(this);
+	std::vector<bool> defined(opds.size(), false);
+	for (auto& quad : body){
+		OpdID def = Liveness::def(this, quad);
+		if (def != NO_OPD){ defined[def] = true; }
+	}
+
+	//The copies go in as the body is rebuilt at the end:
+	// before[i] is what goes just before body[i]
+	std::vector<std::vector<Quad>> before(body.size() + 1);
+	std::vector<bool> drop(body.size(), false);
+	std::vector<Quad> splits;
+	for (size_t b = 0; b < cfg.blocks().size(); b++){
+		BasicBlock * block = cfg.blocks()[b];
+		if (block->isExit()){ continue; }
+		std::vector<Quad> blockPhis;
+		size_t head = block->begin();
+		for (size_t i = head; i != block->end()
+			&& body[i].kind == PHI_QUAD; i++){
+			blockPhis.push_back(body[i]);
+			//The first phi's place is kept for the head nop
+			if (i != head){ drop[i] = true; }
+		}
+		if (blockPhis.empty()){ continue; }
+		std::set<OpdID> phiDsts;
+		for (auto& phi : blockPhis){ phiDsts.insert(phi.dst); }
+		for (auto& phi : blockPhis){
+			for (size_t p = 0; p < block->preds().size(); p++){
+				OpdID src = phiSrc(phi, p);
+				if (src != phi.dst && phiDsts.count(src)){
+					throw new InternalError("Phis read each other's results");
+				}
+			}
+		}
+		body[head] = Quad::nop();
+		body[head].labels = blockPhis.front().labels;
+
+		for (size_t p = 0; p < block->preds().size(); p++){
+			BasicBlock * pred = block->preds()[p];
+			if (!pred->reachable()){ continue; }
+			auto copies = [&](){
+				std::vector<Quad> res;
+				for (auto& phi : blockPhis){
+					OpdID src = phiSrc(phi, p);
+					if (src == NO_OPD || src == phi.dst || !defined[src]){
+						continue;
+					}
+					res.push_back(Quad::assign(phi.dst, src));
+				}
+				return res;
+			};
+			std::vector<Quad> res = copies();
+			if (res.empty()){ continue; }
+			size_t last = pred->end() - 1;
+			if (body[last].kind == GOTO_QUAD){
+				before[last].insert(before[last].end(), res.begin(), res.end());
+				continue;
+			}
+			if (body[last].kind == IFZ_QUAD
+				&& cfg.blockOf(body[last].target()) == block){
+				if (!body[head].hasLabels()){ addLabel(body[head], makeLabel()); }
+				std::vector<Quad> jump = copies();
+				Label * split = makeLabel();
+				addLabel(jump.front(), split);
+				body[last].aux = split->getSlot();
+				jump.push_back(Quad::jump(labelsOf(body[head]).front()));
+				splits.insert(splits.end(), jump.begin(), jump.end());
+			}
+			if (pred->getID() + 1 == b){
+				before[head].insert(before[head].end(), res.begin(), res.end());
+			}
+		}
+	}
+
+	std::vector<Quad> withCopies;
+	withCopies.reserve(body.size() + splits.size() + 1);
+	for (size_t i = 0; i <= body.size(); i++){
+		withCopies.insert(withCopies.end(), before[i].begin(), before[i].end());
+		if (i < body.size() && !drop[i]){ withCopies.push_back(body[i]); }
+	}
+	if (!splits.empty()){
+		//Don't let the end of the body run on into the splits
+		if (withCopies.empty() || withCopies.back().kind != GOTO_QUAD){
+			withCopies.push_back(Quad::jump(leaveLabel));
+		}
+		withCopies.insert(withCopies.end(), splits.begin(), splits.end());
+	}
+	body.swap(withCopies);
+}
+
+}
@@ -2,88 +2,140 @@
 #include "types.hpp"
 namespace cminusminus{
 
-SymbolTable::SymbolTable(){
-	scopeTableChain = new std::list<ScopeTable *>();
+SymbolTable::SymbolTable() : slots(64, Slot{NONE, NONE}), slotsUsed(0){
+	bindings.reserve(64);
+}
+
+SymbolTable::SymbolTable(const SymbolTable * globals, size_t numVisible)
+: SymbolTable(){
+	outer = globals;
+	outerVisible = numVisible;
 }
 
 void SymbolTable::print(){
-	for(auto scope : *scopeTableChain){
+	size_t top = bindings.size();
+	for (size_t depth = scopeMarks.size(); depth > 0; depth--){
+		size_t mark = scopeMarks[depth - 1];
 		std::cout << "--- scope ---\n";
-		std::cout << scope->toString();
+		for (size_t i = mark; i < top; i++){
+			std::cout << bindings[i].symbol->toString();
+			std::cout << "\n";
+		}
+		top = mark;
 	}
 }
 
-ScopeTable * SymbolTable::enterScope(){
-	ScopeTable * newScope = new ScopeTable();
-	scopeTableChain->push_front(newScope);
-	return newScope;
+void SymbolTable::enterScope(){
+	scopeMarks.push_back(bindings.size());
 }
 
 void SymbolTable::leaveScope(){
-	if (scopeTableChain->empty()){
+	if (scopeMarks.empty()){
 		throw new InternalError("Attempt to pop"
 			"empty symbol table");
 	}
-	scopeTableChain->pop_front();
+	size_t mark = scopeMarks.back();
+	scopeMarks.pop_back();
+	while (bindings.size() > mark){
+		Binding& top = bindings.back();
+		slots[top.slot].binding = top.shadowed;
+		bindings.pop_back();
+	}
 }
 
-ScopeTable * SymbolTable::getCurrentScope(){
-	return scopeTableChain->front();
+//Fibonacci hashing spreads the (dense, sequential)
+// interned ids across the table
+static uint32_t hashName(NameID name, size_t mask){
+	return static_cast<uint32_t>(
+		(static_cast<uint64_t>(name) * 0x9E3779B97F4A7C15ull >> 32) & mask);
 }
 
-bool SymbolTable::clash(std::string varName){
-	bool hasClash = getCurrentScope()->clash(varName);
-	return hasClash;
+//The slot holding name, or NONE if it was never declared
+uint32_t SymbolTable::probe(NameID name) const{
+	size_t mask = slots.size() - 1;
+	uint32_t idx = hashName(name, mask);
+	while (true){
+		const Slot& slot = slots[idx];
+		if (slot.name == NONE){ return NONE; }
+		if (slot.name == name){ return idx; }
+		idx = static_cast<uint32_t>((idx + 1) & mask);
+	}
 }
 
-SemSymbol * SymbolTable::find(std::string varName){
-	for (ScopeTable * scope : *scopeTableChain){
-		SemSymbol * sym = scope->lookup(varName);
-		if (sym != nullptr) { return sym; }
+//The slot holding name, adding one if needed
+uint32_t SymbolTable::claim(NameID name){
+	uint32_t found = probe(name);
+	if (found != NONE){ return found; }
+	if ((slotsUsed + 1) * 2 > slots.size()){ grow(); }
+
+	size_t mask = slots.size() - 1;
+	uint32_t idx = hashName(name, mask);
+	while (slots[idx].name != NONE){
+		idx = static_cast<uint32_t>((idx + 1) & mask);
 	}
-	return nullptr;
+	slots[idx] = Slot{name, NONE};
+	slotsUsed++;
+	return idx;
 }
 
-bool SymbolTable::insert(SemSymbol * symbol){
-	return scopeTableChain->front()->insert(symbol);
-}
+//Double the table. Names that are no longer bound in any
+// open scope are dropped along the way.
+void SymbolTable::grow(){
+	std::vector<Slot> old;
+	old.swap(slots);
+	slots.assign(old.size() * 2, Slot{NONE, NONE});
+	slotsUsed = 0;
 
-ScopeTable::ScopeTable(){
-	symbols = new HashMap<std::string, SemSymbol *>();
+	size_t mask = slots.size() - 1;
+	for (const Slot& slot : old){
+		if (slot.binding == NONE){ continue; }
+		uint32_t idx = hashName(slot.name, mask);
+		while (slots[idx].name != NONE){
+			idx = static_cast<uint32_t>((idx + 1) & mask);
+		}
+		slots[idx] = slot;
+		slotsUsed++;
+		for (uint32_t b = slot.binding; b != NONE; b = bindings[b].shadowed){
+			bindings[b].slot = idx;
+		}
+	}
 }
 
-std::string ScopeTable::toString(){
-	std::string result = "";
-	for (auto entry : *symbols){
-		result += entry.second->toString();
-		result += "\n";
-	}
-	return result;
+bool SymbolTable::clash(NameID varName){
+	uint32_t idx = probe(varName);
+	if (idx == NONE){ return false; }
+	uint32_t b = slots[idx].binding;
+	return b != NONE && bindings[b].depth == scopeMarks.size();
 }
 
-bool ScopeTable::clash(std::string varName){
-	SemSymbol * found = lookup(varName);
-	if (found != nullptr){
-		return true;
-	}
-	return false;
+SemSymbol * SymbolTable::find(NameID varName){
+	uint32_t idx = probe(varName);
+	uint32_t b = idx == NONE ? NONE : slots[idx].binding;
+	if (b != NONE){ return bindings[b].symbol; }
+	if (outer != nullptr){ return outer->findBefore(varName, outerVisible); }
+	return nullptr;
 }
 
-SemSymbol * ScopeTable::lookup(std::string name){
-	auto found = symbols->find(name);
-	if (found == symbols->end()){
-		return NULL;
-	}
-	return found->second;
+//The innermost binding of name among the first limit
+// declarations, as find() would have seen it then
+SemSymbol * SymbolTable::findBefore(NameID name, size_t limit) const{
+	uint32_t idx = probe(name);
+	if (idx == NONE){ return nullptr; }
+	uint32_t b = slots[idx].binding;
+	while (b != NONE && b >= limit){ b = bindings[b].shadowed; }
+	if (b == NONE){ return nullptr; }
+	return bindings[b].symbol;
 }
 
-bool ScopeTable::insert(SemSymbol * symbol){
-	std::string symName = symbol->getName();
-	bool alreadyInScope = (this->lookup(symName) != NULL);
-	if (alreadyInScope){
+bool SymbolTable::insert(SemSymbol * symbol){
+	NameID symName = symbol->getNameID();
+	if (clash(symName)){
 		return false;
 	}
-	this->symbols->insert(std::make_pair(symName, symbol));
+	uint32_t idx = claim(symName);
+	uint32_t depth = static_cast<uint32_t>(scopeMarks.size());
+	bindings.push_back(Binding{symbol, depth, idx, slots[idx].binding});
+	slots[idx].binding = static_cast<uint32_t>(bindings.size() - 1);
 	return true;
 }
 
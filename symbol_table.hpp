@@ -3,7 +3,10 @@
 #include <string>
 #include <unordered_map>
 #include <list>
+#include <vector>
+#include <cstdint>
 #include "types.hpp"
+#include "interner.hpp"
 
 //Use an alias template so that we can use
 // "HashMap" and it means "std::unordered_map"
@@ -26,12 +29,22 @@ enum SymbolKind {
 // symbol table. 
 class SemSymbol {
 public:
-	SemSymbol(std::string nameIn, const DataType * typeIn) 
+	SemSymbol(NameID nameIn, const DataType * typeIn) 
 	: myName(nameIn), myType(typeIn){ }
 	virtual std::string toString();
-	std::string getName() const { return myName; }
+	const std::string& getName() const { 
+		return Interner::spelling(myName); 
+	}
+	NameID getNameID() const { return myName; }
 	virtual SymbolKind getKind() const = 0;
 
+	//The index of this symbol's operand in the procedure
+	// that declares it (see Procedure::getSymOpd), or
+	// NO_SLOT for globals and functions
+	uint32_t getSlot() const { return mySlot; }
+	void setSlot(uint32_t slot){ mySlot = slot; }
+	static const uint32_t NO_SLOT = UINT32_MAX;
+
 	virtual const DataType * getDataType() const{
 		return myType;
 	}
@@ -43,66 +56,87 @@ public:
 		return "UNKNOWN KIND";
 	} 
 private:
-	std::string myName;
+	NameID myName;
 	const DataType * myType;
+	uint32_t mySlot = NO_SLOT;
 };
 
 class VarSymbol : public SemSymbol {
 public:
-	VarSymbol(std::string name, const DataType * type) 
+	VarSymbol(NameID name, const DataType * type) 
 	: SemSymbol(name, type) { }
 	virtual SymbolKind getKind() const override { return VAR; } 
 };
 
 class FnSymbol : public SemSymbol{
 public:
-	FnSymbol(std::string name, const FnType * fnType)
+	FnSymbol(NameID name, const FnType * fnType)
 	: SemSymbol(name, fnType){ }
 	virtual SymbolKind getKind() const { return FN; }
 	SymbolKind getKind(){ return FN; } 
 };
 
-//A single scope. The symbol table is broken down into a 
-// chain of scope tables, and each scope table holds 
-// semantic symbols for a single scope. For example,
-// the globals scope will be represented by a ScopeTable,
-// and the contents of each function can be represented by
-// a ScopeTable.
-class ScopeTable {
-	public:
-		ScopeTable();
-		SemSymbol * lookup(std::string name);
-		bool insert(SemSymbol * symbol);
-		bool clash(std::string name);
-		std::string toString();
-		void addVar(std::string name, const DataType * type){
-			insert(new VarSymbol(name, type));
-		}
-		void addFn(std::string name, FnType * type){
-			insert(new FnSymbol(name, type));
-		}
-	private:
-		HashMap<std::string, SemSymbol *> * symbols;
-};
-
+//The symbol table. Rather than a chain of per-scope maps,
+// every visible symbol lives in one open-addressing table
+// keyed by interned name, so a lookup is a single probe no
+// matter how deeply scopes are nested.
+//Each declaration pushes a binding onto a stack; the
+// binding remembers the one it shadows. Entering a scope
+// just marks the top of that stack, and leaving it pops
+// back to the mark, restoring each shadowed binding.
+//A function body can be analyzed in a table of its own
+// (see ProgramNode::nameAnalysis), which looks up any name
+// not declared in the body among the globals.
 class SymbolTable{
 	public:
 		SymbolTable();
-		ScopeTable * enterScope();
+		//A table whose names fall back to the first
+		// numVisible declarations made in globals. globals
+		// is only read, so many such tables can share it
+		// while it is left alone.
+		SymbolTable(const SymbolTable * globals, size_t numVisible);
+		void enterScope();
 		void leaveScope();
-		ScopeTable * getCurrentScope();
 		bool insert(SemSymbol * symbol);
-		SemSymbol * find(std::string varName);
-		bool clash(std::string name);
-		void addVar(std::string name, const DataType * type){
-			getCurrentScope()->addVar(name, type);
+		SemSymbol * find(NameID varName);
+		bool clash(NameID name);
+		void addVar(NameID name, const DataType * type){
+			insert(new VarSymbol(name, type));
 		}
-		void addFn(std::string name, FnType * type){
-			getCurrentScope()->addFn(name, type);
+		void addFn(NameID name, FnType * type){
+			insert(new FnSymbol(name, type));
 		}
 		void print();
+		//How many declarations have been made in the table
+		size_t numDecls() const { return bindings.size(); }
 	private:
-		std::list<ScopeTable *> * scopeTableChain;
+		static const uint32_t NONE = UINT32_MAX;
+
+		//A name that has been declared at some point (or NONE
+		// for an empty slot). Slots are never removed while the
+		// table is in use, only left without a binding.
+		struct Slot{
+			NameID name;
+			uint32_t binding;
+		};
+		struct Binding{
+			SemSymbol * symbol;
+			uint32_t depth;
+			uint32_t slot;
+			uint32_t shadowed;
+		};
+
+		uint32_t probe(NameID name) const;
+		SemSymbol * findBefore(NameID name, size_t limit) const;
+		uint32_t claim(NameID name);
+		void grow();
+
+		std::vector<Slot> slots;
+		uint32_t slotsUsed;
+		std::vector<Binding> bindings;
+		std::vector<size_t> scopeMarks;
+		const SymbolTable * outer = nullptr;
+		size_t outerVisible = 0;
 };
 
 	
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include "token_array.hpp"
+#include "errors.hpp"
+
+namespace cminusminus{
+
+//About how much of the file each chunk holds (a chunk runs
+// on to the end of the line it would stop in)
+static const size_t CHUNK_BYTES = 256 * 1024;
+
+//One chunk's tokens and messages, numbered from the
+// start of the chunk
+class TokenArray::Chunk{
+public:
+	void scan(const SourceFile& src, size_t begin, size_t end, 
+		size_t firstLine, Lexer::Kind kind);
+
+	std::vector<Token> entries;
+	std::vector<std::pair<size_t, std::string>> notes;
+	size_t endLine = 1;
+	size_t endCol = 1;
+};
+
+void TokenArray::Chunk::scan(const SourceFile& src, size_t begin, 
+	size_t end, size_t firstLine, Lexer::Kind kind){
+	std::unique_ptr<Lexer> scanner = Lexer::make(kind, src, begin, end, 
+		firstLine);
+	std::ostringstream log;
+	Report::Redirect redirect(&log);
+	while (true){
+		//Filled in place, and dropped again at the end
+		entries.emplace_back();
+		int kind = scanner->yylex(&entries.back());
+		if (log.tellp() > 0){
+			notes.push_back(std::make_pair(entries.size() - 1, log.str()));
+			log.str("");
+		}
+		if (kind == TokenKind::END){
+			entries.pop_back();
+			break;
+		}
+	}
+	endLine = scanner->line();
+	endCol = scanner->col();
+}
+
+TokenArray::TokenArray(const SourceFile& srcIn, Workers& workers, 
+	Lexer::Kind kind) : src(srcIn){
+	const char * text = src.data();
+	std::vector<size_t> cuts;
+	cuts.push_back(0);
+	if (!workers.parallel() || src.size() < 2 * CHUNK_BYTES){
+		cuts.push_back(src.size());
+	}
+	while (cuts.back() < src.size()){
+		size_t at = cuts.back() + CHUNK_BYTES;
+		if (at >= src.size()){
+			at = src.size();
+		} else {
+			const void * lineEnd = memchr(text + at, '\n', src.size() - at);
+			at = lineEnd == nullptr ? src.size() 
+				: static_cast<size_t>(
+				static_cast<const char *>(lineEnd) - text) + 1;
+		}
+		cuts.push_back(at);
+	}
+	size_t count = cuts.size() - 1;
+
+	//Count the lines in each chunk first, so that every 
+	// chunk can be scanned from the right line number
+	std::vector<size_t> firstLines(count + 1, 0);
+	firstLines[0] = 1;
+	workers.concurrently(count, [&](size_t i){
+		firstLines[i + 1] = static_cast<size_t>(
+			std::count(text + cuts[i], text + cuts[i + 1], '\n'));
+	});
+	for (size_t i = 0; i < count; i++){
+		firstLines[i + 1] += firstLines[i];
+	}
+
+	std::vector<Chunk> chunks(count);
+	workers.concurrently(count, [&](size_t i){
+		chunks[i].scan(src, cuts[i], cuts[i + 1], firstLines[i], kind);
+	});
+	workers.flush();
+
+	if (count == 1){
+		entries.swap(chunks[0].entries);
+		notes.swap(chunks[0].notes);
+	}
+	size_t total = 0;
+	for (auto& chunk : chunks){ total += chunk.entries.size(); }
+	entries.reserve(entries.size() + total);
+	for (auto& chunk : chunks){
+		for (auto& note : chunk.notes){
+			notes.push_back(std::make_pair(
+				entries.size() + note.first, std::move(note.second)));
+		}
+		entries.insert(entries.end(), 
+			chunk.entries.begin(), chunk.entries.end());
+	}
+	if (count > 0){
+		endLine = chunks.back().endLine;
+		endCol = chunks.back().endCol;
+	}
+}
+
+void TokenArray::reportBefore(size_t i, size_t& note) const {
+	while (note < notes.size() && notes[note].first == i){
+		Report::err() << notes[note].second;
+		note++;
+	}
+}
+
+void TokenArray::write(std::ostream& out) const {
+	size_t note = 0;
+	for (size_t i = 0; i < entries.size(); i++){
+		reportBefore(i, note);
+		out << entries[i].toString(src) << std::endl;
+	}
+	reportBefore(entries.size(), note);
+	out << "EOF" 
+	  << " [" << endLine 
+	  << "," << endCol << "]"
+	  << std::endl;
+}
+
+}
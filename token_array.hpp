@@ -0,0 +1,94 @@
+#ifndef CMINUSMINUS_TOKEN_ARRAY_HPP
+#define CMINUSMINUS_TOKEN_ARRAY_HPP
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "scanner.hpp"
+#include "source.hpp"
+#include "workers.hpp"
+
+namespace cminusminus{
+
+//Every token of a source file, scanned before parsing
+// starts into one contiguous array of Tokens, which the
+// parser then reads through a TokenReader. So scanning
+// and parsing can be timed apart, and no token is ever
+// allocated on its own.
+//No token can run past the end of its line (a comment
+// stops at the line break, and a string literal can't
+// hold one), so a big file, with a pool to spread it
+// over, is cut into chunks of whole lines that are 
+// scanned side by side, each from the number of the line
+// it starts on. Their tokens are then put one after the
+// other in the array.
+//What the scanner reports is kept with the token it came
+// just before, and only reported once that token is read
+// back (by write() or a TokenReader), so the messages come
+// out where they would if the parser had pulled the tokens
+// from a scanner one at a time.
+class TokenArray{
+public:
+	//Scan src with scanners of the given kind, in chunks
+	// over workers' pool if it is worth it
+	TokenArray(const SourceFile& src, Workers& workers, Lexer::Kind kind);
+	TokenArray(const TokenArray&) = delete;
+	TokenArray& operator=(const TokenArray&) = delete;
+
+	size_t size() const { return entries.size(); }
+
+	//The text of a token (with a string literal's quotes
+	// and escapes)
+	StrRef text(const Token& tok) const {
+		return StrRef(src.data() + tok.offset(), tok.len());
+	}
+
+	//Print the tokens, followed by where the input ends,
+	// as -t does
+	void write(std::ostream& out) const;
+private:
+	friend class TokenReader;
+	class Chunk;
+
+	//Report the messages that came before token i, from
+	// notes[note] on
+	void reportBefore(size_t i, size_t& note) const;
+
+	const SourceFile& src;
+	std::vector<Token> entries;
+	//The messages, in order, each with the index of the
+	// token it came before (size() for the end of the file)
+	std::vector<std::pair<size_t, std::string>> notes;
+	//Where the end of the file is
+	size_t endLine = 1;
+	size_t endCol = 1;
+};
+
+//Hands the tokens of a TokenArray to the parser, in order.
+// Nothing here is virtual, so the parser's calls inline to
+// a bounds check and a pointer into the array.
+class TokenReader{
+public:
+	explicit TokenReader(const TokenArray& tokensIn) : tokens(tokensIn){ }
+
+	int yylex(Parser::semantic_type * const lval){
+		if (note < tokens.notes.size() && tokens.notes[note].first == next){
+			tokens.reportBefore(next, note);
+		}
+		if (next == tokens.entries.size()){ return TokenKind::END; }
+		const Token& tok = tokens.entries[next++];
+		lval->transToken = &tok;
+		return tok.kind();
+	}
+
+	StrRef text(const Token * tok) const { return tokens.text(*tok); }
+private:
+	const TokenArray& tokens;
+	size_t next = 0;
+	size_t note = 0;
+};
+
+}
+
+#endif
@@ -4,7 +4,6 @@
 namespace cminusminus{
 
 using TokenKind = cminusminus::Parser::token;
-using Lexeme = cminusminus::Parser::semantic_type;
 
 static std::string tokenKindString(int tokKind){
 	switch(tokKind){
@@ -57,74 +56,23 @@ static std::string tokenKindString(int tokKind){
 	
 }
 
-Token::Token(Position * posIn, int kindIn)
-  : myPos(posIn), myKind(kindIn){
-}
-
-std::string Token::toString(){
-	return tokenKindString(kind())
-	+ " " + myPos->begin();
-}
-
-int Token::kind() const { 
-	return this->myKind; 
-}
-
-Position * Token::pos() const {
-	return myPos;
-}
-
-IDToken::IDToken(Position * posIn, std::string vIn)
-  : Token(posIn, TokenKind::ID), myValue(vIn){ 
-}
-
-std::string IDToken::toString(){
-	return tokenKindString(kind()) + ":"
-	+ myValue + " " + myPos->begin();
-}
-
-const std::string IDToken::value() const { 
-	return this->myValue; 
-}
-
-StrToken::StrToken(Position * posIn, std::string sIn)
-  : Token(posIn, TokenKind::STRLITERAL), myStr(sIn){
-}
-
-std::string StrToken::toString(){
-	return tokenKindString(kind()) + ":"
-	+ this->myStr + " " + myPos->begin();
-}
-
-const std::string StrToken::str() const {
-	return this->myStr;
-}
-
-IntLitToken::IntLitToken(Position * pos, int numIn)
-  : Token(pos, TokenKind::INTLITERAL), myNum(numIn){}
-
-
-std::string IntLitToken::toString(){
-	return tokenKindString(kind()) + ":"
-	+ std::to_string(this->myNum) + " "
-	+ myPos->begin();
-}
-
-int IntLitToken::num() const {
-	return this->myNum;
-}
-
-ShortLitToken::ShortLitToken(Position * pos, int numIn)
-  : Token(pos, TokenKind::SHORTLITERAL), myNum(numIn){}
-
-std::string ShortLitToken::toString(){
-	return tokenKindString(kind()) + ":"
-	+ std::to_string(this->myNum) + " "
-	+ myPos->begin();
-}
-
-int ShortLitToken::num() const {
-	return this->myNum;
+std::string Token::toString(const SourceFile& src) const {
+	std::string res = tokenKindString(kind());
+	switch (kind()){
+	case TokenKind::ID:
+		res += ":" + Interner::spelling(id());
+		break;
+	case TokenKind::STRLITERAL:
+		res += ":" + StrRef(src.data() + offset(), len()).str();
+		break;
+	case TokenKind::INTLITERAL:
+	case TokenKind::SHORTLITERAL:
+		res += ":" + std::to_string(num());
+		break;
+	default:
+		break;
+	}
+	return res + " " + pos().begin();
 }
 
 } //End namespace cminusminus
@@ -1,60 +1,52 @@
 #ifndef CMINUSMINUS_TOKEN_H
 #define CMINUSMINUS_TOKEN_H
 
+#include <cstdint>
 #include <string>
 #include "position.hpp"
+#include "interner.hpp"
+#include "source.hpp"
 
 namespace cminusminus{
 
+//One token, as a scanner fills it in and the parser reads
+// it: a plain value of 24 bytes, kept in a TokenArray
+// rather than allocated on its own. A token never spans a
+// line, so its place is a line, a column and a length.
+//Its value depends on its kind: the NameID of an ID, the
+// number of an INTLITERAL or SHORTLITERAL, and the offset
+// in the source of a STRLITERAL's text (quotes and 
+// escapes included). Other kinds have none.
 class Token{
 public:
-	Token(Position * pos, int kindIn);
-	virtual std::string toString();
-	size_t line() const;
-	size_t col() const;
-	int kind() const;
-	Position * pos() const;
-protected:
-	Position * myPos;
+	Token() : myValue(0), myLine(0), myCol(0), myLen(0), myKind(0){ }
+	Token(int kindIn, size_t lineIn, size_t colIn, size_t lenIn, 
+		uint64_t valueIn)
+	: myValue(valueIn), myLine(static_cast<uint32_t>(lineIn)),
+	  myCol(static_cast<uint32_t>(colIn)), 
+	  myLen(static_cast<uint32_t>(lenIn)), myKind(kindIn){ }
+
+	int kind() const { return myKind; }
+	size_t line() const { return myLine; }
+	size_t col() const { return myCol; }
+	size_t len() const { return myLen; }
+	Position pos() const {
+		return Position(myLine, myCol, myLine, myCol + myLen);
+	}
+
+	NameID id() const { return static_cast<NameID>(myValue); }
+	int num() const { return static_cast<int>(static_cast<int64_t>(myValue)); }
+	size_t offset() const { return static_cast<size_t>(myValue); }
+
+	//The token as -t prints it. src is the file it was
+	// scanned from.
+	std::string toString(const SourceFile& src) const;
 private:
-	const int myKind;
-};
-
-class IDToken : public Token{
-public:
-	IDToken(Position * posIn, std::string valIn);
-	const std::string value() const;
-	virtual std::string toString() override;
-private:
-	const std::string myValue;
-	
-};
-
-class StrToken : public Token{
-public:
-	StrToken(Position * posIn, std::string valIn);
-	virtual std::string toString() override;
-	const std::string str() const;
-private:
-	const std::string myStr;
-};
-
-class IntLitToken : public Token{
-public:
-	IntLitToken(Position * posIn, int numIn);
-	virtual std::string toString() override;
-	int num() const;
-private:
-	const int myNum;
-};
-
-class ShortLitToken : public Token{
-public:
-	ShortLitToken(Position * posIn, int numIn);
-	virtual std::string toString() override;
-	int num() const;
-private:
-	const int myNum;
+	uint64_t myValue;
+	uint32_t myLine;
+	uint32_t myCol;
+	uint32_t myLen;
+	int myKind;
 };
 
 }
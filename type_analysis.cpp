@@ -2,15 +2,18 @@
 
 #include "name_analysis.hpp"
 #include "type_analysis.hpp"
+#include "workers.hpp"
 
 namespace cminusminus {
 
-TypeAnalysis * TypeAnalysis::build(NameAnalysis * nameAnalysis){
-	TypeAnalysis * typeAnalysis = new TypeAnalysis();
+TypeAnalysis * TypeAnalysis::build(NameAnalysis * nameAnalysis, Workers& workers){
+	//Every node built so far has an index below this
+	TypeAnalysis * typeAnalysis = 
+		new TypeAnalysis(Arena::current()->indicesIssued());
 	auto ast = nameAnalysis->ast;	
 	typeAnalysis->ast = ast;
 
-	ast->typeAnalysis(typeAnalysis);
+	ast->typeAnalysis(typeAnalysis, workers);
 	if (typeAnalysis->hasError){
 		return nullptr;
 	}
@@ -19,9 +22,22 @@ TypeAnalysis * TypeAnalysis::build(NameAnalysis * nameAnalysis){
 
 }
 
-void ProgramNode::typeAnalysis(TypeAnalysis * typing){
-	for (auto decl : *myGlobals){
-		decl->typeAnalysis(typing);
+//The declarations are typed first, so that each function
+// body can then be typed in a view of its own
+void ProgramNode::typeAnalysis(TypeAnalysis * typing, Workers& workers){
+	std::vector<DeclNode *> decls(myGlobals->begin(), myGlobals->end());
+	std::vector<char> passed(decls.size(), true);
+	workers.inOrder(decls.size(), [&](size_t i){
+		decls[i]->typeAnalysis(typing);
+	});
+	workers.concurrently(decls.size(), [&](size_t i){
+		TypeAnalysis bodyTyping(typing);
+		decls[i]->typeAnalysisBody(&bodyTyping);
+		passed[i] = bodyTyping.passed();
+	});
+	workers.flush();
+	for (char bodyPassed : passed){
+		if (!bodyPassed){ typing->markFailed(); }
 	}
 	typing->nodeType(this, BasicType::VOID());
 	typing->nodeIsLVal(this, false);
@@ -47,15 +63,19 @@ void FnDeclNode::typeAnalysis(TypeAnalysis * typing){
 	myRetType->typeAnalysis(typing);
 	const DataType * retDataType = typing->nodeType(myRetType);
 
-	auto formalTypes = new std::list<const DataType *>();
+	std::list<const DataType *> formalTypes;
 	for (auto formal : *myFormals){
 		formal->typeAnalysis(typing);
-		formalTypes->push_back(typing->nodeType(formal));
+		formalTypes.push_back(typing->nodeType(formal));
 	}	
 
-	typing->nodeType(this, new FnType(formalTypes, retDataType));
+	//Function types are flyweights, so this is the same
+	// type that name analysis gave the function's symbol
+	typing->nodeType(this, FnType::produce(formalTypes, retDataType));
 	typing->nodeIsLVal(this, false);
+}
 
+void FnDeclNode::typeAnalysisBody(TypeAnalysis * typing){
 	typing->setCurrentFnType(typing->nodeType(this)->asFn());
 	for (auto stmt : *myBody){
 		stmt->typeAnalysis(typing);
@@ -133,10 +153,8 @@ void AssignExpNode::typeAnalysis(TypeAnalysis * typing){
 void CallExpNode::typeAnalysis(TypeAnalysis * typing){
 	typing->nodeIsLVal(this, false);
 
-	std::list<const DataType *> * aList = new std::list<const DataType *>();
 	for (auto actual : *myArgs){
 		actual->typeAnalysis(typing);
-		aList->push_back(typing->nodeType(actual));
 	}
 
 	SemSymbol * calleeSym = myID->getSymbol();
@@ -150,22 +168,18 @@ void CallExpNode::typeAnalysis(TypeAnalysis * typing){
 	}
 
 	const std::list<const DataType *>* fList = fnType->getFormalTypes();
-	if (aList->size() != fList->size()){
+	if (myArgs->size() != fList->size()){
 		typing->errArgCount(pos());
 		//Note: we still consider the call to return the 
 		// return type
 	} else {
-		auto actualTypesItr = aList->begin();
 		auto formalTypesItr = fList->begin();
-		auto actualsItr = myArgs->begin();
-		while(actualTypesItr != aList->end()){
-			const DataType * actualType = *actualTypesItr;
-			const DataType * formalType = *formalTypesItr;
+		for (auto actualsItr = myArgs->begin(); 
+			actualsItr != myArgs->end(); actualsItr++){
 			ExpNode * actual = *actualsItr;
-			auto actualsItrOld = actualsItr;
-			actualTypesItr++;
+			const DataType * actualType = typing->nodeType(actual);
+			const DataType * formalType = *formalTypesItr;
 			formalTypesItr++;
-			actualsItr++;
 
 			//Matching to error is ignored
 			if (actualType->asError()){ continue; }
@@ -180,9 +194,7 @@ void CallExpNode::typeAnalysis(TypeAnalysis * typing){
 				ShortToIntNode * up;
 				up = new ShortToIntNode(actual->pos(), actual);
 				typing->nodeType(up, BasicType::INT());
-				
-				actualsItrOld = myArgs->erase(actualsItrOld);
-				actualsItrOld = myArgs->insert(actualsItrOld, up);
+				*actualsItr = up;
 				
 				continue;
 			}
@@ -1,6 +1,9 @@
 #ifndef CMINUSMINUS_TYPE_ANALYSIS
 #define CMINUSMINUS_TYPE_ANALYSIS
 
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "ast.hpp"
 #include "symbol_table.hpp"
 #include "types.hpp"
@@ -11,23 +14,33 @@ namespace cminusminus{
 
 // An instance of this class will be passed over the entire
 // AST. Rather than attaching types to each node, the 
-// TypeAnalysis class contains a map from each ASTNode to it's
+// TypeAnalysis class contains a table from each ASTNode to it's
 // DataType. Thus, instead of attaching a type field to most nodes,
 // one can instead map the node to it's type, or lookup the node
-// in the map.
+// in the table. The table is a flat vector indexed by the
+// node's dense index.
 class TypeAnalysis {
 
 private:
 	//The private constructor here means that the type analysis
 	// can only be created via the static build function
-	TypeAnalysis(){
+	TypeAnalysis(size_t numNodes) 
+	: ownTable(new Table(numNodes)), table(ownTable.get()){
 		hasError = false;
 	}
 
 public:
-	static TypeAnalysis * build(NameAnalysis * astRoot);
+	static TypeAnalysis * build(NameAnalysis * astRoot, Workers& workers);
 	//static TypeAnalysis * build();
 
+	//A view of whole for typing one function body, so that
+	// bodies can be typed concurrently: it fills in whole's
+	// table, but has its own current function and error
+	// flag (see markFailed)
+	explicit TypeAnalysis(TypeAnalysis * whole)
+	: table(whole->table), currentFnType(nullptr), hasError(false),
+	  ast(whole->ast){ }
+
 	//The type analysis has an instance variable to say whether
 	// the analysis failed or not. Setting this variable is much
 	// less of a pain than passing a boolean all the way up to the
@@ -35,6 +48,11 @@ public:
 	bool passed(){
 		return !hasError;
 	}
+	//Fail the analysis for the sake of a body typed in a
+	// view of its own
+	void markFailed(){
+		hasError = true;
+	}
 
 	void setCurrentFnType(const FnType * type){
 		currentFnType = type;
@@ -47,164 +65,202 @@ public:
 	
 	//Set the type of a node. Note that the function name is 
 	// overloaded: this 2-argument nodeType puts a value into the
-	// map with a given type. 
+	// table with a given type. 
 	void nodeType(const ASTNode * node, const DataType * type){
-		nodeToType[node] = type;
+		size_t idx = node->index();
+		if (idx < table->types.size()){
+			table->types[idx] = type;
+			return;
+		}
+		std::lock_guard<std::mutex> hold(table->lateLock);
+		table->late[idx].first = type;
 	}
 
 	void nodeIsLVal(const ASTNode * node, bool isLVal){
-		nodeLVal[node] = isLVal;
+		size_t idx = node->index();
+		if (idx < table->lvals.size()){
+			table->lvals[idx] = isLVal;
+			return;
+		}
+		std::lock_guard<std::mutex> hold(table->lateLock);
+		table->late[idx].second = isLVal;
 	}
 
-	//Gets the type of a node already placed in the map. Note
+	//Gets the type of a node already placed in the table. Note
 	// that this function name is overloaded: the 1-argument nodeType
-	// gets the type of the given node out of the map.
+	// gets the type of the given node out of the table.
 	const DataType * nodeType(const ASTNode * node){
-		auto res = nodeToType.find(node);
-		assert(res != nodeToType.end() || "No type for node");
-		
+		size_t idx = node->index();
 		//Note: this actually could be nullptr
-		return res->second;
+		if (idx < table->types.size()){ return table->types[idx]; }
+
+		std::lock_guard<std::mutex> hold(table->lateLock);
+		auto found = table->late.find(idx);
+		assert(found != table->late.end() && "No type for node");
+		return found->second.first;
 	}
 
 	bool nodeIsLVal(const ASTNode * node){
-		return nodeLVal[node];
+		size_t idx = node->index();
+		if (idx < table->lvals.size()){ return table->lvals[idx]; }
+
+		std::lock_guard<std::mutex> hold(table->lateLock);
+		auto found = table->late.find(idx);
+		if (found == table->late.end()){ return false; }
+		return found->second.second;
 	}
 
 	//The following functions all report and error and 
 	// tell the object that the analysis has failed. 
-	void errWriteFn(Position * pos){
+	void errWriteFn(const Position& pos){
 		hasError = true;
 		Report::fatal(pos,
 			"Attempt to output a function");
 	}
-	void errWriteVoid(Position * pos){
+	void errWriteVoid(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Attempt to write void");
 	}
-	void errAssignFn(Position * pos){
+	void errAssignFn(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, "Attempt to assign user input to function");
 	}
 
-	void errReadFn(Position * pos){
+	void errReadFn(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Attempt to assign user input to function");
 	}
-	void errCallee(Position * pos){
+	void errCallee(const Position& pos){
 		hasError = true;
 		Report::fatal(pos,
 			"Attempt to call a "
 			"non-function");
 	}
-	void errArgCount(Position * pos){
+	void errArgCount(const Position& pos){
 		hasError = true;
 		Report::fatal(pos,
 			"Function call with wrong"
 			" number of args");
 	}
-	void errArgMatch(Position * pos){
+	void errArgMatch(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Type of actual does not match"
 			" type of formal");
 	}
-	void errRetEmpty(Position * pos){
+	void errRetEmpty(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Missing return value");
 	}
-	void extraRetValue(Position * pos){
+	void extraRetValue(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Return with a value in void"
 			" function");
 	}
-	void errRetWrong(Position * pos){
+	void errRetWrong(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Bad return value");
 	}
-	void errMathOpd(Position * pos){
+	void errMathOpd(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Arithmetic operator applied"
 			" to invalid operand");
 	}
-	void errRelOpd(Position * pos){
+	void errRelOpd(const Position& pos){
 		hasError = true;
 		Report::fatal(pos,
 			"Relational operator applied to"
 			" non-numeric operand");
 	}
-	void errLogicOpd(Position * pos){
+	void errLogicOpd(const Position& pos){
 		hasError = true;
 		Report::fatal(pos,
 			"Logical operator applied to"
 			" non-bool operand");
 	}
-	void errIfCond(Position * pos){
+	void errIfCond(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Non-bool expression used as"
 			" an if condition");
 	}
-	void errWhileCond(Position * pos){
+	void errWhileCond(const Position& pos){
 		hasError = true;
 		Report::fatal(pos,
 			"Non-bool expression used as"
 			" a while condition");
 	}
-	void errEqOpd(Position * pos){
+	void errEqOpd(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Invalid equality operand");
 	}
-	void errEqOpr(Position * pos){
+	void errEqOpr(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Invalid equality operation");
 	}
-	void errNotLVal(Position * pos){
+	void errNotLVal(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Non-Lval assignment");
 	}
-	void errAssignOpd(Position * pos){
+	void errAssignOpd(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Invalid assignment operand");
 	}
-	void errAssignOpr(Position * pos){
+	void errAssignOpr(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Invalid assignment operation");
 	}
-	void errWritePtr(Position * pos){
+	void errWritePtr(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Attempt to write a raw pointer");
 	}
-	void errReadPtr(Position * pos){
+	void errReadPtr(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Attempt to read a raw pointer");
 	}
-	void errDerefOpd(Position * pos){
+	void errDerefOpd(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Invalid operand for dereference");
 	}
-	void errRefOpd(Position * pos){
+	void errRefOpd(const Position& pos){
 		hasError = true;
 		Report::fatal(pos, 
 			"Invalid ref operand");
 	}
 private:
-	HashMap<const ASTNode *, const DataType *> nodeToType;
-	HashMap<const ASTNode *, bool> nodeLVal;
+	//The types of the nodes, shared by every view of the
+	// analysis. Each node that existed when the analysis
+	// began has an entry in the vectors, which threads
+	// typing different bodies fill in side by side (so the
+	// flags are bytes, not a bit-packed vector<bool>).
+	// Nodes built during the analysis itself (e.g.
+	// promotions) are past the end, and kept behind a lock.
+	class Table{
+	public:
+		Table(size_t numNodes) 
+		: types(numNodes, nullptr), lvals(numNodes, false){ }
+		std::vector<const DataType *> types;
+		std::vector<uint8_t> lvals;
+		std::mutex lateLock;
+		HashMap<size_t, std::pair<const DataType *, bool>> late;
+	};
+
+	std::unique_ptr<Table> ownTable;
+	Table * table;
 	const FnType * currentFnType;
 	bool hasError;
 public:
@@ -1,11 +1,50 @@
 #include <list>
 #include <sstream>
+#include <vector>
 
 #include "types.hpp"
 #include "ast.hpp"
 
 namespace cminusminus{
 
+//A function signature, as its return type followed by its
+// formal types. Since the component types are flyweights,
+// the signature can be hashed and compared by pointer.
+using FnSig = std::vector<const DataType *>;
+struct FnSigHash{
+	size_t operator()(const FnSig& sig) const {
+		size_t h = sig.size();
+		for (const DataType * part : sig){
+			h ^= std::hash<const DataType *>()(part) 
+				+ 0x9e3779b9 + (h << 6) + (h >> 2);
+		}
+		return h;
+	}
+};
+
+FnType * FnType::produce(
+	const std::list<const DataType *>& formals, 
+	const DataType * retType
+){
+	static std::unordered_map<FnSig, FnType *, FnSigHash> map;
+	static std::mutex lock;
+
+	FnSig sig;
+	sig.reserve(formals.size() + 1);
+	sig.push_back(retType);
+	sig.insert(sig.end(), formals.begin(), formals.end());
+
+	std::lock_guard<std::mutex> hold(lock);
+	auto res = map.find(sig);
+	if (res != map.end()){
+		return res->second;
+	}
+	auto formalsCopy = new std::list<const DataType *>(formals);
+	FnType * fnType = new FnType(formalsCopy, retType);
+	map[sig] = fnType;
+	return fnType;
+}
+
 std::string BasicType::getString() const{
 	std::string res = "";
 	switch(myBaseType){
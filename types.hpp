@@ -2,6 +2,7 @@
 #define CMINUSMINUS_DATA_TYPES
 
 #include <list>
+#include <mutex>
 #include <sstream>
 #include "errors.hpp"
 
@@ -97,15 +98,17 @@ public:
 		return produce(BaseType::SHORT);
 	}
 
-	//Create a scalar type. If that type already exists,
-	// return the known instance of that type. Making sure
+	//Get the scalar type for base. There is only ever
+	// one instance of each base type. Making sure
 	// there is only 1 instance of a class for a given set
 	// of fields is known as the "flyweight" design pattern
 	// and ensures that the memory needs of a program are kept
 	// down: rather than having a distinct type for every base
 	// INT (for example), only one is constructed and kept in
-	// the flyweights list. That type is then re-used anywhere
-	// it's needed. 
+	// the flyweights table. That type is then re-used anywhere
+	// it's needed. Since the set of base types is fixed, all
+	// of them are built up front and the table is indexed
+	// directly by the BaseType.
 
 	//Note the use of the static function declaration, which 
 	// means that no instance of BasicType is needed to call
@@ -116,15 +119,14 @@ public:
 		// multiple calls to this function (it is essentially
 		// a global variable that can only be accessed
 		// in this function).
-		static std::list<BasicType *> flyweights;
-		for(BasicType * fly : flyweights){
-			if (fly->getBaseType() == base){
-				return fly;
-			}
-		}
-		BasicType * newType = new BasicType(base);
-		flyweights.push_back(newType);
-		return newType;
+		static BasicType * const flyweights[] = {
+			new BasicType(BaseType::INT),
+			new BasicType(BaseType::VOID),
+			new BasicType(BaseType::STRING),
+			new BasicType(BaseType::BOOL),
+			new BasicType(BaseType::SHORT),
+		};
+		return flyweights[base];
 	}
 	const BasicType * asBasic() const override {
 		return this;
@@ -169,6 +171,9 @@ class PtrType : public DataType{
 public:
 	static PtrType * produce(const DataType * baseType){
 		static HashMap <const DataType *, PtrType *> map;
+		//Several files may be compiled at once (cmmc --batch)
+		static std::mutex lock;
+		std::lock_guard<std::mutex> hold(lock);
 
 		auto res = map.find(baseType);
 		if (res == map.end()){
@@ -193,15 +198,15 @@ private:
 };
 
 //DataType subclass to represent the type of a function. It will
-// have a list of argument types and a return type. 
+// have a list of argument types and a return type. Like the
+// other types, function types are flyweights: there is one
+// instance per signature, so two function types are equal
+// exactly when they are the same object.
 class FnType : public DataType{
 public:
-	FnType(const std::list<const DataType *>* formalsIn, const DataType * retTypeIn) 
-	: DataType(),
-	  myFormalTypes(formalsIn),
-	  myRetType(retTypeIn)
-	{
-	}
+	static FnType * produce(
+		const std::list<const DataType *>& formals, 
+		const DataType * retType);
 	std::string getString() const override{
 		std::string result = "";
 		bool first = true;
@@ -228,6 +233,12 @@ public:
 	virtual bool validVarType() const override { return false; }
 	virtual size_t getSize() const override { return 0; }
 private:
+	FnType(const std::list<const DataType *>* formalsIn, const DataType * retTypeIn) 
+	: DataType(),
+	  myFormalTypes(formalsIn),
+	  myRetType(retTypeIn)
+	{
+	}
 	const std::list<const DataType *> * myFormalTypes;
 	const DataType * myRetType;
 };
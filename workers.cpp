@@ -0,0 +1,65 @@
+#include <sstream>
+#include "workers.hpp"
+#include "errors.hpp"
+
+namespace cminusminus{
+
+void Workers::logged(size_t i, const std::function<void(size_t)>& fn){
+	std::ostringstream log;
+	{
+		Report::Redirect redirect(&log);
+		fn(i);
+	}
+	logs[i] += log.str();
+}
+
+void Workers::inOrder(size_t count, const std::function<void(size_t)>& fn){
+	if (logs.size() < count){ logs.resize(count); }
+	for (size_t i = 0; i < count; i++){
+		logged(i, fn);
+	}
+}
+
+void Workers::concurrently(size_t count, const std::function<void(size_t)>& fn){
+	if (pool == nullptr || pool->size() == 1){
+		inOrder(count, fn);
+		return;
+	}
+	if (logs.size() < count){ logs.resize(count); }
+	pool->forEach(count, [&](size_t i){
+		Arena * arena = takeArena();
+		Arena::Scope scope(arena);
+		try {
+			logged(i, fn);
+		} catch (...){
+			giveArena(arena);
+			throw;
+		}
+		giveArena(arena);
+	});
+}
+
+void Workers::flush(){
+	for (auto& log : logs){
+		Report::err() << log;
+	}
+	logs.clear();
+}
+
+Arena * Workers::takeArena(){
+	std::lock_guard<std::mutex> hold(arenaLock);
+	if (idle.empty()){
+		arenas.emplace_back(new Arena(main));
+		return arenas.back().get();
+	}
+	Arena * arena = idle.back();
+	idle.pop_back();
+	return arena;
+}
+
+void Workers::giveArena(Arena * arena){
+	std::lock_guard<std::mutex> hold(arenaLock);
+	idle.push_back(arena);
+}
+
+}
@@ -0,0 +1,62 @@
+#ifndef CMINUSMINUS_WORKERS_HPP
+#define CMINUSMINUS_WORKERS_HPP
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "arena.hpp"
+#include "pool.hpp"
+
+namespace cminusminus{
+
+//Runs the per-declaration steps of a compilation's passes
+// (see ProgramNode), either in order on the calling thread
+// or spread over a WorkPool.
+//Whichever way a step is run, the messages it reports
+// are held back, and flush() prints them grouped by
+// declaration, in declaration order. So a pass reports
+// exactly what it would if it had gone through the
+// declarations one at a time, however many threads ran it.
+class Workers{
+public:
+	//Objects built by steps run concurrently live in
+	// arenas of their own, which last as long as main
+	Workers(Arena * mainIn) : main(mainIn){ }
+	Workers(const Workers&) = delete;
+	Workers& operator=(const Workers&) = delete;
+
+	//With no pool (the default), every step runs in order
+	// on the calling thread
+	void setPool(WorkPool * poolIn){ pool = poolIn; }
+	//Whether concurrently() can use more than one thread
+	bool parallel() const { return pool != nullptr && pool->size() > 1; }
+
+	//Call fn(i) for each i below count, in order, on this
+	// thread
+	void inOrder(size_t count, const std::function<void(size_t)>& fn);
+	//Call fn(i) for each i below count, spread over the
+	// pool, and return once all have finished
+	void concurrently(size_t count, const std::function<void(size_t)>& fn);
+	//Print the messages held back since the last flush
+	void flush();
+private:
+	void logged(size_t i, const std::function<void(size_t)>& fn);
+	Arena * takeArena();
+	void giveArena(Arena * arena);
+
+	Arena * main;
+	WorkPool * pool = nullptr;
+	//The messages for each declaration
+	std::vector<std::string> logs;
+
+	std::mutex arenaLock;
+	std::vector<std::unique_ptr<Arena>> arenas;
+	//The arenas no step is building in right now
+	std::vector<Arena *> idle;
+};
+
+}
+
+#endif
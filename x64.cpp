@@ -0,0 +1,975 @@
+#include <algorithm>
+#include <cstdint>
+#include "3ac.hpp"
+#include "cfg.hpp"
+#include "liveness.hpp"
+
+//Lowering the 3AC to x86-64 assembly, in GNU syntax and
+// following the System V ABI.
+//
+//Every value is 8 bytes wide. Temps, address temps and the
+// locals and formals whose address is never taken are
+// given registers by a linear scan allocator (Poletto and
+// Sarkar) over live intervals built from the CFG's
+// liveness sets, or a frame slot once the registers run
+// out. Locals whose address is taken live in the frame,
+// and globals in .bss.
+//%rax, %rdx, %r10 and %r11 are never allocated: they are
+// scratch for the instructions that need a register (and
+// division needs %rax and %rdx). A value that is live
+// across a call (including write and read, which call the
+// runtime) can only get a callee-saved register.
+//On entry a procedure copies its register arguments into
+// its frame, next to the ones the caller passed on the
+// stack, so a getarg is just a load and the formal of an
+// address-taken argument can live where it was passed.
+
+namespace cminusminus{
+
+static const size_t NO_REG = static_cast<size_t>(-1);
+//The caller-saved registers the allocator hands out come
+// first, then the callee-saved ones
+static const char * const REGS[] = {
+	"%rcx", "%rsi", "%rdi", "%r8", "%r9",
+	"%rbx", "%r12", "%r13", "%r14", "%r15"
+};
+static const size_t NUM_REGS = 10;
+static const size_t FIRST_CALLEE_SAVED = 5;
+static const char * const ARG_REGS[] = {
+	"%rdi", "%rsi", "%rdx", "%rcx", "%r8", "%r9"
+};
+static const size_t NUM_ARG_REGS = 6;
+
+//A small runtime for write and read. Output is kept in a
+// buffer until it fills up or main returns; input is read
+// a buffer at a time. Both go straight to the kernel, so
+// the program doesn't depend on stdio. A string is read
+// as one word, and kept past the end of the program's
+// data, which grows with brk.
+static const char * const RUNTIME =
+	"\t.text\n"
+	"__cmm_flush:\n"
+	"\tleaq __cmm_outbuf(%rip), %rsi\n"
+	"\tmovq __cmm_outlen(%rip), %rdx\n"
+	"1:\ttestq %rdx, %rdx\n"
+	"\tjle 2f\n"
+	"\tmovl $1, %eax\n"
+	"\tmovl $1, %edi\n"
+	"\tsyscall\n"
+	"\ttestq %rax, %rax\n"
+	"\tjle 2f\n"
+	"\taddq %rax, %rsi\n"
+	"\tsubq %rax, %rdx\n"
+	"\tjmp 1b\n"
+	"2:\tmovq $0, __cmm_outlen(%rip)\n"
+	"\tret\n"
+	"__cmm_write_str:\n"
+	"\tpushq %rbx\n"
+	"\tmovq %rdi, %rbx\n"
+	"1:\tcmpq $4096, __cmm_outlen(%rip)\n"
+	"\tjb 2f\n"
+	"\tcall __cmm_flush\n"
+	"2:\tmovzbl (%rbx), %eax\n"
+	"\ttestb %al, %al\n"
+	"\tje 3f\n"
+	"\tmovq __cmm_outlen(%rip), %rcx\n"
+	"\tleaq __cmm_outbuf(%rip), %rdx\n"
+	"\tmovb %al, (%rdx,%rcx)\n"
+	"\tincq %rcx\n"
+	"\tmovq %rcx, __cmm_outlen(%rip)\n"
+	"\tincq %rbx\n"
+	"\tjmp 1b\n"
+	"3:\tpopq %rbx\n"
+	"\tret\n"
+	"__cmm_write_int:\n"
+	"\tsubq $40, %rsp\n"
+	"\tmovq %rdi, %rax\n"
+	"\tmovq %rdi, %r8\n"
+	"\tleaq 32(%rsp), %rsi\n"
+	"\ttestq %rax, %rax\n"
+	"\tjns 1f\n"
+	"\tnegq %rax\n"
+	"1:\tmovl $10, %ecx\n"
+	"2:\txorl %edx, %edx\n"
+	"\tdivq %rcx\n"
+	"\taddb $48, %dl\n"
+	"\tdecq %rsi\n"
+	"\tmovb %dl, (%rsi)\n"
+	"\ttestq %rax, %rax\n"
+	"\tjne 2b\n"
+	"\ttestq %r8, %r8\n"
+	"\tjns 3f\n"
+	"\tdecq %rsi\n"
+	"\tmovb $45, (%rsi)\n"
+	"3:\tmovq __cmm_outlen(%rip), %rcx\n"
+	"\tcmpq $4072, %rcx\n"
+	"\tjbe 4f\n"
+	"\tmovq %rsi, (%rsp)\n"
+	"\tcall __cmm_flush\n"
+	"\tmovq (%rsp), %rsi\n"
+	"\txorl %ecx, %ecx\n"
+	"4:\tleaq __cmm_outbuf(%rip), %rdx\n"
+	"\tleaq 32(%rsp), %r9\n"
+	"5:\tmovb (%rsi), %al\n"
+	"\tmovb %al, (%rdx,%rcx)\n"
+	"\tincq %rcx\n"
+	"\tincq %rsi\n"
+	"\tcmpq %r9, %rsi\n"
+	"\tjb 5b\n"
+	"\tmovq %rcx, __cmm_outlen(%rip)\n"
+	"\taddq $40, %rsp\n"
+	"\tret\n"
+	"__cmm_getc:\n"
+	"\tmovq __cmm_inpos(%rip), %rcx\n"
+	"\tcmpq __cmm_inlen(%rip), %rcx\n"
+	"\tjb 1f\n"
+	"\txorl %eax, %eax\n"
+	"\txorl %edi, %edi\n"
+	"\tleaq __cmm_inbuf(%rip), %rsi\n"
+	"\tmovl $4096, %edx\n"
+	"\tsyscall\n"
+	"\ttestq %rax, %rax\n"
+	"\tjle 2f\n"
+	"\tmovq %rax, __cmm_inlen(%rip)\n"
+	"\txorl %ecx, %ecx\n"
+	"1:\tleaq __cmm_inbuf(%rip), %rdx\n"
+	"\tmovzbl (%rdx,%rcx), %eax\n"
+	"\tincq %rcx\n"
+	"\tmovq %rcx, __cmm_inpos(%rip)\n"
+	"\tret\n"
+	"2:\tmovq $0, __cmm_inlen(%rip)\n"
+	"\tmovq $0, __cmm_inpos(%rip)\n"
+	"\tmovq $-1, %rax\n"
+	"\tret\n"
+	"__cmm_read_int:\n"
+	"\tpushq %rbx\n"
+	"\tpushq %r12\n"
+	"\tsubq $8, %rsp\n"
+	"\tcall __cmm_flush\n"
+	"1:\tcall __cmm_getc\n"
+	"\tcmpl $32, %eax\n"
+	"\tje 1b\n"
+	"\tcmpl $9, %eax\n"
+	"\tjb 2f\n"
+	"\tcmpl $13, %eax\n"
+	"\tjbe 1b\n"
+	"2:\txorl %r12d, %r12d\n"
+	"\tcmpl $45, %eax\n"
+	"\tjne 3f\n"
+	"\tmovl $1, %r12d\n"
+	"\tcall __cmm_getc\n"
+	"3:\txorl %ebx, %ebx\n"
+	"4:\tsubl $48, %eax\n"
+	"\tcmpl $9, %eax\n"
+	"\tja 5f\n"
+	"\timulq $10, %rbx\n"
+	"\taddq %rax, %rbx\n"
+	"\tcall __cmm_getc\n"
+	"\tjmp 4b\n"
+	"5:\tmovq __cmm_inpos(%rip), %rcx\n"
+	"\ttestq %rcx, %rcx\n"
+	"\tje 6f\n"
+	"\tdecq %rcx\n"
+	"\tmovq %rcx, __cmm_inpos(%rip)\n"
+	"6:\tmovq %rbx, %rax\n"
+	"\ttestl %r12d, %r12d\n"
+	"\tje 7f\n"
+	"\tnegq %rax\n"
+	"7:\taddq $8, %rsp\n"
+	"\tpopq %r12\n"
+	"\tpopq %rbx\n"
+	"\tret\n"
+	"__cmm_read_str:\n"
+	"\tpushq %rbx\n"
+	"\tpushq %r12\n"
+	"\tpushq %r13\n"
+	"\tcall __cmm_flush\n"
+	"\tcmpq $0, __cmm_strend(%rip)\n"
+	"\tjne 1f\n"
+	"\tmovl $12, %eax\n"
+	"\txorl %edi, %edi\n"
+	"\tsyscall\n"
+	"\tmovq %rax, __cmm_strtop(%rip)\n"
+	"\tmovq %rax, __cmm_strend(%rip)\n"
+	"1:\tcall __cmm_getc\n"
+	"\tcmpl $32, %eax\n"
+	"\tje 1b\n"
+	"\tcmpl $9, %eax\n"
+	"\tjb 2f\n"
+	"\tcmpl $13, %eax\n"
+	"\tjbe 1b\n"
+	"2:\tmovq __cmm_strtop(%rip), %r12\n"
+	"\tmovq %r12, %rbx\n"
+	"\tmovl %eax, %r13d\n"
+	"3:\tleaq 1(%rbx), %rax\n"
+	"\tcmpq __cmm_strend(%rip), %rax\n"
+	"\tjb 4f\n"
+	"\tmovq __cmm_strend(%rip), %rdi\n"
+	"\taddq $4096, %rdi\n"
+	"\tmovl $12, %eax\n"
+	"\tsyscall\n"
+	"\tcmpq %rdi, %rax\n"
+	"\tjb 8f\n"
+	"\tmovq %rax, __cmm_strend(%rip)\n"
+	"4:\tcmpl $-1, %r13d\n"
+	"\tje 6f\n"
+	"\tcmpl $32, %r13d\n"
+	"\tje 5f\n"
+	"\tcmpl $9, %r13d\n"
+	"\tjb 7f\n"
+	"\tcmpl $13, %r13d\n"
+	"\tjbe 5f\n"
+	"7:\tmovb %r13b, (%rbx)\n"
+	"\tincq %rbx\n"
+	"\tcall __cmm_getc\n"
+	"\tmovl %eax, %r13d\n"
+	"\tjmp 3b\n"
+	"5:\tdecq __cmm_inpos(%rip)\n"
+	"6:\tmovb $0, (%rbx)\n"
+	"\tincq %rbx\n"
+	"\tmovq %rbx, __cmm_strtop(%rip)\n"
+	"\tmovq %r12, %rax\n"
+	"\tpopq %r13\n"
+	"\tpopq %r12\n"
+	"\tpopq %rbx\n"
+	"\tret\n"
+	"8:\tmovl $60, %eax\n"
+	"\tmovl $1, %edi\n"
+	"\tsyscall\n"
+	"\t.bss\n"
+	"\t.align 8\n"
+	"__cmm_outlen:\n"
+	"\t.zero 8\n"
+	"__cmm_inpos:\n"
+	"\t.zero 8\n"
+	"__cmm_inlen:\n"
+	"\t.zero 8\n"
+	"__cmm_strtop:\n"
+	"\t.zero 8\n"
+	"__cmm_strend:\n"
+	"\t.zero 8\n"
+	"__cmm_outbuf:\n"
+	"\t.zero 4096\n"
+	"__cmm_inbuf:\n"
+	"\t.zero 4096\n";
+
+static std::string funName(const std::string& name){
+	return "fun_" + name;
+}
+
+static std::string labelName(Label * lbl){
+	return ".L" + lbl->getName();
+}
+
+static bool isVar(OpdKind kind){
+	return kind == SYM_OPD || kind == AUX_OPD || kind == ADDR_OPD;
+}
+
+static bool isCall(const Quad& quad){
+	return quad.kind == CALL_QUAD || quad.kind == REPORT_QUAD
+		|| quad.kind == RECEIVE_QUAD;
+}
+
+//Where a value has to be kept: a sorted list of disjoint
+// ranges of positions, with holes where it is dead. Each
+// quad has two positions; its operands are read at 2i and
+// its result is written at 2i + 1.
+class LiveInterval{
+public:
+	OpdID opd;
+	std::vector<std::pair<size_t, size_t>> ranges;
+	bool acrossCall = false;
+	size_t reg = NO_REG;
+
+	size_t start() const { return ranges.front().first; }
+	size_t end() const { return ranges.back().second; }
+	bool covers(size_t pos) const {
+		auto after = std::upper_bound(ranges.begin(), ranges.end(),
+			std::make_pair(pos, static_cast<size_t>(-1)));
+		return after != ranges.begin() && std::prev(after)->second >= pos;
+	}
+	bool intersects(const LiveInterval& other) const {
+		size_t i = 0;
+		size_t j = 0;
+		while (i < ranges.size() && j < other.ranges.size()){
+			if (ranges[i].second < other.ranges[j].first){ i++; }
+			else if (other.ranges[j].second < ranges[i].first){ j++; }
+			else { return true; }
+		}
+		return false;
+	}
+};
+
+class X64Lowering{
+public:
+	X64Lowering(std::ostream& outIn, Procedure * procIn,
+		const std::set<Opd *>& globalsIn)
+	: out(outIn), proc(procIn), quads(procIn->getQuads()),
+	  global(procIn->numOpds()), addrTaken(procIn->numOpds()),
+	  locs(procIn->numOpds()), framed(procIn->numOpds()){
+		for (OpdID id = 0; id < proc->numOpds(); id++){
+			global[id] = globalsIn.count(proc->opd(id)) > 0;
+		}
+	}
+	void lower();
+private:
+	void allocate();
+	void layoutFrame();
+	void lowerQuad(size_t i);
+	void lowerCall(const Quad& call);
+	void lowerBinOp(const Quad& quad);
+
+	void emit(const std::string& instr){ out << "\t" << instr << "\n"; }
+	std::string slot(size_t idx){
+		return std::to_string(-8 * static_cast<long>(saved.size() + idx + 1))
+			+ "(%rbp)";
+	}
+	std::string argSlot(size_t index);
+	std::string loc(OpdID opd);
+	bool inReg(OpdID opd, const std::string& reg){
+		return opd != NO_OPD && isVar(proc->kindOf(opd)) && loc(opd) == reg;
+	}
+	std::string src(OpdID opd, const std::string& scratch);
+	void load(OpdID opd, const std::string& reg);
+	void store(const std::string& val, OpdID dst);
+	std::string workReg(OpdID dst, OpdID other);
+	void toFrame(OpdID opd){
+		if (!framed[opd]){
+			framed[opd] = true;
+			inFrame.push_back(opd);
+		}
+	}
+
+	std::ostream& out;
+	Procedure * proc;
+	std::vector<Quad>& quads;
+	//Which operands are globals or have their address
+	// taken, and where each value lives, by operand
+	std::vector<bool> global;
+	std::vector<bool> addrTaken;
+	std::vector<std::string> locs;
+	//The values kept in the frame, in the order they were
+	// first seen
+	std::vector<OpdID> inFrame;
+	std::vector<bool> framed;
+	size_t numSlots = 0;
+	size_t numArgs = 0;
+	std::vector<size_t> saved;
+	std::vector<OpdID> args;
+};
+
+std::string X64Lowering::argSlot(size_t index){
+	if (index <= NUM_ARG_REGS){ return slot(index - 1); }
+	return std::to_string(16 + 8 * (index - NUM_ARG_REGS - 1)) + "(%rbp)";
+}
+
+std::string X64Lowering::loc(OpdID opd){
+	if (global[opd]){
+		return "gbl_" + static_cast<SymOpd *>(proc->opd(opd))->getName()
+			+ "(%rip)";
+	}
+	if (locs[opd].empty()){
+		throw new InternalError(
+			("No location for " + proc->opd(opd)->valString()).c_str());
+	}
+	return locs[opd];
+}
+
+//An operand for one instruction that reads opd's value,
+// loading it into scratch first if it can't be used as is.
+// An AddrOpd is read through the pointer it holds.
+std::string X64Lowering::src(OpdID opd, const std::string& scratch){
+	OpdKind kind = proc->kindOf(opd);
+	if (kind == LIT_OPD){
+		int64_t val = proc->litVal(opd);
+		if (val >= INT32_MIN && val <= INT32_MAX){
+			return "$" + std::to_string(val);
+		}
+		emit("movabsq $" + std::to_string(val) + ", " + scratch);
+		return scratch;
+	}
+	if (kind == STRING_OPD){
+		auto str = static_cast<StringOpd *>(proc->opd(opd));
+		emit("leaq .L" + str->getName() + "(%rip), " + scratch);
+		return scratch;
+	}
+	std::string res = loc(opd);
+	if (kind == ADDR_OPD){
+		if (res[0] != '%'){
+			emit("movq " + res + ", " + scratch);
+			res = scratch;
+		}
+		return "(" + res + ")";
+	}
+	return res;
+}
+
+void X64Lowering::load(OpdID opd, const std::string& reg){
+	std::string val = src(opd, reg);
+	if (val != reg){ emit("movq " + val + ", " + reg); }
+}
+
+//Write val (a register or an immediate) to dst, or through
+// it if dst is an AddrOpd
+void X64Lowering::store(const std::string& val, OpdID dst){
+	std::string tgt = loc(dst);
+	if (proc->kindOf(dst) == ADDR_OPD){
+		if (tgt[0] != '%'){
+			emit("movq " + tgt + ", %r11");
+			tgt = "%r11";
+		}
+		tgt = "(" + tgt + ")";
+	}
+	if (val != tgt){ emit("movq " + val + ", " + tgt); }
+}
+
+//The register to compute dst's new value in: dst's own
+// register if it has one that other doesn't need
+std::string X64Lowering::workReg(OpdID dst, OpdID other){
+	if (proc->kindOf(dst) == ADDR_OPD){ return "%rax"; }
+	std::string tgt = loc(dst);
+	if (tgt[0] != '%'){ return "%rax"; }
+	if (inReg(other, tgt)){ return "%rax"; }
+	return tgt;
+}
+
+void X64Lowering::allocate(){
+	std::vector<OpdID> tracked;
+	std::vector<bool> seen(proc->numOpds());
+	for (auto& quad : quads){
+		if (quad.kind == LOC_QUAD){
+			if (quad.srcIsLoc()){ addrTaken[quad.src1] = true; }
+			if (quad.tgtIsLoc() && proc->kindOf(quad.dst) == SYM_OPD){
+				addrTaken[quad.dst] = true;
+			}
+		}
+	}
+	for (auto& quad : quads){
+		if (quad.kind == PHI_QUAD){
+			throw new InternalError("Can't lower a procedure in SSA form");
+		}
+		if (quad.kind == LOC_QUAD && quad.srcIsLoc()){
+			OpdID sym = quad.src1;
+			if (proc->kindOf(sym) != SYM_OPD){
+				throw new InternalError("Location of a non-symbol");
+			}
+			if (!global[sym] && !seen[sym]){
+				seen[sym] = true;
+				toFrame(sym);
+			}
+		}
+		auto note = [&](OpdID opd){
+			if (!isVar(proc->kindOf(opd)) || global[opd] || seen[opd]){
+				return;
+			}
+			seen[opd] = true;
+			if (addrTaken[opd]){
+				toFrame(opd);
+			} else {
+				tracked.push_back(opd);
+			}
+		};
+		for (OpdID * slot : proc->useSlots(quad)){ note(*slot); }
+		if (quad.defSlot() != nullptr){ note(*quad.defSlot()); }
+		if (quad.kind == GETARG_QUAD){
+			numArgs = std::max(numArgs, quad.argIndex());
+		}
+	}
+	numArgs = std::max(numArgs, proc->getFormals().size());
+
+	CFG cfg(proc);
+	Liveness live(&cfg, tracked);
+	std::vector<LiveInterval> intervals(tracked.size());
+	for (size_t idx = 0; idx < tracked.size(); idx++){
+		intervals[idx].opd = tracked[idx];
+	}
+
+	//Build the ranges a block at a time, walking backwards:
+	// a value is live from its last read (or the end of the
+	// block if it is live out) back to where it is written
+	// (or the start of the block)
+	std::vector<size_t> calls;
+	std::vector<size_t> liveUntil(tracked.size(), Liveness::NONE);
+	std::vector<size_t> open;
+	std::vector<OpdID> read;
+	size_t blockStart = 0;
+	for (auto block : cfg.blocks()){
+		if (block->isExit()){ continue; }
+		size_t blockEnd = blockStart + (block->end() - block->begin());
+		auto extend = [&](size_t idx, size_t pos){
+			if (liveUntil[idx] == Liveness::NONE){
+				liveUntil[idx] = pos;
+				open.push_back(idx);
+			} else {
+				liveUntil[idx] = std::max(liveUntil[idx], pos);
+			}
+		};
+		live.liveOut(block).each([&](size_t idx){
+			extend(idx, 2 * blockEnd - 1);
+		});
+		size_t pos = blockEnd;
+		size_t callPos = 0;
+		for (size_t i = block->end(); i != block->begin(); ){
+			--i;
+			--pos;
+			Quad& quad = quads[i];
+			size_t def = live.indexOf(Liveness::def(proc, quad));
+			if (def != Liveness::NONE){
+				size_t until = liveUntil[def] == Liveness::NONE
+					? 2 * pos + 1 : liveUntil[def];
+				intervals[def].ranges.push_back(std::make_pair(2 * pos + 1, until));
+				liveUntil[def] = Liveness::NONE;
+			}
+			if (isCall(quad)){ calls.push_back(pos); }
+			if (quad.kind == CALL_QUAD){ callPos = pos; }
+			Liveness::uses(proc, quad, read);
+			for (OpdID opd : read){
+				size_t idx = live.indexOf(opd);
+				if (idx == Liveness::NONE){ continue; }
+				//Arguments are only moved into place at the
+				// call, and the address a read stores through
+				// is needed after the call to the runtime
+				if (quad.kind == SETARG_QUAD){
+					extend(idx, 2 * callPos);
+				} else if (quad.kind == RECEIVE_QUAD){
+					extend(idx, 2 * pos + 1);
+				} else {
+					extend(idx, 2 * pos);
+				}
+			}
+		}
+		for (size_t idx : open){
+			if (liveUntil[idx] == Liveness::NONE){ continue; }
+			intervals[idx].ranges.push_back(
+				std::make_pair(2 * blockStart, liveUntil[idx]));
+			liveUntil[idx] = Liveness::NONE;
+		}
+		open.clear();
+		blockStart = blockEnd;
+	}
+	std::sort(calls.begin(), calls.end());
+
+	std::vector<LiveInterval *> unhandled;
+	for (auto& iv : intervals){
+		if (iv.ranges.empty()){ continue; }
+		std::sort(iv.ranges.begin(), iv.ranges.end());
+		std::vector<std::pair<size_t, size_t>> merged;
+		for (auto& range : iv.ranges){
+			if (!merged.empty() && range.first <= merged.back().second + 1){
+				merged.back().second = std::max(merged.back().second, range.second);
+			} else {
+				merged.push_back(range);
+			}
+		}
+		iv.ranges.swap(merged);
+		//A call clobbers the caller-saved registers between
+		// reading its operands and writing its result
+		for (auto& range : iv.ranges){
+			auto call = std::lower_bound(calls.begin(), calls.end(),
+				(range.first + 1) / 2);
+			if (call != calls.end() && 2 * *call + 1 <= range.second){
+				iv.acrossCall = true;
+			}
+		}
+		unhandled.push_back(&iv);
+	}
+	std::stable_sort(unhandled.begin(), unhandled.end(),
+		[](LiveInterval * a, LiveInterval * b){
+			return a->start() < b->start();
+		});
+
+	//Linear scan over intervals with holes (as in Traub et
+	// al.'s second-chance binpacking, but without splitting):
+	// an interval in one of its holes is inactive and only
+	// blocks its register for intervals that overlap it.
+	// When no register is free, whichever of the current
+	// interval and the one it could take a register from
+	// ends later is spilled.
+	std::vector<LiveInterval *> active;
+	std::vector<LiveInterval *> inactive;
+	std::vector<bool> everUsed(NUM_REGS, false);
+	std::vector<LiveInterval *> spilled;
+	for (auto cur : unhandled){
+		size_t pos = cur->start();
+		std::vector<LiveInterval *> stillActive;
+		std::vector<LiveInterval *> stillInactive;
+		for (auto other : active){
+			if (other->end() < pos){ continue; }
+			if (other->covers(pos)){ stillActive.push_back(other); }
+			else { stillInactive.push_back(other); }
+		}
+		for (auto other : inactive){
+			if (other->end() < pos){ continue; }
+			if (other->covers(pos)){ stillActive.push_back(other); }
+			else { stillInactive.push_back(other); }
+		}
+		active.swap(stillActive);
+		inactive.swap(stillInactive);
+
+		std::vector<LiveInterval *> holder(NUM_REGS, nullptr);
+		std::vector<bool> blocked(NUM_REGS, false);
+		for (auto other : active){ holder[other->reg] = other; }
+		for (auto other : inactive){
+			if (other->intersects(*cur)){ blocked[other->reg] = true; }
+		}
+		size_t lowest = cur->acrossCall ? FIRST_CALLEE_SAVED : 0;
+		for (size_t reg = lowest; reg < NUM_REGS; reg++){
+			if (holder[reg] == nullptr && !blocked[reg]){
+				cur->reg = reg;
+				break;
+			}
+		}
+		if (cur->reg == NO_REG){
+			LiveInterval * victim = nullptr;
+			for (size_t reg = lowest; reg < NUM_REGS; reg++){
+				LiveInterval * other = holder[reg];
+				if (other != nullptr && !blocked[reg]
+					&& (victim == nullptr || other->end() > victim->end())){
+					victim = other;
+				}
+			}
+			if (victim == nullptr || victim->end() <= cur->end()){
+				spilled.push_back(cur);
+				continue;
+			}
+			cur->reg = victim->reg;
+			victim->reg = NO_REG;
+			spilled.push_back(victim);
+			active.erase(std::find(active.begin(), active.end(), victim));
+		}
+		everUsed[cur->reg] = true;
+		active.push_back(cur);
+	}
+
+	for (size_t reg = FIRST_CALLEE_SAVED; reg < NUM_REGS; reg++){
+		if (everUsed[reg]){ saved.push_back(reg); }
+	}
+	for (auto& iv : intervals){
+		if (iv.reg != NO_REG){ locs[iv.opd] = REGS[iv.reg]; }
+	}
+	for (auto iv : spilled){ toFrame(iv->opd); }
+	//Values that are never live still need somewhere to go
+	for (auto opd : tracked){
+		if (locs[opd].empty()){ toFrame(opd); }
+	}
+}
+
+//Give each value without a register a slot below the saved
+// registers. The first slots hold the register arguments.
+void X64Lowering::layoutFrame(){
+	numSlots = std::min(numArgs, NUM_ARG_REGS);
+	const std::vector<OpdID>& formals = proc->getFormals();
+	HashMap<OpdID, size_t> formalIndex;
+	size_t index = 1;
+	for (auto formal : formals){ formalIndex[formal] = index++; }
+	for (auto opd : inFrame){
+		auto formal = formalIndex.find(opd);
+		if (formal != formalIndex.end() && addrTaken[opd]){
+			locs[opd] = argSlot(formal->second);
+		} else {
+			locs[opd] = slot(numSlots++);
+		}
+	}
+}
+
+void X64Lowering::lower(){
+	allocate();
+	layoutFrame();
+
+	out << "\t.globl " << funName(proc->getName()) << "\n";
+	out << "\t.type " << funName(proc->getName()) << ", @function\n";
+	out << funName(proc->getName()) << ":\n";
+	emit("pushq %rbp");
+	emit("movq %rsp, %rbp");
+	for (size_t reg : saved){ emit(std::string("pushq ") + REGS[reg]); }
+	//Keep %rsp 16-byte aligned at calls
+	size_t frame = 8 * (saved.size() + numSlots);
+	size_t pad = frame % 16;
+	if (8 * numSlots + pad > 0){
+		emit("subq $" + std::to_string(8 * numSlots + pad) + ", %rsp");
+	}
+	for (size_t i = 1; i <= std::min(numArgs, NUM_ARG_REGS); i++){
+		emit(std::string("movq ") + ARG_REGS[i - 1] + ", " + argSlot(i));
+	}
+
+	for (size_t i = 0; i < quads.size(); i++){
+		for (auto lbl : proc->labelsOf(quads[i])){
+			out << labelName(lbl) << ":\n";
+		}
+		lowerQuad(i);
+	}
+
+	out << labelName(proc->getLeaveLabel()) << ":\n";
+	for (size_t i = 0; i < saved.size(); i++){
+		emit("movq " + std::to_string(-8 * static_cast<long>(i + 1))
+			+ "(%rbp), " + REGS[saved[i]]);
+	}
+	emit("leave");
+	emit("ret");
+	out << "\t.size " << funName(proc->getName()) << ", .-"
+		<< funName(proc->getName()) << "\n";
+}
+
+void X64Lowering::lowerBinOp(const Quad& quad){
+	OpdID dst = quad.dst;
+	OpdID src1 = quad.src1;
+	OpdID src2 = quad.src2;
+	const char * set = nullptr;
+	switch (quad.binOp()){
+	case EQ64: set = "sete"; break;
+	case NEQ64: set = "setne"; break;
+	case LT64: set = "setl"; break;
+	case GT64: set = "setg"; break;
+	case LTE64: set = "setle"; break;
+	case GTE64: set = "setge"; break;
+	default: break;
+	}
+	if (set != nullptr){
+		load(src1, "%rax");
+		emit("cmpq " + src(src2, "%r10") + ", %rax");
+		emit(std::string(set) + " %al");
+		emit("movzbl %al, %eax");
+		store("%rax", dst);
+		return;
+	}
+	if (quad.binOp() == DIV64){
+		load(src1, "%rax");
+		emit("cqto");
+		std::string divisor = src(src2, "%r10");
+		if (divisor[0] == '$'){
+			emit("movq " + divisor + ", %r10");
+			divisor = "%r10";
+		}
+		emit("idivq " + divisor);
+		store("%rax", dst);
+		return;
+	}
+
+	const char * op = nullptr;
+	switch (quad.binOp()){
+	case ADD64: op = "addq"; break;
+	case SUB64: op = "subq"; break;
+	case MULT64: op = "imulq"; break;
+	case AND64: op = "andq"; break;
+	case OR64: op = "orq"; break;
+	default:
+		throw new InternalError("Unknown BinOp");
+	}
+	std::string work = workReg(dst, src2);
+	load(src1, work);
+	emit(std::string(op) + " " + src(src2, "%r10") + ", " + work);
+	store(work, dst);
+}
+
+void X64Lowering::lowerCall(const Quad& call){
+	size_t numStack = args.size() > NUM_ARG_REGS
+		? args.size() - NUM_ARG_REGS : 0;
+	size_t pad = 8 * (numStack % 2);
+	if (pad > 0){ emit("subq $8, %rsp"); }
+	for (size_t i = args.size(); i > NUM_ARG_REGS; i--){
+		emit("pushq " + src(args[i - 1], "%rax"));
+	}
+
+	size_t numRegs = std::min(args.size(), NUM_ARG_REGS);
+	//Filling one argument register mustn't clobber another
+	// argument's value; if any of them is in an argument
+	// register, go through the stack instead
+	bool clash = false;
+	for (size_t i = 0; i < numRegs; i++){
+		for (size_t j = 0; j < numRegs; j++){
+			if (inReg(args[i], ARG_REGS[j])){ clash = true; }
+		}
+	}
+	if (clash){
+		for (size_t i = numRegs; i > 0; i--){
+			emit("pushq " + src(args[i - 1], "%rax"));
+		}
+		for (size_t i = 0; i < numRegs; i++){
+			emit(std::string("popq ") + ARG_REGS[i]);
+		}
+	} else {
+		for (size_t i = 0; i < numRegs; i++){
+			load(args[i], ARG_REGS[i]);
+		}
+	}
+	args.clear();
+
+	emit("call " + funName(proc->getCallee(call)->getName()));
+	if (numStack > 0){
+		emit("addq $" + std::to_string(8 * numStack + pad) + ", %rsp");
+	}
+}
+
+void X64Lowering::lowerQuad(size_t i){
+	const Quad& quad = quads[i];
+	switch (quad.kind){
+	case BINOP_QUAD:
+		lowerBinOp(quad);
+		break;
+	case UNARYOP_QUAD: {
+		std::string work = workReg(quad.dst, NO_OPD);
+		load(quad.src1, work);
+		if (quad.unaryOp() == NEG64){ emit("negq " + work); }
+		else { emit("xorq $1, " + work); }
+		store(work, quad.dst);
+		break;
+	}
+	case ASSIGN_QUAD: {
+		std::string work = workReg(quad.dst, NO_OPD);
+		std::string val = src(quad.src1, work);
+		if (val.find('(') != std::string::npos){
+			emit("movq " + val + ", " + work);
+			val = work;
+		}
+		store(val, quad.dst);
+		break;
+	}
+	case LOC_QUAD:
+		if (quad.srcIsLoc()){
+			emit("leaq " + loc(quad.src1) + ", %rax");
+		} else {
+			load(quad.src1, "%rax");
+		}
+		//A location target gets the address itself rather
+		// than having it stored through it
+		if (quad.tgtIsLoc()){
+			emit("movq %rax, " + loc(quad.dst));
+		} else {
+			store("%rax", quad.dst);
+		}
+		break;
+	case GOTO_QUAD: {
+		Label * tgt = proc->getLabel(quad.target());
+		bool fallsThrough;
+		if (i + 1 == quads.size()){
+			fallsThrough = tgt == proc->getLeaveLabel();
+		} else {
+			auto& next = proc->labelsOf(quads[i + 1]);
+			fallsThrough = std::find(next.begin(), next.end(), tgt)
+				!= next.end();
+		}
+		if (!fallsThrough){ emit("jmp " + labelName(tgt)); }
+		break;
+	}
+	case IFZ_QUAD: {
+		Label * tgt = proc->getLabel(quad.target());
+		if (proc->kindOf(quad.src1) == LIT_OPD){
+			if (proc->litVal(quad.src1) == 0){
+				emit("jmp " + labelName(tgt));
+			}
+			break;
+		}
+		std::string val = src(quad.src1, "%rax");
+		if (val[0] == '%'){ emit("testq " + val + ", " + val); }
+		else { emit("cmpq $0, " + val); }
+		emit("je " + labelName(tgt));
+		break;
+	}
+	case NOP_QUAD:
+		break;
+	case REPORT_QUAD: {
+		load(quad.src1, "%rdi");
+		const DataType * type = proc->getType(quad);
+		if (type != nullptr && type->isString()){
+			emit("call __cmm_write_str");
+		} else {
+			emit("call __cmm_write_int");
+		}
+		break;
+	}
+	case RECEIVE_QUAD: {
+		const DataType * type = proc->getType(quad);
+		if (type != nullptr && type->isString()){
+			emit("call __cmm_read_str");
+		} else {
+			emit("call __cmm_read_int");
+		}
+		store("%rax", quad.dst);
+		break;
+	}
+	case CALL_QUAD:
+		lowerCall(quad);
+		break;
+	case SETARG_QUAD:
+		if (args.size() < quad.argIndex()){
+			args.resize(quad.argIndex(), NO_OPD);
+		}
+		args[quad.argIndex() - 1] = quad.src1;
+		break;
+	case GETARG_QUAD: {
+		std::string from = argSlot(quad.argIndex());
+		std::string to = loc(quad.dst);
+		if (from == to){ break; }
+		if (to[0] == '%'){
+			emit("movq " + from + ", " + to);
+		} else {
+			emit("movq " + from + ", %rax");
+			store("%rax", quad.dst);
+		}
+		break;
+	}
+	case SETRET_QUAD:
+		load(quad.src1, "%rax");
+		break;
+	case GETRET_QUAD:
+		store("%rax", quad.dst);
+		break;
+	default:
+		throw new InternalError(("Can't lower " + proc->repr(quad)).c_str());
+	}
+}
+
+void Procedure::toX64(std::ostream& out, const std::set<Opd *>& globals){
+	X64Lowering lowering(out, this, globals);
+	lowering.lower();
+}
+
+void IRProgram::toX64(std::ostream& out){
+	std::set<Opd *> globalOpds = globalSyms();
+	if (!globalsInOrder.empty()){
+		out << "\t.bss\n\t.align 8\n";
+		for (auto global : globalsInOrder){
+			out << "gbl_" << global->getName() << ":\n\t.zero 8\n";
+		}
+	}
+	if (!strings.empty()){
+		out << "\t.section .rodata\n";
+		for (auto& entry : strings){
+			out << ".L" << entry.first->getName() 
+				<< ":\n\t.string " << entry.second << "\n";
+		}
+	}
+
+	out << "\t.text\n";
+	bool hasMain = false;
+	bool mainReturns = false;
+	for (auto proc : *procs){
+		proc->toX64(out, globalOpds);
+		if (proc->getName() == "main"){
+			hasMain = true;
+			for (auto& quad : proc->getQuads()){
+				if (quad.kind == SETRET_QUAD){ mainReturns = true; }
+			}
+		}
+	}
+	//The C entry point runs the program's main and flushes
+	// whatever it wrote
+	if (hasMain){
+		out << "\t.globl main\n";
+		out << "\t.type main, @function\n";
+		out << "main:\n";
+		out << "\tsubq $8, %rsp\n";
+		out << "\tcall " << funName("main") << "\n";
+		if (!mainReturns){ out << "\txorl %eax, %eax\n"; }
+		out << "\tmovq %rax, (%rsp)\n";
+		out << "\tcall __cmm_flush\n";
+		out << "\tmovq (%rsp), %rax\n";
+		out << "\taddq $8, %rsp\n";
+		out << "\tret\n";
+		out << "\t.size main, .-main\n";
+	}
+	out << RUNTIME;
+	out << "\t.section .note.GNU-stack,\"\",@progbits\n";
+}
+
+}